@@ -11,7 +11,9 @@
 #include <exec/types.h>
 #include <exec/semaphores.h>
 #include <devices/sana2.h>
+#include <devices/genet.h>
 
+#include <compat.h>
 #include <genet/phy.h>
 #include <genet/bcmgenet.h>
 #include <runtime_config.h>
@@ -30,8 +32,8 @@
 /* Generic TODOs
 use HW bcast/mcast flags
 cleanup mcast handling
-packet stats from HW, custom command to expose more stats and tool to read
-type statistics
+tool to read GENETCMD_GETSTATS
+tool to save GENETCMD_GETTRACE
 PHY link state updates at runtime
 interrupts
 
@@ -46,6 +48,12 @@ Multicast support
 
 struct GenetDevice;
 
+/* HFB filters used to discard packet types nobody reads, the last ones of the block */
+#define HFB_DISCARD_FILTERS 16
+
+/* Statistics counter, does not wrap at gigabit rates */
+typedef unsigned long long Counter64;
+
 typedef enum
 {
 	STATE_UNCONFIGURED = 0,
@@ -54,6 +62,23 @@ typedef enum
 	STATE_OFFLINE
 } UnitState;
 
+/*
+ * Pending CMD_READ requests of one packet type, oldest first.
+ * Producers (beginIO() and Do_CMD_READ()) serialize on openerSemaphore,
+ * the unit task is the only consumer and takes no lock. Requests in the
+ * ring have ln_Pred cleared, abortIO() leaves them to the unit task.
+ */
+#define READ_RING_SIZE 256 /* Power of two */
+
+struct ReadRing
+{
+	UWORD head;				  /* Next free slot, written by the producer */
+	UWORD tail;				  /* Oldest request, written by the consumer */
+	UWORD stashed;			  /* Requests on the stash */
+	struct IOSana2Req *stash; /* Taken back by the consumer and served first, linked through ln_Succ */
+	struct IOSana2Req *slot[READ_RING_SIZE];
+};
+
 struct Opener
 {
 	struct MinNode node;
@@ -61,9 +86,9 @@ struct Opener
 	struct MinList orphanQueue;
 	struct MinList eventQueue;
 
-	/* Optimized queues for common packet types */
-	struct MinList ipv4Queue; /* For 0x0800 */
-	struct MinList arpQueue;  /* For 0x0806 */
+	/* Lock-free rings for common packet types */
+	struct ReadRing ipv4Ring; /* For 0x0800 */
+	struct ReadRing arpRing;  /* For 0x0806 */
 
 	struct SignalSemaphore openerSemaphore;
 
@@ -79,6 +104,10 @@ struct Opener
 	BOOL (*CopyFromBuff)(APTR to asm("a0"), APTR from asm("a1"), ULONG len asm("d0"));
 	APTR (*DMACopyToBuff)(APTR cookie asm("a0"));
 	APTR (*DMACopyFromBuff)(APTR cookie asm("a0"));
+	ULONG (*DMAGatherFromBuff)(APTR cookie asm("a0"), struct GenetFragment *fragments asm("a1"), ULONG max asm("d0"));
+
+	BOOL txPriority; /* GENET_TxPriority: all writes go to the priority TX ring */
+	BOOL checksum;	 /* GENET_Checksum: GENETIOF_CHECKSUM is used on reads and writes */
 };
 
 struct MulticastRange
@@ -89,24 +118,82 @@ struct MulticastRange
 	uint64_t upperBound; /* Inclusive */
 };
 
+/*
+ * Packet type tracked with S2_TRACKTYPE, a slot of an open addressed table.
+ * The slot is published by writing type last, the counters are bumped by
+ * the receiving and the sending tasks without a lock.
+ */
+struct TypeStats
+{
+	UWORD type;	 /* TYPE_STATS_EMPTY, TYPE_STATS_DELETED or the tracked type */
+	UWORD users; /* S2_TRACKTYPE calls not undone by S2_UNTRACKTYPE */
+	Counter64 packetsSent;
+	Counter64 packetsReceived;
+	Counter64 bytesSent;
+	Counter64 bytesReceived;
+	Counter64 packetsDropped;
+};
+
+#define TYPE_STATS_EMPTY 0
+#define TYPE_STATS_DELETED 0xffff /* Ends no probe sequence, reused by the next S2_TRACKTYPE */
+#define TYPE_STATS_MAX 256		  /* Upper bound of TRACKED_TYPES */
+
+#define TX_BACKLOG_SLOTS 256 /* Power of two, upper bound of TX_BACKLOG */
+
+/*
+ * The lock, batch state and backlog of the default ring are shared by all
+ * TX rings, the priority ring only uses its descriptor state.
+ */
 struct bcmgenet_tx_ring
 {
 	struct enet_cb *tx_control_block; /* tx ring buffer control block*/
-	UBYTE clean_ptr;				  /* Tx ring clean pointer */
+	ULONG regs;						  /* Ring register block */
+	UBYTE index;					  /* Hardware ring number */
+	UWORD size;						  /* Descriptors in the ring */
+	UWORD clean_ptr;				  /* Tx ring clean pointer */
 	UWORD tx_cons_index;			  /* last consumer index of each ring*/
-	UBYTE write_ptr;				  /* Tx ring write pointer SW copy */
+	UWORD write_ptr;				  /* Tx ring write pointer SW copy */
 	UWORD tx_prod_index;			  /* Tx ring producer index SW copy */
+	UWORD tx_pending;				  /* Frames queued since TDMA_PROD_INDEX was last written */
+	BOOL tx_batch;					  /* Doorbell deferred to bcmgenet_tx_batch_end() */
+	UBYTE tx_lock_depth;			  /* tx_ring_sem nesting of its owner, see bcmgenet_tx_lock() */
 
 	struct SignalSemaphore tx_ring_sem;
+
+	/* Writes waiting for free descriptors, oldest first, ln_Pred cleared as on the ring */
+	UWORD backlog_head;
+	UWORD backlog_tail;
+	BOOL backlog_high; /* High watermark reported, re-armed at the low one */
+	struct IOSana2Req *backlog[TX_BACKLOG_SLOTS];
+	ULONG backlog_taken[TX_BACKLOG_SLOTS]; /* LATENCY_STATS: when bcmgenet_xmit() took each write */
+
+	/* Token bucket of the rate limit, kept across offline/online */
+	ULONG shape_rate;	/* kbit/s, 0 = unlimited */
+	ULONG shape_burst;	/* Bytes that may go out back to back */
+	LONG shape_tokens;	/* Bits left to send, negative while a frame is paid off */
+	ULONG shape_stamp;	/* System timer at the last refill */
 };
 
 struct bcmgenet_rx_ring
 {
 	struct enet_cb *rx_control_block; /* Rx ring buffer control block */
+	ULONG regs;						  /* Ring register block */
+	UBYTE index;					  /* Hardware ring number */
+	UWORD size;						  /* Descriptors in the ring */
 	UWORD rx_cons_index;			  /* Rx last consumer index */
+	UWORD rx_release_index;			  /* Rx consumer index given to the hardware */
+	UWORD read_ptr;					  /* Control block of rx_cons_index */
+	UWORD release_ptr;				  /* Control block of rx_release_index */
 	UWORD old_discards;
+	UWORD dma_bound;				  /* Descriptors bound to a read request */
+	UBYTE rx_buf_offset;			  /* Bytes the hardware puts in front of a frame */
+	struct IOSana2Req *dma_io;		  /* Request the current frame was received into */
 	ULONG rx_max_coalesced_frames;
 	ULONG rx_coalesce_usecs;
+	UBYTE moderation;				  /* Adaptive coalescing profile in use */
+	Counter64 moderation_packets;	  /* rx_packets and rx_bytes at the last sample */
+	Counter64 moderation_bytes;
+	ULONG packets_per_sec;			  /* Receive rate measured at the last sample */
 };
 
 struct enet_cb
@@ -115,27 +202,45 @@ struct enet_cb
 	APTR descriptor_address;
 	APTR internal_buffer; /* Used when data needs to be copied from IP stack */
 	APTR data_buffer;
+	ULONG stamp; /* LATENCY_STATS: system timer when the write was put on the TX ring */
+	ULONG taken; /* LATENCY_STATS: system timer when bcmgenet_xmit() took the write */
 };
 
 struct internal_stats
 {
-	ULONG rx_packets;		 // Sana2 PacketsReceived
-	ULONG rx_bytes;			 // total bytes received
-	ULONG rx_dropped;		 // Sana2 UnknownTypesReceived
-	ULONG rx_arp_ip_dropped; // included in rx_dropped
-	ULONG rx_overruns;		 // Sana2 Overruns
-	ULONG rx_other_errors;
-	ULONG rx_crc_errors;
-	ULONG rx_over_errors;
-	ULONG rx_frame_errors;
-	ULONG rx_length_errors;
-	ULONG rx_fragmented_errors;
-
-	ULONG tx_packets; // Sana2 PacketsSent
-	ULONG tx_bytes;	  // total bytes transmitted
-	ULONG tx_dma;	  // tx_dma + tx_copy = tx_packets
-	ULONG tx_copy;
-	ULONG tx_dropped; // Sana2 Overruns
+	Counter64 rx_packets;			// Sana2 PacketsReceived
+	Counter64 rx_bytes;				// total bytes received
+	Counter64 rx_dropped;			// Sana2 UnknownTypesReceived
+	Counter64 rx_arp_ip_dropped;	// included in rx_dropped
+	Counter64 rx_overruns;			// Sana2 Overruns
+	Counter64 rx_other_errors;
+	Counter64 rx_crc_errors;
+	Counter64 rx_over_errors;
+	Counter64 rx_frame_errors;
+	Counter64 rx_length_errors;
+	Counter64 rx_fragmented_errors;
+	Counter64 rx_bad_multicast;		// multicast the MAC let through that nobody asked for
+	Counter64 rx_dma;				// received straight into a stack buffer, included in rx_packets
+	Counter64 rx_csum;				// IPv4 TCP/UDP checksums verified from the Receive Status Block
+
+	Counter64 tx_packets;			// Sana2 PacketsSent
+	Counter64 tx_bytes;				// total bytes transmitted
+	Counter64 tx_dma;				// tx_dma + tx_copy = tx_packets
+	Counter64 tx_copy;
+	Counter64 tx_gather;			// sent from a fragment list, included in tx_dma
+	Counter64 tx_prio;				// queued on the priority TX ring
+	Counter64 tx_csum;				// checksum filled in for GENETIOF_CHECKSUM writes, by the MAC or in software
+	Counter64 tx_shaped;			// times a rate limit held writes back and the unit task had to wait for it
+	ULONG tx_handoff;				// sent by the task that held the TX ring instead of the caller, 32 bits as it is counted atomically
+	Counter64 tx_dropped;			// Sana2 Overruns
+	Counter64 tx_ring_full;			// included in tx_dropped, TX ring and TX backlog were full
+	ULONG tx_underruns;				// TX FIFO ran dry, counted by the ISR
+	ULONG interrupts;				// IRQ0 and IRQ1 interrupts taken, counted by the ISRs
+
+	Counter64 mib[GENET_MIB_COUNT]; // UMAC MIB counters, folded in by bcmgenet_mib_harvest()
+
+	ULONG latency[GENET_LATENCY_STAGES][GENET_LATENCY_BUCKETS]; // LATENCY_STATS histograms, see LatencyRecord()
+	ULONG latency_max[GENET_LATENCY_STAGES];
 
 	TimeVal_Type last_start;
 };
@@ -154,10 +259,12 @@ struct GenetUnit
 	UnitState state;
 	struct Task *task;
 	struct internal_stats internalStats;
+	ULONG mibLast[GENET_MIB_COUNT]; /* MIB registers at the last harvest */
 	struct MinList openers;
 	struct MinList multicastRanges;
 	ULONG multicastCount;
 	BOOL mdfEnabled; /* Multicast filter enabled */
+	UBYTE readAborted; /* A read request in a ring or on the RX ring was aborted */
 
 	/* Opener management (message-based modifications) */
 	struct MsgPort *openerPort; /* created in unit task */
@@ -171,8 +278,16 @@ struct GenetUnit
 	/* Interrupt config and status */
 	ULONG irq0_number, irq1_number; /* IRQ numbers from Device Tree */
 	ULONG irq0_status;				/* status bits of irq0*/
-	BYTE irq0_signal;				/* signals used to wake bottom-half */
+	ULONG irq1_status;				/* status bits of irq1 */
+	BYTE irq0_signal;				/* signals used to wake bottom-half, for both IRQs */
+	ULONG irq_sample;				/* internalStats.interrupts at the last sample */
+	ULONG irqs_per_sec;				/* Interrupt rate measured at the last sample */
+	ULONG lat_irq;					/* LATENCY_STATS: first RX interrupt not picked up yet, never 0 while set */
+	ULONG lat_rx_irq;				/* RX interrupt of the frames being received, 0 while polling */
+	ULONG lat_rx_pickup;			/* The unit task picked up the RX rings */
+	ULONG lat_rx_frame;				/* ReceiveFrame() took the current frame */
 	struct Interrupt irq0_isr;
+	struct Interrupt irq1_isr;
 
 	/* PHY */
 	phy_interface_t phy_interface;
@@ -181,14 +296,39 @@ struct GenetUnit
 
 	/* MAC layer */
 	/* RX */
-	struct bcmgenet_rx_ring rx_ring;
+	struct bcmgenet_rx_ring rx_ring;	  /* DEFAULT_Q, everything not steered elsewhere */
+	struct bcmgenet_rx_ring rx_prio_ring; /* RX_PRIO_Q, size is 0 when not in use */
+	BOOL rx_polling;					  /* RX interrupts masked, the unit task polls the rings */
+	BOOL rx_status_block;				  /* RBUF_64B_EN, checksum status in front of every frame */
+	ULONG rx_idle_polls;				  /* Polls in a row that found no frame */
 	UBYTE *rxbuffer_not_aligned;
 	UBYTE *rxbuffer;
 
 	/* TX */
-	struct bcmgenet_tx_ring tx_ring;
+	struct bcmgenet_tx_ring tx_ring;	  /* DEFAULT_Q, bulk traffic */
+	struct bcmgenet_tx_ring tx_prio_ring; /* TX_PRIO_Q, size is 0 when not in use */
+	BOOL tx_status_block;				  /* TBUF_64B_EN, checksum request in front of every frame */
+	ULONG tx_shape_usecs;				  /* Rate limit holds writes back, the unit task wakes up this much later */
+	struct IOSana2Req *tx_intake;		  /* Writes waiting for tx_ring_sem, newest first, linked through ln_Succ */
+	BOOL tx_watchdog;					  /* TX_LAZY_RECLAIM: frames in flight, the reclaim timer runs */
 	UBYTE *txbuffer_not_aligned;
 	UBYTE *txbuffer;
+
+	/* S2_TRACKTYPE, allocated on first use, twice TRACKED_TYPES slots rounded up to a power of two */
+	struct TypeStats *typeStats;
+	UWORD typeStatsMask;
+	UWORD typeStatsCount; /* Types tracked, frames are only looked up when not 0 */
+
+	/* Binary event trace, allocated when an event is first enabled, TRACE_RECORDS rounded up to a power of two */
+	struct GenetTraceEntry *trace;
+	ULONG traceSlots;	 /* Entries - 1 */
+	ULONG traceMask;	 /* GENET_TRACE_* recorded, 1 << event each */
+	ULONG traceNext;	 /* Sequence of the next entry, taken with an atomic add */
+
+	/* Packet types discarded by the Hardware Filter Block, 0 = filter unused */
+	UWORD hfbType[HFB_DISCARD_FILTERS];
+	UBYTE hfbCount;
+	UBYTE hfbNext; /* Filter reused when all are taken */
 };
 
 /* Opener management commands */
@@ -222,25 +362,141 @@ int UnitOnline(struct GenetUnit *unit);
 void UnitOffline(struct GenetUnit *unit);
 int UnitClose(struct GenetUnit *unit, struct Opener *opener);
 
+/* ReceiveFrame() flag above the descriptor status bits: GENETIOF_CHECKSUM for the frame */
+#define RX_CSUM_OK (1UL << 16)
+
 BOOL ReceiveFrame(struct GenetUnit *unit, UBYTE *packet, ULONG packetLength, ULONG dma_flags);
 void ProcessCommand(struct IOSana2Req *io);
 
-/* Inline function for fast packet type queue lookup */
-static inline struct MinList *GetPacketTypeQueue(struct Opener *opener, UWORD packetType)
+void ReplyAbortedReads(struct GenetUnit *unit);
+
+/* Inline function for fast packet type ring lookup, NULL for types served from readQueue */
+static inline struct ReadRing *GetPacketTypeRing(struct Opener *opener, UWORD packetType)
 {
 	switch (packetType)
 	{
 	case 0x0800: /* IPv4 */
-		return &opener->ipv4Queue;
+		return &opener->ipv4Ring;
 	case 0x0806: /* ARP */
-		return &opener->arpQueue;
+		return &opener->arpRing;
 	default:
-		return &opener->readQueue; /* Fallback to legacy port */
+		return NULL;
+	}
+}
+
+static inline void ReadRingInit(struct ReadRing *ring)
+{
+	ring->head = 0;
+	ring->tail = 0;
+	ring->stashed = 0;
+	ring->stash = NULL;
+}
+
+/* Producer side, openerSemaphore held. FALSE if the ring is full */
+static inline BOOL ReadRingPut(struct ReadRing *ring, struct IOSana2Req *io)
+{
+	UWORD head = ring->head;
+	if ((UWORD)(head - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE)) >= READ_RING_SIZE)
+		return FALSE;
+
+	io->ios2_Req.io_Message.mn_Node.ln_Pred = NULL;
+	ring->slot[head & (READ_RING_SIZE - 1)] = io;
+	__atomic_store_n(&ring->head, (UWORD)(head + 1), __ATOMIC_RELEASE);
+	return TRUE;
+}
+
+/* Consumer side, unit task only */
+static inline struct IOSana2Req *ReadRingGet(struct ReadRing *ring)
+{
+	struct IOSana2Req *io = ring->stash;
+	if (io != NULL)
+	{
+		ring->stash = (struct IOSana2Req *)io->ios2_Req.io_Message.mn_Node.ln_Succ;
+		ring->stashed--;
+		return io;
 	}
+
+	UWORD tail = ring->tail;
+	if (tail == __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE))
+		return NULL;
+
+	io = ring->slot[tail & (READ_RING_SIZE - 1)];
+	__atomic_store_n(&ring->tail, (UWORD)(tail + 1), __ATOMIC_RELEASE);
+	return io;
+}
+
+static inline struct IOSana2Req *ReadRingPeek(struct ReadRing *ring)
+{
+	if (ring->stash != NULL)
+		return ring->stash;
+
+	UWORD tail = ring->tail;
+	if (tail == __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE))
+		return NULL;
+	return ring->slot[tail & (READ_RING_SIZE - 1)];
+}
+
+static inline UWORD ReadRingCount(struct ReadRing *ring)
+{
+	return ring->stashed + (UWORD)(__atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) - ring->tail);
+}
+
+/* Give a request taken with ReadRingGet() back, it is served before the ring */
+static inline void ReadRingUnget(struct ReadRing *ring, struct IOSana2Req *io)
+{
+	io->ios2_Req.io_Message.mn_Node.ln_Succ = (struct Node *)ring->stash;
+	io->ios2_Req.io_Message.mn_Node.ln_Pred = NULL;
+	ring->stash = io;
+	ring->stashed++;
+}
+
+/* Free running 1MHz system timer */
+static inline ULONG SystemClock(void)
+{
+	return LE32(*(volatile ULONG *)0xf2003004); // TODO get from device tree
+}
+
+/* LATENCY_STATS: one more time in a stage's histogram, bucket n holds 2^(n-1) up to 2^n us */
+static inline void LatencyRecord(struct GenetUnit *unit, UBYTE stage, ULONG start, ULONG now)
+{
+	ULONG usecs = now - start;
+	ULONG bucket = usecs ? 32 - __builtin_clz(usecs) : 0;
+
+	if (bucket >= GENET_LATENCY_BUCKETS)
+		bucket = GENET_LATENCY_BUCKETS - 1;
+	unit->internalStats.latency[stage][bucket]++;
+	if (usecs > unit->internalStats.latency_max[stage])
+		unit->internalStats.latency_max[stage] = usecs;
+}
+
+/* LATENCY_STATS: a read is replied with the frame ReceiveFrame() is handling */
+static inline void LatencyRxReply(struct GenetUnit *unit)
+{
+	ULONG now = SystemClock();
+
+	LatencyRecord(unit, GENET_LATENCY_RX_DELIVER, unit->lat_rx_frame, now);
+	if (unit->lat_rx_irq)
+		LatencyRecord(unit, GENET_LATENCY_RX_TOTAL, unit->lat_rx_irq, now);
+}
+
+void TraceRecord(struct GenetUnit *unit, ULONG event, ULONG arg0, ULONG arg1);
+BOOL TraceStart(struct GenetUnit *unit, ULONG mask);
+
+/* TRACE_EVENTS: record an event in the unit's trace, from interrupts and any task */
+static inline void Trace(struct GenetUnit *unit, ULONG event, ULONG arg0, ULONG arg1)
+{
+	if (unlikely(unit->traceMask & (1UL << event)))
+		TraceRecord(unit, event, arg0, arg1);
 }
 
 int Do_S2_ADDMULTICASTADDRESSES(struct IOSana2Req *io);
 int Do_S2_DELMULTICASTADDRESSES(struct IOSana2Req *io);
+int Do_S2_TRACKTYPE(struct IOSana2Req *io);
+int Do_S2_UNTRACKTYPE(struct IOSana2Req *io);
+int Do_S2_GETTYPESTATS(struct IOSana2Req *io);
+int Do_GENETCMD_GETTRACE(struct IOSana2Req *io);
+int Do_GENETCMD_SETTRACE(struct IOSana2Req *io);
+struct TypeStats *FindTypeStats(struct GenetUnit *unit, UWORD packetType); /* NULL when not tracked */
 void ReportEvents(struct GenetUnit *unit, ULONG eventSet);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,297 @@
+// SPDX-License-Identifier: MPL-2.0 OR GPL-2.0+
+#ifndef DEVICES_GENET_H
+#define DEVICES_GENET_H
+
+/*
+ * genet.device extensions to SANA-II. Other devices ignore these tags, so a
+ * stack can pass them to any device it opens.
+ */
+
+#include <devices/sana2.h>
+
+/*
+ * Defines for OpenDevice() tags, above the range SANA-II uses
+ */
+#define GENET_Dummy (S2_Dummy + 0x1000)
+
+/* BOOL, all writes of this opener go to the priority TX ring (TX_PRIO_RING=1) */
+#define GENET_TxPriority (GENET_Dummy + 1)
+/* BOOL, the opener uses GENETIOF_CHECKSUM on its reads and writes */
+#define GENET_Checksum (GENET_Dummy + 2)
+
+/*
+ * ULONG (*)(APTR cookie asm("a0"), struct GenetFragment *fragments asm("a1"), ULONG max asm("d0"))
+ *
+ * Gather function for writes whose data is not in one piece, such as a
+ * header mbuf followed by payload clusters. It fills in up to max fragments
+ * for the ios2_Data cookie and returns how many it used, or 0 to have the
+ * write copied with the CopyFromBuff function instead. The fragments are
+ * sent straight from the stack's memory, in order, and have to stay as they
+ * are until the write is replied. Like S2_DMACopyFromBuff32 it is only used
+ * with USE_DMA=1, and tried after S2_DMACopyFromBuff32 returned NULL.
+ */
+#define GENET_DMAGatherFromBuff (GENET_Dummy + 3)
+
+/* Most fragments a write is sent from */
+#define GENET_MAX_FRAGMENTS 8
+
+struct GenetFragment
+{
+	APTR gf_Data;	 /* Outside CHIP memory */
+	ULONG gf_Length; /* Fragments add up to ios2_DataLength */
+};
+
+/*
+ * io_Flags of CMD_READ, CMD_WRITE and S2_BROADCAST/S2_MULTICAST requests of
+ * an opener that passed GENET_Checksum. The bit is free in SANA-II.
+ *
+ * Read: the IPv4 header and the TCP or UDP checksum of the packet were
+ * verified, the stack does not need to check them again. Cleared on every
+ * other packet, which the stack checks as usual.
+ *
+ * Write: the TCP or UDP checksum field of the IPv4 packet holds the sum of
+ * the pseudo header, not complemented, and the device fills in the checksum.
+ * The IPv4 header checksum is still up to the stack.
+ */
+#define GENETIOB_CHECKSUM 4
+#define GENETIOF_CHECKSUM (1 << GENETIOB_CHECKSUM)
+
+/*
+ * Device specific commands, above the 0xC000 range SANA-II extensions took
+ * from New Style Devices. Listed by NSCMD_DEVICEQUERY.
+ */
+#define GENETCMD_Dummy 0xc800
+
+
+/*
+ * GENETCMD_GETTXRATE/GENETCMD_SETTXRATE: rate limit of a TX ring,
+ * ios2_StatData points to a struct GenetTxRate with gtr_Ring filled in.
+ * SET takes effect at once and holds until the unit is closed, writes over
+ * the limit wait in the TX backlog (TX_BACKLOG). Fails with
+ * S2ERR_BAD_ARGUMENT for the priority ring when TX_PRIO_RING=0.
+ */
+#define GENETCMD_GETTXRATE (GENETCMD_Dummy + 0)
+#define GENETCMD_SETTXRATE (GENETCMD_Dummy + 1)
+
+#define GENET_TXRING_BULK 0
+#define GENET_TXRING_PRIORITY 1
+
+struct GenetTxRate
+{
+	ULONG gtr_Ring;	 /* GENET_TXRING_BULK or GENET_TXRING_PRIORITY */
+	ULONG gtr_Rate;	 /* kbit/s on the wire, 0 = unlimited */
+	ULONG gtr_Burst; /* Bytes sent back to back before the rate applies */
+};
+
+/*
+ * GENETCMD_GETSTATS: 64-bit statistics of the unit, ios2_StatData points to
+ * a struct GenetStats with gs_Length set to the size the caller has. The
+ * device fills in up to that many bytes and sets gs_Actual to the size it
+ * knows, later versions only append to the structure. The counters start at
+ * zero on S2_ONLINE and keep their values while the unit is offline.
+ *
+ * gs_Mib holds the counters of the MAC itself, indexed by GENET_MIB_*. They
+ * count every frame on the wire, also the ones the MAC drops before they
+ * reach a ring, and bytes with the FCS. The MAC counts in 32 bits, the
+ * device folds them into 64 bits every PERIODIC_TASK_MS.
+ */
+#define GENETCMD_GETSTATS (GENETCMD_Dummy + 2)
+
+/* Received frames, by size with the FCS */
+#define GENET_MIB_RX_64 0
+#define GENET_MIB_RX_65_127 1
+#define GENET_MIB_RX_128_255 2
+#define GENET_MIB_RX_256_511 3
+#define GENET_MIB_RX_512_1023 4
+#define GENET_MIB_RX_1024_1518 5
+#define GENET_MIB_RX_1519_1522 6 /* VLAN tagged */
+#define GENET_MIB_RX_1523_2047 7
+#define GENET_MIB_RX_2048_4095 8
+#define GENET_MIB_RX_4096_9216 9
+#define GENET_MIB_RX_PACKETS 10
+#define GENET_MIB_RX_BYTES 11
+#define GENET_MIB_RX_MULTICAST 12
+#define GENET_MIB_RX_BROADCAST 13
+#define GENET_MIB_RX_FCS_ERRORS 14
+#define GENET_MIB_RX_CONTROL 15
+#define GENET_MIB_RX_PAUSE 16
+#define GENET_MIB_RX_UNKNOWN_OPCODE 17
+#define GENET_MIB_RX_ALIGNMENT_ERRORS 18
+#define GENET_MIB_RX_LENGTH_ERRORS 19 /* Length field out of range */
+#define GENET_MIB_RX_CODE_ERRORS 20
+#define GENET_MIB_RX_CARRIER_ERRORS 21
+#define GENET_MIB_RX_OVERSIZE 22
+#define GENET_MIB_RX_JABBERS 23 /* Oversize with a bad FCS */
+#define GENET_MIB_RX_MTU_ERRORS 24 /* Longer than the maximum frame length */
+#define GENET_MIB_RX_GOOD 25
+#define GENET_MIB_RX_UNICAST 26
+#define GENET_MIB_RX_PPP 27
+#define GENET_MIB_RX_CRC_MATCH 28
+/* Transmitted frames, by size with the FCS */
+#define GENET_MIB_TX_64 29
+#define GENET_MIB_TX_65_127 30
+#define GENET_MIB_TX_128_255 31
+#define GENET_MIB_TX_256_511 32
+#define GENET_MIB_TX_512_1023 33
+#define GENET_MIB_TX_1024_1518 34
+#define GENET_MIB_TX_1519_1522 35
+#define GENET_MIB_TX_1523_2047 36
+#define GENET_MIB_TX_2048_4095 37
+#define GENET_MIB_TX_4096_9216 38
+#define GENET_MIB_TX_PACKETS 39
+#define GENET_MIB_TX_MULTICAST 40
+#define GENET_MIB_TX_BROADCAST 41
+#define GENET_MIB_TX_PAUSE 42
+#define GENET_MIB_TX_CONTROL 43
+#define GENET_MIB_TX_FCS_ERRORS 44
+#define GENET_MIB_TX_OVERSIZE 45
+#define GENET_MIB_TX_DEFERRALS 46
+#define GENET_MIB_TX_EXCESSIVE_DEFERRALS 47
+#define GENET_MIB_TX_SINGLE_COLLISIONS 48
+#define GENET_MIB_TX_MULTIPLE_COLLISIONS 49
+#define GENET_MIB_TX_LATE_COLLISIONS 50
+#define GENET_MIB_TX_EXCESSIVE_COLLISIONS 51
+#define GENET_MIB_TX_FRAGMENTS 52
+#define GENET_MIB_TX_COLLISIONS 53
+#define GENET_MIB_TX_JABBERS 54
+#define GENET_MIB_TX_BYTES 55
+#define GENET_MIB_TX_GOOD 56
+#define GENET_MIB_TX_UNICAST 57
+/* Received frames shorter than 64 bytes */
+#define GENET_MIB_RX_RUNTS 58
+#define GENET_MIB_RX_RUNTS_FCS_OK 59
+#define GENET_MIB_RX_RUNTS_FCS_ERRORS 60
+#define GENET_MIB_RX_RUNT_BYTES 61
+#define GENET_MIB_COUNT 62
+
+struct GenetStats
+{
+	ULONG gs_Length; /* Bytes the caller has room for */
+	ULONG gs_Actual; /* Size of the structure the device knows */
+
+	/* What the stacks were handed and sent, as in S2_GETGLOBALSTATS */
+	S2QUAD gs_PacketsReceived;
+	S2QUAD gs_BytesReceived;
+	S2QUAD gs_PacketsSent;
+	S2QUAD gs_BytesSent;
+
+	S2QUAD gs_Mib[GENET_MIB_COUNT];
+};
+
+/*
+ * GENETCMD_GETLATENCY: where frames spend their time in the driver, with
+ * LATENCY_STATS=1. ios2_StatData points to a struct GenetLatency with
+ * gl_Length set, filled in like struct GenetStats. Every stage has a
+ * histogram of microseconds on a log scale: bucket 0 counts times below
+ * 1us, bucket n times from 2^(n-1) up to 2^n us, the last one everything
+ * longer. Cleared on S2_ONLINE, times come from the 1MHz system timer.
+ * Fails with S2ERR_NOT_SUPPORTED when LATENCY_STATS=0.
+ */
+#define GENETCMD_GETLATENCY (GENETCMD_Dummy + 3)
+
+#define GENET_LATENCY_RX_IRQ 0		 /* RX interrupt to the unit task picking up the ring */
+#define GENET_LATENCY_RX_RING 1		 /* Picking up the ring to the frame's turn, behind the frames before it */
+#define GENET_LATENCY_RX_DELIVER 2	 /* Frame's turn to the reply of a read it went to */
+#define GENET_LATENCY_RX_TOTAL 3	 /* RX interrupt to the reply of a read, not while polling */
+#define GENET_LATENCY_TX_QUEUE 4	 /* Driver taking the write to the TX ring, through the backlog */
+#define GENET_LATENCY_TX_COMPLETE 5 /* TX ring to the reply, sent and reclaimed */
+#define GENET_LATENCY_TX_TOTAL 6	 /* Driver taking the write to its reply */
+#define GENET_LATENCY_STAGES 7
+#define GENET_LATENCY_BUCKETS 24
+
+struct GenetLatency
+{
+	ULONG gl_Length; /* Bytes the caller has room for */
+	ULONG gl_Actual; /* Size of the structure the device knows */
+
+	ULONG gl_Max[GENET_LATENCY_STAGES]; /* Longest time seen, us */
+	ULONG gl_Histogram[GENET_LATENCY_STAGES][GENET_LATENCY_BUCKETS];
+};
+
+/*
+ * GENETCMD_GETTRACE: the binary event trace of the unit. ios2_StatData
+ * points to a struct GenetTrace with gt_Length set to the size of the
+ * buffer. The device fills in the header and as many of the latest entries
+ * as fit, oldest first. gt_Count is the number of entries copied, only
+ * those are valid. gt_Actual is the size of the whole ring, header
+ * included, whether or not it is full: a buffer of gt_Actual bytes takes
+ * every entry the trace can hold next time. The buffer can be saved to a
+ * file as it is and read with genet-trace from the host build.
+ *
+ * GENETCMD_SETTRACE: ios2_StatData points to a ULONG with the GENET_TRACE_*
+ * events to record, 1 << event each, the previous mask is returned in it.
+ * Holds until the unit is closed, TRACE_EVENTS is used when it is
+ * configured. Fails with S2ERR_NO_RESOURCES when no trace could be
+ * allocated, TRACE_RECORDS=0 among others.
+ *
+ * Entries are written without a lock from the interrupts and every task,
+ * each one gets the next gte_Sequence. An entry that was overwritten while
+ * it was copied does not carry the sequence its place in gt_Entry implies.
+ */
+#define GENETCMD_GETTRACE (GENETCMD_Dummy + 4)
+#define GENETCMD_SETTRACE (GENETCMD_Dummy + 5)
+
+#define GENET_TRACE_IRQ0 0			/* Arg: interrupt status */
+#define GENET_TRACE_IRQ1 1			/* Arg: interrupt status */
+#define GENET_TRACE_BOTTOM_HALF 2	/* Args: IRQ0 and IRQ1 status the unit task picked up */
+#define GENET_TRACE_RX_RING 3		/* Args: ring, frames taken off it */
+#define GENET_TRACE_RX_FRAME 4		/* Args: length, packet type */
+#define GENET_TRACE_RX_ERROR 5		/* Args: descriptor status, length */
+#define GENET_TRACE_RX_ORPHAN 6		/* Args: packet type, 1 if an orphan read took it */
+#define GENET_TRACE_TX_WRITE 7		/* Args: length, ring */
+#define GENET_TRACE_TX_BACKLOG 8	/* Args: writes in the backlog, 1 when it is full and the write failed */
+#define GENET_TRACE_TX_RECLAIM 9	/* Args: ring, writes replied */
+#define GENET_TRACE_TX_SHAPE 10		/* Args: ring, microseconds until the rate limit lets the next write go */
+#define GENET_TRACE_COALESCE 11		/* Args: RX coalescing microseconds and frames */
+#define GENET_TRACE_POLL 12			/* Args: 1 polling, 0 back to interrupts, packets/s */
+#define GENET_TRACE_COMMAND 13		/* Args: io_Command, the request */
+#define GENET_TRACE_EVENT 14		/* Arg: S2EVENT_* reported */
+#define GENET_TRACE_HFB 15			/* Args: packet type, 1 discarded by the MAC, 0 accepted again */
+#define GENET_TRACE_EVENTS 16
+
+#define GENET_TRACE_MAGIC 0x47545243 /* 'GTRC', tells a reader the byte order */
+
+struct GenetTraceEntry
+{
+	ULONG gte_Sequence; /* Written last */
+	ULONG gte_Time;		/* 1MHz system timer */
+	ULONG gte_Event;	/* GENET_TRACE_* */
+	ULONG gte_Arg[2];
+};
+
+struct GenetTrace
+{
+	ULONG gt_Length; /* Bytes the caller has room for */
+	ULONG gt_Actual; /* Bytes the whole ring takes, not what was copied */
+	ULONG gt_Magic;	 /* GENET_TRACE_MAGIC */
+	ULONG gt_Mask;	 /* Events recorded */
+	ULONG gt_Next;	 /* Sequence of the next entry */
+	ULONG gt_Count;	 /* Entries copied, gt_Next - gt_Count up to gt_Next - 1 */
+	struct GenetTraceEntry gt_Entry[];
+};
+
+/*
+ * S2_GETSPECIALSTATS records besides S2SS_ETHERNET_BADMULTICAST,
+ * S2SS_ETHERNET_RETRIES (collisions) and S2SS_ETHERNET_FIFO_UNDERRUNS.
+ * Counts are the low 32 bits of the GENETCMD_GETSTATS style counters.
+ */
+#define GENETSS_Dummy ((((S2WireType_Ethernet) & 0xffff) << 16) | 0xc800)
+
+#define GENETSS_RX_DISCARDS (GENETSS_Dummy + 0)			 /* RX ring full, the DMA dropped the frame */
+#define GENETSS_TX_RING_FULL (GENETSS_Dummy + 1)		 /* Writes failed, TX ring and TX backlog full */
+#define GENETSS_RX_ZERO_COPY (GENETSS_Dummy + 2)		 /* Frames received straight into a stack buffer */
+#define GENETSS_RX_COPY (GENETSS_Dummy + 3)				 /* Frames copied to the stack */
+#define GENETSS_RX_ZERO_COPY_PERCENT (GENETSS_Dummy + 4) /* Share of zero copy frames, 0 to 100 */
+#define GENETSS_TX_ZERO_COPY (GENETSS_Dummy + 5)		 /* Writes sent from the stack's memory */
+#define GENETSS_TX_COPY (GENETSS_Dummy + 6)				 /* Writes copied before they were sent */
+#define GENETSS_TX_ZERO_COPY_PERCENT (GENETSS_Dummy + 7) /* Share of zero copy writes, 0 to 100 */
+/*
+ * Good frames the MAC received that never reached an RX ring: dropped by
+ * the HFB discard filters (HFB_FILTER=1) or, when not promiscuous, the
+ * address filter. Worked out from the MIB counters, so frames still waiting
+ * in a ring count until the unit task took them.
+ */
+#define GENETSS_RX_FILTERED (GENETSS_Dummy + 8)
+#define GENETSS_INTERRUPTS_PER_SEC (GENETSS_Dummy + 9) /* Measured every PERIODIC_TASK_MS */
+
+#endif /* DEVICES_GENET_H */
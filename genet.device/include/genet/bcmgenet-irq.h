@@ -9,9 +9,13 @@
 /* Interrupt enable/disable */
 void bcmgenet_irq0_enable(struct GenetUnit *unit, ULONG irq_mask);
 void bcmgenet_irq0_disable(struct GenetUnit *unit, ULONG irq_mask);
+void bcmgenet_irq1_enable(struct GenetUnit *unit, ULONG irq_mask);
+void bcmgenet_irq1_disable(struct GenetUnit *unit, ULONG irq_mask);
 void bcmgenet_intr_disable(struct GenetUnit *unit);
+void bcmgenet_irq_sample(struct GenetUnit *unit, ULONG interval_ms); /* Measures the interrupt rate, called periodically */
 
 /* Interrupt handler */
 void bcmgenet_isr0(struct ExecBase *SysBase asm("a6"), struct GenetUnit *unit asm("a1"), ULONG irq asm("d0"));
+void bcmgenet_isr1(struct ExecBase *SysBase asm("a6"), struct GenetUnit *unit asm("a1"), ULONG irq asm("d0"));
 
 #endif
\ No newline at end of file
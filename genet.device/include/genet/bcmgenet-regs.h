@@ -28,10 +28,36 @@
 #define GENET_RBUF_OFF 0x0300
 #define RBUF_TBUF_SIZE_CTRL (GENET_RBUF_OFF + 0xb4)
 #define RBUF_CTRL (GENET_RBUF_OFF + 0x00)
+#define RBUF_64B_EN BIT(0)
 #define RBUF_ALIGN_2B BIT(1)
+#define RBUF_CHK_CTRL (GENET_RBUF_OFF + 0x14)
+#define RBUF_RXCHK_EN BIT(0)
+#define RBUF_SKIP_FCS BIT(4)
+#define RBUF_L3_PARSE_DIS BIT(5)
+
+#define GENET_TBUF_OFF 0x0600
+#define TBUF_CTRL (GENET_TBUF_OFF + 0x00)
+#define TBUF_64B_EN BIT(0)
+
+/*
+ * Status block in front of every frame, in RX buffers with RBUF_64B_EN and
+ * in TX buffers with TBUF_64B_EN. Fields are little endian.
+ */
+#define STATUS_BLOCK_SIZE 64
+#define STATUS_LENGTH_STATUS 0x00 /* RX: copy of the descriptor's length and status */
+#define STATUS_RX_CSUM 0x08		  /* RX: ones' complement sum of the frame after the Ethernet header */
+#define STATUS_TX_CSUM_INFO 0x30  /* TX: where the MAC sums from and puts the checksum */
+#define STATUS_RX_CSUM_MASK 0xFFFF
+#define STATUS_TX_CSUM_START_SHIFT 16
+#define STATUS_TX_CSUM_PROTO_UDP 0x8000
+#define STATUS_TX_CSUM_LV 0x80000000
 
 #define GENET_UMAC_OFF 0x0800
 #define UMAC_MIB_CTRL (GENET_UMAC_OFF + 0x580)
+/* MIB counters, one 32-bit register each in the order of the GENET_MIB_* indexes */
+#define UMAC_MIB_RX (GENET_UMAC_OFF + 0x400)   /* GENET_MIB_RX_64 to GENET_MIB_RX_CRC_MATCH */
+#define UMAC_MIB_TX (GENET_UMAC_OFF + 0x480)   /* GENET_MIB_TX_64 to GENET_MIB_TX_UNICAST */
+#define UMAC_MIB_RUNT (GENET_UMAC_OFF + 0x500) /* GENET_MIB_RX_RUNTS to GENET_MIB_RX_RUNT_BYTES */
 #define UMAC_MAX_FRAME_LEN (GENET_UMAC_OFF + 0x014)
 #define UMAC_MAC0 (GENET_UMAC_OFF + 0x00c)
 #define UMAC_MAC1 (GENET_UMAC_OFF + 0x010)
@@ -41,6 +67,21 @@
 #define UMAC_MDF_CTRL (GENET_UMAC_OFF + 0x650)
 #define UMAC_MDF_ADDR (GENET_UMAC_OFF + 0x654)
 
+/* Hardware Filter Block, GENET v5 layout */
+#define GENET_HFB_OFF 0x8000
+#define GENET_HFB_REG_OFF 0xfc00
+#define HFB_CTRL (GENET_HFB_REG_OFF + 0x00)
+#define HFB_FLT_ENABLE (GENET_HFB_REG_OFF + 0x04) /* Filters 32-47, then 0-31 in the next word */
+#define HFB_FLT_LEN (GENET_HFB_REG_OFF + 0x1c)	  /* Byte per filter, last filter first */
+#define RBUF_HFB_EN BIT(0)
+#define HFB_FILTER_CNT 48
+#define HFB_FILTER_SIZE 128 /* Words of 2 frame bytes each */
+#define HFB_MASK_BYTES (0xf << 16)
+#define HFB_MASK_HI_BYTE (0xc << 16) /* First frame byte of the word only */
+#define HFB_MASK_LO_BYTE (0x3 << 16) /* Second frame byte of the word only */
+/* Ring frames matched by a discard filter are steered to; it is never enabled. Dropping there is unverified, see the Hardware Filter Block comment in bcmgenet.c */
+#define HFB_DISCARD_Q 15
+
 #define MIB_RESET_RX BIT(0)
 #define MIB_RESET_RUNT BIT(1)
 #define MIB_RESET_TX BIT(2)
@@ -52,6 +93,15 @@
 
 #define DEFAULT_Q 0x10
 
+/* Priority RX ring for ARP and ICMP, it takes the first descriptors */
+#define RX_PRIO_Q 0
+#define RX_PRIO_DESCS 32
+#define RX_PRIO_COALESCE_FRAMES 1
+
+/* Priority TX ring for latency sensitive writes, it takes the first descriptors */
+#define TX_PRIO_Q 0
+#define TX_PRIO_DESCS 32
+
 /* Body(1500) + EH_SIZE(14) + VLANTAG(4) + BRCMTAG(6) + FCS(4) = 1528.
  * 1536 is multiple of 256 bytes
  */
@@ -115,25 +165,39 @@
  * we merge the common fields and just prefix with T/D the registers
  * having different meaning depending on the direction
  */
-#define TDMA_RING_REG_BASE \
-	(GENET_TDMA_REG_OFF + DEFAULT_Q * DMA_RING_SIZE)
-#define TDMA_READ_PTR (TDMA_RING_REG_BASE + 0x00)
-#define TDMA_CONS_INDEX (TDMA_RING_REG_BASE + 0x08)
-#define TDMA_PROD_INDEX (TDMA_RING_REG_BASE + 0x0c)
+/* Register block of TX ring q, and the registers only TX rings have */
+#define TDMA_RING_REG(q) (GENET_TDMA_REG_OFF + (q) * DMA_RING_SIZE)
+#define TDMA_RING_READ_PTR 0x00
+#define TDMA_RING_CONS_INDEX 0x08
+#define TDMA_RING_PROD_INDEX 0x0c
+#define TDMA_RING_FLOW_PERIOD 0x28
+#define TDMA_RING_WRITE_PTR 0x2c
+
+#define TDMA_RING_REG_BASE TDMA_RING_REG(DEFAULT_Q)
+#define TDMA_READ_PTR (TDMA_RING_REG_BASE + TDMA_RING_READ_PTR)
+#define TDMA_CONS_INDEX (TDMA_RING_REG_BASE + TDMA_RING_CONS_INDEX)
+#define TDMA_PROD_INDEX (TDMA_RING_REG_BASE + TDMA_RING_PROD_INDEX)
 #define DMA_RING_BUF_SIZE 0x10
 #define DMA_START_ADDR 0x14
 #define DMA_END_ADDR 0x1c
 #define DMA_MBUF_DONE_THRESH 0x24
-#define TDMA_FLOW_PERIOD (TDMA_RING_REG_BASE + 0x28)
-#define TDMA_WRITE_PTR (TDMA_RING_REG_BASE + 0x2c)
-
-#define RDMA_RING_REG_BASE \
-	(GENET_RDMA_REG_OFF + DEFAULT_Q * DMA_RING_SIZE)
-#define RDMA_WRITE_PTR (RDMA_RING_REG_BASE + 0x00)
-#define RDMA_PROD_INDEX (RDMA_RING_REG_BASE + 0x08)
-#define RDMA_CONS_INDEX (RDMA_RING_REG_BASE + 0x0c)
-#define RDMA_XON_XOFF_THRESH (RDMA_RING_REG_BASE + 0x28)
-#define RDMA_READ_PTR (RDMA_RING_REG_BASE + 0x2c)
+#define TDMA_FLOW_PERIOD (TDMA_RING_REG_BASE + TDMA_RING_FLOW_PERIOD)
+#define TDMA_WRITE_PTR (TDMA_RING_REG_BASE + TDMA_RING_WRITE_PTR)
+
+/* Register block of RX ring q, and the registers only RX rings have */
+#define RDMA_RING_REG(q) (GENET_RDMA_REG_OFF + (q) * DMA_RING_SIZE)
+#define RDMA_RING_WRITE_PTR 0x00
+#define RDMA_RING_PROD_INDEX 0x08
+#define RDMA_RING_CONS_INDEX 0x0c
+#define RDMA_RING_XON_XOFF_THRESH 0x28
+#define RDMA_RING_READ_PTR 0x2c
+
+#define RDMA_RING_REG_BASE RDMA_RING_REG(DEFAULT_Q)
+#define RDMA_WRITE_PTR (RDMA_RING_REG_BASE + RDMA_RING_WRITE_PTR)
+#define RDMA_PROD_INDEX (RDMA_RING_REG_BASE + RDMA_RING_PROD_INDEX)
+#define RDMA_CONS_INDEX (RDMA_RING_REG_BASE + RDMA_RING_CONS_INDEX)
+#define RDMA_XON_XOFF_THRESH (RDMA_RING_REG_BASE + RDMA_RING_XON_XOFF_THRESH)
+#define RDMA_READ_PTR (RDMA_RING_REG_BASE + RDMA_RING_READ_PTR)
 
 #define TDMA_REG_BASE (GENET_TDMA_REG_OFF + DMA_RINGS_SIZE)
 #define RDMA_REG_BASE (GENET_RDMA_REG_OFF + DMA_RINGS_SIZE)
@@ -145,6 +209,9 @@
 #define DMA_PRIORITY_0 0x30
 #define DMA_PRIORITY_1 0x34
 #define DMA_PRIORITY_2 0x38
+/* 5 bit arbiter priority of ring q, 6 rings per DMA_PRIORITY_x register, lower values go first */
+#define DMA_PRIO_REG_INDEX(q) ((q) / 6)
+#define DMA_PRIO_REG_SHIFT(q) (((q) % 6) * 5)
 
 #define DMA_RING0_TIMEOUT 0x2C
 #define DMA_RING1_TIMEOUT 0x30
@@ -188,6 +255,12 @@
 #define TX_TOTAL_BUFSIZE (RX_BUF_LENGTH * TX_DESCS)
 #define RX_BUF_OFFSET 2
 
+/* Zero-copy RX: only this many descriptors are handed to the hardware at a time,
+ * so that a stack buffer bound on refill is filled within a few frames.
+ * Stack buffers are expected to hold RawMTU bytes, UMAC_MAX_FRAME_LEN is lowered to match. */
+#define RX_DMA_WINDOW 32
+#define RX_DMA_BUF_LENGTH (ETH_DATA_LEN + ETH_HLEN + VLAN_HLEN)
+
 /* Rx Specific Dma descriptor bits */
 #define DMA_RX_CHK_V3PLUS		0x8000
 #define DMA_RX_CHK_V12			0x1000
@@ -250,6 +323,8 @@
 #define UMAC_IRQ1_TX_INTR_MASK		0xFFFF
 #define UMAC_IRQ1_RX_INTR_MASK		0xFFFF
 #define UMAC_IRQ1_RX_INTR_SHIFT		16
+#define UMAC_IRQ1_RX_PRIO		(1 << (RX_PRIO_Q + UMAC_IRQ1_RX_INTR_SHIFT))
+#define UMAC_IRQ1_TX_PRIO		(1 << TX_PRIO_Q)
 
 #define GENMASK(h, l) \
 	(((~0UL) << (l)) & (~0UL >> (sizeof(ULONG) * CHAR_BIT - 1 - (h))))
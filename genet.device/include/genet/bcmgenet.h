@@ -4,17 +4,43 @@
 
 #include <exec/types.h>
 
+struct Opener;
+struct bcmgenet_rx_ring;
+struct bcmgenet_tx_ring;
+
 int bcmgenet_eth_probe(struct GenetUnit *unit);
 int bcmgenet_gmac_eth_start(struct GenetUnit *unit);
 void bcmgenet_gmac_eth_stop(struct GenetUnit *unit);
 int bcmgenet_set_coalesce(struct GenetUnit *unit, ULONG tx_max_coalesced_frames, ULONG rx_max_coalesced_frames, ULONG rx_coalesce_usecs);
 void bcmgenet_set_rx_mode(struct GenetUnit *unit); /* Updates PROMISC flag and sets up MDF if possible */
+void bcmgenet_hfb_init(struct GenetUnit *unit);
+void bcmgenet_hfb_discard(struct GenetUnit *unit, UWORD packetType);
+void bcmgenet_hfb_accept(struct GenetUnit *unit, UWORD packetType); /* 0 accepts all types again */
+void bcmgenet_mib_harvest(struct GenetUnit *unit); /* Folds the MIB counters into internalStats, called periodically */
 
 /* RX functions */
-int bcmgenet_gmac_eth_rx(struct GenetUnit *unit, unsigned int budget);
+int bcmgenet_gmac_eth_rx(struct GenetUnit *unit, struct bcmgenet_rx_ring *ring, unsigned int budget);
+void bcmgenet_rx_dma_unbind(struct GenetUnit *unit, struct Opener *opener);
+void bcmgenet_rx_moderate(struct GenetUnit *unit, ULONG interval_ms); /* Samples the RX rate and retunes coalescing, called periodically */
+void bcmgenet_rx_moderate_backlog(struct GenetUnit *unit);
+
+/* Internet checksum: ones' complement sum of big endian words, folded to 16 bits */
+ULONG bcmgenet_csum_partial(const UBYTE *data, ULONG length, ULONG sum);
+UWORD bcmgenet_csum_fold(ULONG sum);
 
 /* TX functions */
 int bcmgenet_xmit(struct IOSana2Req *io, struct GenetUnit *unit);
+void bcmgenet_tx_enqueue(struct GenetUnit *unit, struct IOSana2Req *io); /* CMD_WRITE/S2_BROADCAST from any task */
+void bcmgenet_tx_lock(struct GenetUnit *unit);							  /* Obtains tx_ring_sem, nests */
+BOOL bcmgenet_tx_trylock(struct GenetUnit *unit);						  /* Attempts tx_ring_sem, nests */
+void bcmgenet_tx_unlock(struct GenetUnit *unit);						  /* Releases tx_ring_sem */
+void bcmgenet_tx_batch_begin(struct GenetUnit *unit);
+void bcmgenet_tx_batch_end(struct GenetUnit *unit);
+void bcmgenet_tx_backlog_drain(struct GenetUnit *unit);
+void bcmgenet_tx_backlog_flush(struct GenetUnit *unit);
 unsigned int bcmgenet_tx_reclaim(struct GenetUnit *unit, unsigned int budget);
+void bcmgenet_tx_reclaim_lazy(struct GenetUnit *unit); /* TX_LAZY_RECLAIM, from the RX bottom half */
+BOOL bcmgenet_tx_watchdog(struct GenetUnit *unit);	   /* TX_LAZY_RECLAIM, FALSE once nothing is left in flight */
+void bcmgenet_tx_shape_set(struct bcmgenet_tx_ring *ring, ULONG rate, ULONG burst); /* tx_ring_sem held */
 
 #endif
\ No newline at end of file
@@ -1,75 +1,132 @@
-// SPDX-License-Identifier: GPL-2.0+
-#ifdef __INTELLISENSE__
-#include <clib/exec_protos.h>
-#else
-#include <proto/exec.h>
-#endif
-
-#include <compat.h>
-#include <debug.h>
-#include <genet/bcmgenet-regs.h>
-#include <device.h>
-
-/*
- * IRQ1 is currently unsused, as it only contains per-priority queue RX/TX interrupts.
- * We're not using priority queues, so these are not generated.
- */
-
-void bcmgenet_irq0_enable(struct GenetUnit *unit, ULONG irq_mask)
-{
-	writel(irq_mask,
-		   (ULONG)unit->genetBase + GENET_INTRL2_0_OFF + INTRL2_CPU_MASK_CLEAR);
-}
-
-void bcmgenet_irq0_disable(struct GenetUnit *unit, ULONG irq_mask)
-{
-	writel(irq_mask,
-		   (ULONG)unit->genetBase + GENET_INTRL2_0_OFF + INTRL2_CPU_MASK_SET);
-}
-
-void bcmgenet_intr_disable(struct GenetUnit *unit)
-{
-	/* Mask all interrupts.*/
-	writel(0xFFFFFFFF,
-		   (ULONG)unit->genetBase + GENET_INTRL2_0_OFF + INTRL2_CPU_MASK_SET);
-	writel(0xFFFFFFFF,
-		   (ULONG)unit->genetBase + GENET_INTRL2_0_OFF + INTRL2_CPU_CLEAR);
-	writel(0xFFFFFFFF,
-		   (ULONG)unit->genetBase + GENET_INTRL2_1_OFF + INTRL2_CPU_MASK_SET);
-	writel(0xFFFFFFFF,
-		   (ULONG)unit->genetBase + GENET_INTRL2_1_OFF + INTRL2_CPU_CLEAR);
-}
-
-/* bcmgenet_isr0: handle other stuff */
-void bcmgenet_isr0(struct ExecBase *SysBase asm("a6"), struct GenetUnit *unit asm("a1"), ULONG irq asm("d0"))
-{
-	(void)irq;
-
-	/* Read irq status */
-	ULONG status = readl((ULONG)unit->genetBase + GENET_INTRL2_0_OFF + INTRL2_CPU_STAT) &
-				   ~readl((ULONG)unit->genetBase + GENET_INTRL2_0_OFF + INTRL2_CPU_MASK_STATUS);
-
-	if (status & UMAC_IRQ_TXDMA_DONE)
-	{
-		bcmgenet_tx_reclaim(unit, genetConfig.budget);
-	}
-
-	/* Disable interrupts so that we're not flooded until bottom-half catches up */
-	if (status & UMAC_IRQ_RXDMA_DONE)
-		bcmgenet_irq0_disable(unit, UMAC_IRQ_RXDMA_DONE);
-
-	/* clear interrupts */
-	writel(status, (ULONG)unit->genetBase + GENET_INTRL2_0_OFF + INTRL2_CPU_CLEAR);
-
-	// if (bcmgenet_has_mdio_intr(priv) && status & UMAC_IRQ_MDIO_EVENT)
-	// 	wake_up(&priv->wq);
-	KprintfH("[genet] %s: IRQ0 status: 0x%08lX unit: 0x%08lx\n", __func__, status, (ULONG)unit);
-
-	status &= ~UMAC_IRQ_TXDMA_DONE;
-	if (status)
-	{
-		/* Save irq status for bottom-half processing. */
-		unit->irq0_status |= status;
-		Signal(unit->task, 1UL << unit->irq0_signal);
-	}
-}
+// SPDX-License-Identifier: GPL-2.0+
+#ifdef __INTELLISENSE__
+#include <clib/exec_protos.h>
+#else
+#include <proto/exec.h>
+#endif
+
+#include <compat.h>
+#include <debug.h>
+#include <genet/bcmgenet-regs.h>
+#include <device.h>
+
+/*
+ * IRQ1 only carries the per-ring interrupts of the priority queues. Of these
+ * only the RX and TX priority rings are used, when enabled.
+ */
+
+void bcmgenet_irq0_enable(struct GenetUnit *unit, ULONG irq_mask)
+{
+	writel(irq_mask,
+		   (ULONG)unit->genetBase + GENET_INTRL2_0_OFF + INTRL2_CPU_MASK_CLEAR);
+}
+
+void bcmgenet_irq0_disable(struct GenetUnit *unit, ULONG irq_mask)
+{
+	writel(irq_mask,
+		   (ULONG)unit->genetBase + GENET_INTRL2_0_OFF + INTRL2_CPU_MASK_SET);
+}
+
+void bcmgenet_irq1_enable(struct GenetUnit *unit, ULONG irq_mask)
+{
+	writel(irq_mask,
+		   (ULONG)unit->genetBase + GENET_INTRL2_1_OFF + INTRL2_CPU_MASK_CLEAR);
+}
+
+void bcmgenet_irq1_disable(struct GenetUnit *unit, ULONG irq_mask)
+{
+	writel(irq_mask,
+		   (ULONG)unit->genetBase + GENET_INTRL2_1_OFF + INTRL2_CPU_MASK_SET);
+}
+
+void bcmgenet_intr_disable(struct GenetUnit *unit)
+{
+	/* Mask all interrupts.*/
+	writel(0xFFFFFFFF,
+		   (ULONG)unit->genetBase + GENET_INTRL2_0_OFF + INTRL2_CPU_MASK_SET);
+	writel(0xFFFFFFFF,
+		   (ULONG)unit->genetBase + GENET_INTRL2_0_OFF + INTRL2_CPU_CLEAR);
+	writel(0xFFFFFFFF,
+		   (ULONG)unit->genetBase + GENET_INTRL2_1_OFF + INTRL2_CPU_MASK_SET);
+	writel(0xFFFFFFFF,
+		   (ULONG)unit->genetBase + GENET_INTRL2_1_OFF + INTRL2_CPU_CLEAR);
+}
+
+/* Interrupts per second since the last call, with coalescing this is what a frame rate costs */
+void bcmgenet_irq_sample(struct GenetUnit *unit, ULONG interval_ms)
+{
+	ULONG interrupts = unit->internalStats.interrupts;
+
+	if (interval_ms == 0)
+		return;
+
+	/* Statistics are cleared on S2_ONLINE */
+	if (interrupts < unit->irq_sample)
+		unit->irq_sample = 0;
+
+	unit->irqs_per_sec = (interrupts - unit->irq_sample) * 1000 / interval_ms;
+	unit->irq_sample = interrupts;
+}
+
+/* bcmgenet_isr0: handle other stuff */
+void bcmgenet_isr0(struct ExecBase *SysBase asm("a6"), struct GenetUnit *unit asm("a1"), ULONG irq asm("d0"))
+{
+	(void)irq;
+
+	/* Read irq status */
+	ULONG status = readl((ULONG)unit->genetBase + GENET_INTRL2_0_OFF + INTRL2_CPU_STAT) &
+				   ~readl((ULONG)unit->genetBase + GENET_INTRL2_0_OFF + INTRL2_CPU_MASK_STATUS);
+
+	/* Disable interrupts so that we're not flooded until bottom-half catches up.
+	 * Completed writes are replied there too, not from interrupt context. */
+	if (status & (UMAC_IRQ_RXDMA_DONE | UMAC_IRQ_TXDMA_DONE))
+		bcmgenet_irq0_disable(unit, status & (UMAC_IRQ_RXDMA_DONE | UMAC_IRQ_TXDMA_DONE));
+
+	/* clear interrupts */
+	writel(status, (ULONG)unit->genetBase + GENET_INTRL2_0_OFF + INTRL2_CPU_CLEAR);
+
+	// if (bcmgenet_has_mdio_intr(priv) && status & UMAC_IRQ_MDIO_EVENT)
+	// 	wake_up(&priv->wq);
+	KprintfH("[genet] %s: IRQ0 status: 0x%08lX unit: 0x%08lx\n", __func__, status, (ULONG)unit);
+	Trace(unit, GENET_TRACE_IRQ0, status, 0);
+
+	if (status)
+	{
+		unit->internalStats.interrupts++;
+		if (unlikely(status & UMAC_IRQ_TBUF_UNDERRUN))
+			unit->internalStats.tx_underruns++;
+		if (unlikely(genetConfig.latency_stats) && (status & UMAC_IRQ_RXDMA_DONE) && unit->lat_irq == 0)
+			unit->lat_irq = (SystemClock() - 1) | 1; /* Never 0, never ahead of the clock */
+
+		/* Save irq status for bottom-half processing. */
+		unit->irq0_status |= status;
+		Signal(unit->task, 1UL << unit->irq0_signal);
+	}
+}
+
+/* bcmgenet_isr1: priority rings RX and TX */
+void bcmgenet_isr1(struct ExecBase *SysBase asm("a6"), struct GenetUnit *unit asm("a1"), ULONG irq asm("d0"))
+{
+	(void)irq;
+
+	ULONG status = readl((ULONG)unit->genetBase + GENET_INTRL2_1_OFF + INTRL2_CPU_STAT) &
+				   ~readl((ULONG)unit->genetBase + GENET_INTRL2_1_OFF + INTRL2_CPU_MASK_STATUS);
+
+	/* Masked until the bottom-half has emptied the ring, or replied the writes */
+	if (status & (UMAC_IRQ1_RX_PRIO | UMAC_IRQ1_TX_PRIO))
+		bcmgenet_irq1_disable(unit, status & (UMAC_IRQ1_RX_PRIO | UMAC_IRQ1_TX_PRIO));
+
+	writel(status, (ULONG)unit->genetBase + GENET_INTRL2_1_OFF + INTRL2_CPU_CLEAR);
+
+	KprintfH("[genet] %s: IRQ1 status: 0x%08lX unit: 0x%08lx\n", __func__, status, (ULONG)unit);
+	Trace(unit, GENET_TRACE_IRQ1, status, 0);
+
+	if (status)
+	{
+		unit->internalStats.interrupts++;
+		if (unlikely(genetConfig.latency_stats) && (status & UMAC_IRQ1_RX_PRIO) && unit->lat_irq == 0)
+			unit->lat_irq = (SystemClock() - 1) | 1; /* Never 0, never ahead of the clock */
+		unit->irq1_status |= status;
+		Signal(unit->task, 1UL << unit->irq0_signal);
+	}
+}
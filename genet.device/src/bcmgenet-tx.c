@@ -15,6 +15,7 @@
 #include <device.h>
 #include <runtime_config.h>
 
+#include <devices/genet.h>
 #include <genet/bcmgenet.h>
 #include <genet/bcmgenet-regs.h>
 #include <genet/bcmgenet-irq.h>
@@ -28,8 +29,10 @@ static inline void dmadesc_set(APTR descriptor_address, APTR addr, ULONG val)
 
 static inline struct enet_cb *bcmgenet_get_txcb(struct bcmgenet_tx_ring *ring)
 {
-	struct enet_cb *tx_cb_ptr = &ring->tx_control_block[ring->write_ptr++];
-	KprintfH("[genet] %s: tx_cb_ptr 0x%lx, write_ptr %ld\n", __func__, tx_cb_ptr, ring->write_ptr - 1);
+	struct enet_cb *tx_cb_ptr = &ring->tx_control_block[ring->write_ptr];
+	KprintfH("[genet] %s: tx_cb_ptr 0x%lx, write_ptr %ld\n", __func__, tx_cb_ptr, ring->write_ptr);
+	if (++ring->write_ptr == ring->size)
+		ring->write_ptr = 0;
 	return tx_cb_ptr;
 }
 
@@ -49,16 +52,18 @@ static inline struct IOSana2Req *bcmgenet_free_tx_cb(struct enet_cb *cb)
 	return NULL;
 }
 
-/* Unlocked version of the reclaim routine */
-unsigned int bcmgenet_tx_reclaim(struct GenetUnit *unit, unsigned int budget)
+static inline UWORD bcmgenet_tx_free_bds(struct bcmgenet_tx_ring *ring)
 {
-	struct bcmgenet_tx_ring *ring = &unit->tx_ring;
+	return ring->size - ((ring->tx_prod_index - ring->tx_cons_index) & DMA_P_INDEX_MASK);
+}
 
+static unsigned int bcmgenet_tx_ring_reclaim(struct GenetUnit *unit, struct bcmgenet_tx_ring *ring, unsigned int budget)
+{
 	if (budget == 0U)
 		return 0;
 
 	/* Compute how many buffers are transmitted since last xmit call */
-	UWORD tx_cons_index = readl((ULONG)unit->genetBase + TDMA_CONS_INDEX) & DMA_C_INDEX_MASK;
+	UWORD tx_cons_index = readl(ring->regs + TDMA_RING_CONS_INDEX) & DMA_C_INDEX_MASK;
 	UWORD txbds_ready = (tx_cons_index - ring->tx_cons_index) & DMA_C_INDEX_MASK;
 
 	/* Reclaim transmitted buffers */
@@ -67,20 +72,30 @@ unsigned int bcmgenet_tx_reclaim(struct GenetUnit *unit, unsigned int budget)
 	unsigned int pkts_compl = 0;
 	while (txbds_processed < txbds_ready && pkts_compl < budget)
 	{
-		struct IOSana2Req *io = bcmgenet_free_tx_cb(&ring->tx_control_block[ring->clean_ptr]);
+		struct enet_cb *cb = &ring->tx_control_block[ring->clean_ptr];
+		struct IOSana2Req *io = bcmgenet_free_tx_cb(cb);
 		++txbds_processed;
-		++ring->clean_ptr;
+		if (++ring->clean_ptr == ring->size)
+			ring->clean_ptr = 0;
 
 		if (io)
 		{
 			pkts_compl++;
 			bytes_compl += io->ios2_DataLength;
+			if (unlikely(genetConfig.latency_stats))
+			{
+				ULONG now = SystemClock();
+				LatencyRecord(unit, GENET_LATENCY_TX_COMPLETE, cb->stamp, now);
+				LatencyRecord(unit, GENET_LATENCY_TX_TOTAL, cb->taken, now);
+			}
 			KprintfH("[genet] %s: Reclaimed tx buffer 0x%lx, length %ld\n", __func__, io, io->ios2_DataLength);
 			ReplyMsg((struct Message *)io);
 		}
 	}
 
 	ring->tx_cons_index = (ring->tx_cons_index + txbds_processed) & DMA_C_INDEX_MASK;
+	if (pkts_compl)
+		Trace(unit, GENET_TRACE_TX_RECLAIM, ring->index, pkts_compl);
 
 	unit->internalStats.tx_packets += pkts_compl;
 	unit->internalStats.tx_bytes += bytes_compl;
@@ -88,133 +103,736 @@ unsigned int bcmgenet_tx_reclaim(struct GenetUnit *unit, unsigned int budget)
 	return pkts_compl;
 }
 
-int bcmgenet_xmit(struct IOSana2Req *io, struct GenetUnit *unit)
+/* Unlocked version of the reclaim routine, priority ring first */
+unsigned int bcmgenet_tx_reclaim(struct GenetUnit *unit, unsigned int budget)
+{
+	unsigned int pkts_compl = 0;
+
+	if (unit->tx_prio_ring.size)
+		pkts_compl = bcmgenet_tx_ring_reclaim(unit, &unit->tx_prio_ring, budget);
+
+	return pkts_compl + bcmgenet_tx_ring_reclaim(unit, &unit->tx_ring, budget - pkts_compl);
+}
+
+static inline BOOL bcmgenet_tx_in_flight(struct GenetUnit *unit)
+{
+	return unit->tx_ring.tx_prod_index != unit->tx_ring.tx_cons_index ||
+		   unit->tx_prio_ring.tx_prod_index != unit->tx_prio_ring.tx_cons_index ||
+		   unit->tx_ring.backlog_head != unit->tx_ring.backlog_tail;
+}
+
+/*
+ * TX_LAZY_RECLAIM: the completion interrupts stay masked, finished writes
+ * are replied by the next bcmgenet_xmit(), the RX bottom half, or the
+ * reclaim timer of the unit task. That one runs while frames are in
+ * flight, it bounds how long a reply waits when nothing else comes by.
+ */
+void bcmgenet_tx_reclaim_lazy(struct GenetUnit *unit)
+{
+	if (!unit->tx_watchdog || !bcmgenet_tx_trylock(unit))
+		return;
+
+	bcmgenet_tx_reclaim(unit, TX_DESCS);
+	bcmgenet_tx_backlog_drain(unit);
+	bcmgenet_tx_unlock(unit);
+}
+
+BOOL bcmgenet_tx_watchdog(struct GenetUnit *unit)
+{
+	bcmgenet_tx_lock(unit);
+	bcmgenet_tx_reclaim(unit, TX_DESCS);
+	bcmgenet_tx_backlog_drain(unit);
+	/* Armed again by the next write */
+	unit->tx_watchdog = bcmgenet_tx_in_flight(unit);
+	BOOL busy = unit->tx_watchdog;
+	bcmgenet_tx_unlock(unit);
+	return busy;
+}
+
+/* Hand everything queued so far to the hardware */
+static inline void bcmgenet_tx_kick(struct bcmgenet_tx_ring *ring)
+{
+	writel(ring->tx_prod_index, ring->regs + TDMA_RING_PROD_INDEX);
+	ring->tx_pending = 0;
+}
+
+/* Doorbell for frames a batch left queued */
+static inline void bcmgenet_tx_kick_pending(struct GenetUnit *unit)
+{
+	if (unit->tx_prio_ring.tx_pending)
+	{
+		KprintfH("[genet] %s: %ld priority frames, tx_prod_index %ld\n", __func__, unit->tx_prio_ring.tx_pending, unit->tx_prio_ring.tx_prod_index);
+		bcmgenet_tx_kick(&unit->tx_prio_ring);
+	}
+	if (unit->tx_ring.tx_pending)
+	{
+		KprintfH("[genet] %s: %ld frames, tx_prod_index %ld\n", __func__, unit->tx_ring.tx_pending, unit->tx_ring.tx_prod_index);
+		bcmgenet_tx_kick(&unit->tx_ring);
+	}
+}
+
+/*
+ * Batched submission: between begin and end the ring stays locked and
+ * bcmgenet_xmit() only fills descriptors, the doorbell is rung once at the
+ * end, or every TX_DOORBELL_FRAMES frames so a long burst does not keep the
+ * hardware waiting for the first of them.
+ */
+void bcmgenet_tx_batch_begin(struct GenetUnit *unit)
 {
-	KprintfH("[genet] %s: unit %ld, io 0x%lx, flags 0x%lx\n", __func__, unit->unitNumber, io, io->ios2_Req.io_Flags);
-	struct Opener *opener = io->ios2_BufferManagement;
 	struct bcmgenet_tx_ring *ring = &unit->tx_ring;
-	ObtainSemaphore(&ring->tx_ring_sem);
 
-	KprintfH("[genet] %s: pre: tx_prod_index %ld, write_ptr %ld\n", __func__, ring->tx_prod_index, ring->write_ptr);
+	bcmgenet_tx_lock(unit);
+	ring->tx_batch = TRUE;
+}
+
+/*
+ * Writes of other tasks come in through tx_intake while tx_ring_sem is
+ * taken. Whoever holds it sends them, oldest first and behind a single
+ * doorbell, before letting go of it.
+ */
+static void bcmgenet_tx_intake_send(struct GenetUnit *unit)
+{
+	struct bcmgenet_tx_ring *ring = &unit->tx_ring;
+	struct IOSana2Req *io = __atomic_exchange_n(&unit->tx_intake, NULL, __ATOMIC_ACQUIRE);
+	if (io == NULL)
+		return;
 
-	UWORD free_bds = TX_DESCS - ((ring->tx_prod_index - ring->tx_cons_index) & DMA_P_INDEX_MASK);
-	UBYTE bds_required = (io->ios2_Req.io_Flags & SANA2IOF_RAW) ? 1 : 2;
-	if (unlikely(free_bds <= bds_required))
+	struct IOSana2Req *oldest = NULL;
+	while (io)
 	{
-		KprintfH("[genet] %s: Not enough free BDs\n", __func__);
-		goto ret_error;
+		struct IOSana2Req *next = (struct IOSana2Req *)io->ios2_Req.io_Message.mn_Node.ln_Succ;
+		io->ios2_Req.io_Message.mn_Node.ln_Succ = (struct Node *)oldest;
+		oldest = io;
+		io = next;
 	}
 
-	if (unlikely(io->ios2_DataLength == 0))
+	BOOL batch = ring->tx_batch;
+	ring->tx_batch = TRUE;
+	while ((io = oldest))
 	{
-		KprintfH("[genet] %s: No data to send\n", __func__);
-		goto ret_error;
+		oldest = (struct IOSana2Req *)io->ios2_Req.io_Message.mn_Node.ln_Succ;
+		ProcessCommand(io);
 	}
+	ring->tx_batch = batch;
+	if (!batch)
+		bcmgenet_tx_kick_pending(unit);
+}
+
+/*
+ * tx_ring_sem is taken through these, they count how deep its owner nests
+ * so only the outermost bcmgenet_tx_unlock() sends the intake. Only the
+ * owner touches the count.
+ */
+void bcmgenet_tx_lock(struct GenetUnit *unit)
+{
+	ObtainSemaphore(&unit->tx_ring.tx_ring_sem);
+	unit->tx_ring.tx_lock_depth++;
+}
+
+BOOL bcmgenet_tx_trylock(struct GenetUnit *unit)
+{
+	if (!AttemptSemaphore(&unit->tx_ring.tx_ring_sem))
+		return FALSE;
+	unit->tx_ring.tx_lock_depth++;
+	return TRUE;
+}
+
+void bcmgenet_tx_unlock(struct GenetUnit *unit)
+{
+	struct SignalSemaphore *sem = &unit->tx_ring.tx_ring_sem;
 
-	if (likely((io->ios2_Req.io_Flags & SANA2IOF_RAW) == 0))
+	/* Nested, the outermost release sends the intake */
+	if (unit->tx_ring.tx_lock_depth > 1)
 	{
-		KprintfH("[genet] %s: adding ethernet header\n", __func__);
+		unit->tx_ring.tx_lock_depth--;
+		ReleaseSemaphore(sem);
+		return;
+	}
 
-		struct enet_cb *tx_cb_ptr = bcmgenet_get_txcb(ring);
-		UBYTE *ptr = (UBYTE *)tx_cb_ptr->internal_buffer;
-		tx_cb_ptr->data_buffer = NULL;
-		tx_cb_ptr->ioReq = NULL;
+	do
+	{
+		while (__atomic_load_n(&unit->tx_intake, __ATOMIC_ACQUIRE))
+			bcmgenet_tx_intake_send(unit);
+		unit->tx_ring.tx_lock_depth = 0;
+		ReleaseSemaphore(sem);
+		/* A write pushed after the last look found the semaphore still taken, nobody else will send it */
+	} while (__atomic_load_n(&unit->tx_intake, __ATOMIC_ACQUIRE) && bcmgenet_tx_trylock(unit));
+}
 
+/*
+ * Write from beginIO(), in the caller's task. The write is pushed onto the
+ * intake with a compare-and-swap, then sent right away if the ring is free.
+ * Otherwise the task holding it sends the write, so no caller waits for the
+ * semaphore or for a switch to the unit task.
+ */
+void bcmgenet_tx_enqueue(struct GenetUnit *unit, struct IOSana2Req *io)
+{
+	io->ios2_Req.io_Error = S2ERR_NO_ERROR;
+	io->ios2_Req.io_Flags &= ~IOF_QUICK;
+	io->ios2_Req.io_Message.mn_Node.ln_Type = NT_MESSAGE;
+	/* Can't be aborted from here on, like a write on the ring */
+	io->ios2_Req.io_Message.mn_Node.ln_Pred = NULL;
+	struct IOSana2Req *head = __atomic_load_n(&unit->tx_intake, __ATOMIC_RELAXED);
+	do
+		io->ios2_Req.io_Message.mn_Node.ln_Succ = (struct Node *)head;
+	while (!__atomic_compare_exchange_n(&unit->tx_intake, &head, io, TRUE, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+
+	if (bcmgenet_tx_trylock(unit))
+		bcmgenet_tx_unlock(unit);
+	else
+		__atomic_add_fetch(&unit->internalStats.tx_handoff, 1, __ATOMIC_RELAXED);
+}
+
+void bcmgenet_tx_batch_end(struct GenetUnit *unit)
+{
+	bcmgenet_tx_kick_pending(unit);
+	unit->tx_ring.tx_batch = FALSE;
+	bcmgenet_tx_unlock(unit);
+}
+
+/* Ethernet header of a cooked write, in front of the payload */
+static inline void bcmgenet_tx_header(struct GenetUnit *unit, struct IOSana2Req *io, UBYTE *ptr)
+{
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wstrict-aliasing"
-		// Copy destination MAC address (6 bytes)
-		*(ULONG *)&ptr[0] = *(ULONG *)&io->ios2_DstAddr[0];
-		*(UWORD *)&ptr[4] = *(UWORD *)&io->ios2_DstAddr[4];
+	// Copy destination MAC address (6 bytes)
+	*(ULONG *)&ptr[0] = *(ULONG *)&io->ios2_DstAddr[0];
+	*(UWORD *)&ptr[4] = *(UWORD *)&io->ios2_DstAddr[4];
 
-		// Copy source MAC address (6 bytes)
-		*(ULONG *)&ptr[6] = *(ULONG *)&unit->currentMacAddress[0];
-		*(UWORD *)&ptr[10] = *(UWORD *)&unit->currentMacAddress[4];
+	// Copy source MAC address (6 bytes)
+	*(ULONG *)&ptr[6] = *(ULONG *)&unit->currentMacAddress[0];
+	*(UWORD *)&ptr[10] = *(UWORD *)&unit->currentMacAddress[4];
 #pragma GCC diagnostic pop
 
-		*(UWORD *)&ptr[12] = io->ios2_PacketType;
+	*(UWORD *)&ptr[12] = io->ios2_PacketType;
+}
 
-		ULONG len_stat = (ETH_HLEN << DMA_BUFLENGTH_SHIFT) | (GENET_QTAG_MASK << DMA_TX_QTAG_SHIFT);
-		/* Note: if we ever change from DMA_TX_APPEND_CRC below we
-		 * will need to restore software padding of "runt" packets
-		 */
-		len_stat |= DMA_TX_APPEND_CRC;
-		len_stat |= DMA_SOP;
+/* Fill the next descriptor and advance our write pointer */
+static inline void bcmgenet_tx_desc(struct bcmgenet_tx_ring *ring, APTR buffer, ULONG length, ULONG flags, struct IOSana2Req *io)
+{
+	struct enet_cb *tx_cb_ptr = bcmgenet_get_txcb(ring);
+	tx_cb_ptr->data_buffer = buffer;
+	tx_cb_ptr->ioReq = io;
+
+	ULONG len_stat = (length << DMA_BUFLENGTH_SHIFT) | (GENET_QTAG_MASK << DMA_TX_QTAG_SHIFT);
+	/* Note: if we ever change from DMA_TX_APPEND_CRC below we
+	 * will need to restore software padding of "runt" packets
+	 */
+	len_stat |= DMA_TX_APPEND_CRC | flags;
+	KprintfH("[genet] %s: Setting descriptor address 0x%lx, data buffer 0x%lx, len_stat 0x%lx\n",
+			 __func__, tx_cb_ptr->descriptor_address, buffer, len_stat);
 
-		dmadesc_set(tx_cb_ptr->descriptor_address, tx_cb_ptr->internal_buffer, len_stat);
+	dmadesc_set(tx_cb_ptr->descriptor_address, buffer, len_stat);
 
-		ULONG len = ETH_HLEN;
-		CachePreDMA(tx_cb_ptr->internal_buffer, &len, DMA_ReadFromRAM);
+	ring->tx_prod_index++;
+	ring->tx_prod_index &= DMA_P_INDEX_MASK;
+}
 
-		/* Advance our write pointer */
-		ring->tx_prod_index++;
-		ring->tx_prod_index &= DMA_P_INDEX_MASK;
-		KprintfH("[genet] %s: ETH header sent type: 0x%lx dst addr: %02lx:%02lx:%02lx:%02lx:%02lx:%02lx\n", __func__, io->ios2_PacketType,
-				 io->ios2_DstAddr[0], io->ios2_DstAddr[1], io->ios2_DstAddr[2],
-				 io->ios2_DstAddr[3], io->ios2_DstAddr[4], io->ios2_DstAddr[5]);
+/*
+ * Writes that should not queue behind bulk traffic: ARP, ICMP, ICMPv6, and
+ * IP with a DSCP of TX_PRIO_DSCP or above. IPv4 also with the low delay TOS
+ * bit, which BSD derived stacks set for interactive sessions. packet points
+ * to the network header.
+ */
+static BOOL bcmgenet_tx_urgent(UWORD type, const UBYTE *packet, ULONG length)
+{
+	switch (type)
+	{
+	case 0x0806: /* ARP */
+		return TRUE;
+	case 0x0800: /* IPv4 */
+		if (length < 20)
+			return FALSE;
+		return packet[9] == 1 /* ICMP */ || (packet[1] >> 2) >= genetConfig.tx_prio_dscp || (packet[1] & 0x10);
+	case 0x86dd: /* IPv6 */
+		if (length < 40)
+			return FALSE;
+		return packet[6] == 58 /* ICMPv6 */ || (((packet[0] << 4) | (packet[1] >> 4)) & 0xff) >> 2 >= genetConfig.tx_prio_dscp;
+	default:
+		return FALSE;
 	}
+}
 
-	// Then the body from upstream
-	struct enet_cb *tx_cb_ptr = bcmgenet_get_txcb(ring);
-	tx_cb_ptr->ioReq = io;
-	/* We'll use the ln_Pred pointer to mark it is on the TX ring now and can't be aborted */
-	io->ios2_Req.io_Message.mn_Node.ln_Pred = NULL;
+/* The same for the data of a write, as the stack passed it */
+static inline BOOL bcmgenet_tx_urgent_data(struct IOSana2Req *io, const UBYTE *data, ULONG length, BOOL raw)
+{
+	if (likely(!raw))
+		return bcmgenet_tx_urgent(io->ios2_PacketType, data, length);
+	if (length < ETH_HLEN)
+		return FALSE;
+	return bcmgenet_tx_urgent(*(UWORD *)&data[12], data + ETH_HLEN, length - ETH_HLEN);
+}
 
-	if (unlikely(opener->DMACopyFromBuff) && (tx_cb_ptr->data_buffer = (APTR)opener->DMACopyFromBuff(io->ios2_Data)) != NULL)
+/* A copied write that was not looked at yet: copy just the start of it to see its headers */
+static BOOL bcmgenet_tx_peek_urgent(struct Opener *opener, struct IOSana2Req *io, BOOL raw)
+{
+	UBYTE head[ETH_HLEN + 40 + 2];
+	ULONG length = io->ios2_DataLength < sizeof(head) ? io->ios2_DataLength : sizeof(head);
+
+	if (!opener->CopyFromBuff || opener->CopyFromBuff(head, io->ios2_Data, genetConfig.use_miami_workaround ? ((length + 3) & ~3) : length) == 0)
+		return FALSE;
+	return bcmgenet_tx_urgent_data(io, head, length, raw);
+}
+
+/*
+ * GENETIOF_CHECKSUM write: the TCP or UDP checksum field holds the pseudo
+ * header sum. With the Transmit Status Block the MAC completes it, the
+ * request for that is returned. Without it the checksum is filled in here,
+ * packet being our own copy. packet points to the network header, 0 is
+ * returned for anything but unfragmented IPv4 TCP and UDP.
+ */
+static ULONG bcmgenet_tx_csum(struct GenetUnit *unit, UWORD type, UBYTE *packet, ULONG length)
+{
+	if (type != 0x0800 || length < 20)
+		return 0;
+
+	ULONG ihl = (packet[0] & 0x0f) * 4;
+	ULONG total = (packet[2] << 8) | packet[3];
+	ULONG field;
+	switch (packet[9])
+	{
+	case 6: /* TCP */
+		field = 16;
+		break;
+	case 17: /* UDP */
+		field = 6;
+		break;
+	default:
+		return 0;
+	}
+	if ((packet[0] >> 4) != 4 || ihl < 20 || total < ihl + field + 2 || total > length || (packet[6] & 0x3f) || packet[7])
+		return 0;
+
+	unit->internalStats.tx_csum++;
+	if (likely(unit->tx_status_block))
+	{
+		ULONG start = ETH_HLEN + ihl;
+		return (start << STATUS_TX_CSUM_START_SHIFT) | (start + field) | STATUS_TX_CSUM_LV |
+			   (packet[9] == 17 ? STATUS_TX_CSUM_PROTO_UDP : 0);
+	}
+
+	UWORD csum = ~bcmgenet_csum_fold(bcmgenet_csum_partial(packet + ihl, total - ihl, 0));
+	/* A UDP checksum of 0 means none */
+	if (csum == 0 && packet[9] == 17)
+		csum = 0xffff;
+	packet[ihl + field] = csum >> 8;
+	packet[ihl + field + 1] = csum;
+	return 0;
+}
+
+/* Transmit Status Block in front of a frame, buffer being 32 bit aligned */
+static inline void bcmgenet_tx_status_block(UBYTE *buffer, ULONG csum_info)
+{
+	for (ULONG i = 0; i < STATUS_BLOCK_SIZE; i += 4)
+		*(ULONG *)&buffer[i] = 0;
+	*(ULONG *)&buffer[STATUS_TX_CSUM_INFO] = LE32(csum_info);
+}
+
+/*
+ * Memory of the stack a write can be sent from as it is: one buffer from
+ * DMACopyFromBuff, or the fragments DMAGatherFromBuff hands out. Returns the
+ * number of fragments, 0 when the write has to be copied. head is how much
+ * of the packet the first fragment has to hold for the status block.
+ */
+static ULONG bcmgenet_tx_map(struct Opener *opener, struct IOSana2Req *io, struct GenetFragment *fragments, ULONG head)
+{
+	ULONG count = 0;
+	if (opener->DMACopyFromBuff && (fragments[0].gf_Data = opener->DMACopyFromBuff(io->ios2_Data)) != NULL)
+	{
+		fragments[0].gf_Length = io->ios2_DataLength;
+		count = 1;
+	}
+	else if (opener->DMAGatherFromBuff)
+	{
+		count = opener->DMAGatherFromBuff(io->ios2_Data, fragments, GENET_MAX_FRAGMENTS);
+		if (unlikely(count > GENET_MAX_FRAGMENTS))
+			return 0;
+	}
+
+	ULONG length = 0;
+	for (ULONG i = 0; i < count; i++)
 	{
-		if (unlikely(tx_cb_ptr->data_buffer <= (APTR)0x1FFFFF))
+		if (unlikely(fragments[i].gf_Data <= (APTR)0x1FFFFF))
 		{
 			KprintfH("[genet] %s: Cannot use buffers in CHIP memory, falling back to copying.\n", __func__);
-			// opener->DMACopyFromBuff = NULL; // Disable DMA copy
-			goto use_software_copy;
+			return 0;
 		}
-		KprintfH("[genet] %s: Using DMA copy from buffer 0x%lx\n", __func__, (ULONG)tx_cb_ptr->data_buffer);
-		unit->internalStats.tx_dma++;
+		if (unlikely(fragments[i].gf_Length == 0))
+			return 0;
+		length += fragments[i].gf_Length;
 	}
+	if (unlikely(count && (length != io->ios2_DataLength || fragments[0].gf_Length < head)))
+	{
+		KprintfH("[genet] %s: Fragments do not match the write, falling back to copying.\n", __func__);
+		return 0;
+	}
+	return count;
+}
+
+/* bcmgenet_tx_submit(): no room on the ring, nothing was done */
+#define TX_NO_DESCRIPTORS 2
+
+/* Preamble, SFD, FCS and inter frame gap, paid for by every frame against the rate limit */
+#define TX_WIRE_OVERHEAD (8 + 4 + 12)
+/* A rate limit never runs below a full frame of burst, nor above the line rate */
+#define TX_SHAPE_MIN_BURST (ETH_DATA_LEN + ETH_HLEN + TX_WIRE_OVERHEAD)
+#define TX_SHAPE_MAX_BURST (1UL << 24)
+#define TX_SHAPE_MAX_RATE 1000000
+
+void bcmgenet_tx_shape_set(struct bcmgenet_tx_ring *ring, ULONG rate, ULONG burst)
+{
+	if (burst < TX_SHAPE_MIN_BURST)
+		burst = TX_SHAPE_MIN_BURST;
+	else if (burst > TX_SHAPE_MAX_BURST)
+		burst = TX_SHAPE_MAX_BURST;
+
+	ring->shape_rate = rate < TX_SHAPE_MAX_RATE ? rate : TX_SHAPE_MAX_RATE;
+	ring->shape_burst = burst;
+	ring->shape_tokens = burst * 8;
+	ring->shape_stamp = SystemClock();
+}
+
+/*
+ * Rate limit of a ring, tx_ring_sem held. The bucket fills at shape_rate up
+ * to shape_burst, a frame may go while it is not empty and is paid for after
+ * it was queued, so a frame larger than what is left does not wait forever.
+ * When the ring has to wait the unit task is told how long, its shape timer
+ * drains the backlog once the tokens are back.
+ */
+static BOOL bcmgenet_tx_shape_open(struct GenetUnit *unit, struct bcmgenet_tx_ring *ring)
+{
+	if (likely(ring->shape_rate == 0))
+		return TRUE;
+
+	/* kbit/s is bits per millisecond */
+	ULONG now = SystemClock();
+	ULONG elapsed = now - ring->shape_stamp;
+	LONG burst = ring->shape_burst * 8;
+	if (elapsed >= 1000000)
+		ring->shape_tokens = burst;
 	else
+		ring->shape_tokens += (elapsed / 1000) * ring->shape_rate + (elapsed % 1000) * ring->shape_rate / 1000;
+	if (ring->shape_tokens > burst)
+		ring->shape_tokens = burst;
+	ring->shape_stamp = now;
+
+	if (ring->shape_tokens > 0)
+		return TRUE;
+
+	ULONG usecs = (ULONG)(1 - ring->shape_tokens) * 1000 / ring->shape_rate + 1;
+	Trace(unit, GENET_TRACE_TX_SHAPE, ring->index, usecs);
+	if (unit->tx_shape_usecs == 0)
+	{
+		/* From a quick write the unit task may be asleep */
+		unit->tx_shape_usecs = usecs;
+		unit->internalStats.tx_shaped++;
+		Signal(unit->task, 1UL << unit->irq0_signal);
+	}
+	else if (usecs < unit->tx_shape_usecs)
+	{
+		unit->tx_shape_usecs = usecs;
+	}
+	return FALSE;
+}
+
+static int bcmgenet_tx_error(struct GenetUnit *unit, struct IOSana2Req *io)
+{
+	unit->internalStats.tx_dropped++;
+	io->ios2_WireError = S2WERR_BUFF_ERROR;
+	io->ios2_Req.io_Error = S2ERR_NO_RESOURCES;
+	ReportEvents(unit, S2EVENT_BUFF | S2EVENT_TX | S2EVENT_SOFTWARE | S2EVENT_ERROR);
+	return COMMAND_PROCESSED;
+}
+
+/*
+ * Put one frame on a ring, tx_ring_sem held. Urgent writes go to the priority
+ * ring while it has room, everything else to the default ring. With bypass
+ * set only urgent writes are taken, the others wait for the backlog ahead of
+ * them.
+ */
+static int bcmgenet_tx_submit(struct GenetUnit *unit, struct IOSana2Req *io, BOOL bypass, ULONG taken)
+{
+	struct Opener *opener = io->ios2_BufferManagement;
+	struct bcmgenet_tx_ring *ring = &unit->tx_ring;
+	struct bcmgenet_tx_ring *prio = unit->tx_prio_ring.size ? &unit->tx_prio_ring : NULL;
+
+	KprintfH("[genet] %s: pre: tx_prod_index %ld, write_ptr %ld\n", __func__, ring->tx_prod_index, ring->write_ptr);
+
+	if (unlikely(io->ios2_DataLength == 0))
+	{
+		KprintfH("[genet] %s: No data to send\n", __func__);
+		return bcmgenet_tx_error(unit, io);
+	}
+
+	BOOL raw = (io->ios2_Req.io_Flags & SANA2IOF_RAW) != 0;
+	BOOL csum = unlikely(opener->checksum) && (io->ios2_Req.io_Flags & GENETIOF_CHECKSUM);
+	/*
+	 * The status block has to be in front of the frame, which a raw one in
+	 * the stack's buffer has no room for. A checksum filled in by software
+	 * goes into our copy, not into the stack's buffer.
+	 */
+	struct GenetFragment fragments[GENET_MAX_FRAGMENTS];
+	ULONG count = 0;
+	if (unlikely(opener->DMACopyFromBuff || opener->DMAGatherFromBuff) && !(unit->tx_status_block ? raw : csum))
+		count = bcmgenet_tx_map(opener, io, fragments, csum ? 20 : 0);
+	const UBYTE tsb = unit->tx_status_block ? STATUS_BLOCK_SIZE : 0;
+
+	/*
+	 * A copied frame is sent from one buffer, a cooked one with the header
+	 * written in front of the payload. Sent from the stack's memory, every
+	 * fragment takes a descriptor, and the header of a cooked frame one of
+	 * its own. The Transmit Status Block goes in front of the first buffer.
+	 */
+	UBYTE bds_required = count ? count + !raw : 1;
+
+	/* Urgent as far as can be told without copying the frame */
+	BOOL urgent = prio && (opener->txPriority || (!raw && io->ios2_PacketType == 0x0806) ||
+						   (count && bcmgenet_tx_urgent_data(io, fragments[0].gf_Data, fragments[0].gf_Length, raw)));
+	if (urgent && bcmgenet_tx_free_bds(prio) > bds_required && bcmgenet_tx_shape_open(unit, prio))
+	{
+		ring = prio;
+	}
+	else if (unlikely(bypass || bcmgenet_tx_free_bds(ring) <= bds_required || !bcmgenet_tx_shape_open(unit, ring)))
+	{
+		/* Only an urgent write still gets past, a copied one is not classified yet */
+		if (!prio || urgent || count || bcmgenet_tx_free_bds(prio) <= bds_required ||
+			!bcmgenet_tx_peek_urgent(opener, io, raw) || !bcmgenet_tx_shape_open(unit, prio))
+		{
+			KprintfH("[genet] %s: Not enough free BDs or over the rate limit\n", __func__);
+			return TX_NO_DESCRIPTORS;
+		}
+		ring = prio;
+	}
+
+	/* We'll use the ln_Pred pointer to mark it is on the TX ring now and can't be aborted */
+	if (likely(count == 0))
 	{
-	use_software_copy:
 		KprintfH("[genet] %s: Using software copy from buffer\n", __func__);
-		if (!opener->CopyFromBuff || opener->CopyFromBuff(tx_cb_ptr->internal_buffer, io->ios2_Data, genetConfig.use_miami_workaround ? ((io->ios2_DataLength + 3) & ~3) : io->ios2_DataLength) == 0)
+		UBYTE *buffer = (UBYTE *)ring->tx_control_block[ring->write_ptr].internal_buffer;
+		UBYTE *frame = buffer + tsb;
+		UBYTE *payload = raw ? frame : frame + ETH_HLEN;
+		if (!opener->CopyFromBuff || opener->CopyFromBuff(payload, io->ios2_Data, genetConfig.use_miami_workaround ? ((io->ios2_DataLength + 3) & ~3) : io->ios2_DataLength) == 0)
 		{
 			KprintfH("[genet] %s: Failed to copy packet data from buffer\n", __func__);
-			goto ret_error;
+			return bcmgenet_tx_error(unit, io);
+		}
+		if (likely(!raw))
+			bcmgenet_tx_header(unit, io, frame);
+
+		/*
+		 * Buffers of free control blocks are interchangeable: an urgent frame
+		 * copied for the default ring moves to the priority ring with its buffer.
+		 */
+		if (prio && ring != prio && bcmgenet_tx_free_bds(prio) > 1 &&
+			bcmgenet_tx_urgent_data(io, payload, io->ios2_DataLength, raw) && bcmgenet_tx_shape_open(unit, prio))
+		{
+			ring->tx_control_block[ring->write_ptr].internal_buffer = prio->tx_control_block[prio->write_ptr].internal_buffer;
+			prio->tx_control_block[prio->write_ptr].internal_buffer = buffer;
+			ring = prio;
 		}
-		tx_cb_ptr->data_buffer = tx_cb_ptr->internal_buffer;
+
+		ULONG csum_info = 0;
+		if (unlikely(csum))
+			csum_info = bcmgenet_tx_csum(unit, *(UWORD *)&frame[12], frame + ETH_HLEN, (payload - frame) + io->ios2_DataLength - ETH_HLEN);
+		if (unlikely(tsb))
+			bcmgenet_tx_status_block(buffer, csum_info);
+
+		ULONG len = tsb + (payload - frame) + io->ios2_DataLength;
+		io->ios2_Req.io_Message.mn_Node.ln_Pred = NULL;
+		bcmgenet_tx_desc(ring, buffer, len, DMA_SOP | DMA_EOP | (csum_info ? DMA_TX_DO_CSUM : 0), io);
+		CachePreDMA(buffer, &len, DMA_ReadFromRAM);
 		unit->internalStats.tx_copy++;
 	}
+	else
+	{
+		KprintfH("[genet] %s: Using DMA copy from %ld fragments at 0x%lx\n", __func__, count, (ULONG)fragments[0].gf_Data);
+		ULONG flags = DMA_SOP;
+		if (likely(!raw))
+		{
+			UBYTE *header = (UBYTE *)ring->tx_control_block[ring->write_ptr].internal_buffer;
+			ULONG csum_info = 0;
+			bcmgenet_tx_header(unit, io, header + tsb);
+			if (unlikely(tsb))
+			{
+				if (csum)
+					csum_info = bcmgenet_tx_csum(unit, io->ios2_PacketType, fragments[0].gf_Data, io->ios2_DataLength);
+				bcmgenet_tx_status_block(header, csum_info);
+			}
+			bcmgenet_tx_desc(ring, header, tsb + ETH_HLEN, DMA_SOP | (csum_info ? DMA_TX_DO_CSUM : 0), NULL);
+			ULONG len = tsb + ETH_HLEN;
+			CachePreDMA(header, &len, DMA_ReadFromRAM);
+			flags = 0;
+			KprintfH("[genet] %s: ETH header sent type: 0x%lx dst addr: %02lx:%02lx:%02lx:%02lx:%02lx:%02lx\n", __func__, io->ios2_PacketType,
+					 io->ios2_DstAddr[0], io->ios2_DstAddr[1], io->ios2_DstAddr[2],
+					 io->ios2_DstAddr[3], io->ios2_DstAddr[4], io->ios2_DstAddr[5]);
+		}
 
-	ULONG len_stat = (io->ios2_DataLength << DMA_BUFLENGTH_SHIFT) | (GENET_QTAG_MASK << DMA_TX_QTAG_SHIFT);
-	/* Note: if we ever change from DMA_TX_APPEND_CRC below we
-	 * will need to restore software padding of "runt" packets
-	 */
-	len_stat |= DMA_TX_APPEND_CRC;
-	if (unlikely(io->ios2_Req.io_Flags & SANA2IOF_RAW))
+		/* The write is replied when the descriptor of the last fragment is reclaimed */
+		io->ios2_Req.io_Message.mn_Node.ln_Pred = NULL;
+		for (ULONG i = 0; i < count; i++)
+		{
+			ULONG len = fragments[i].gf_Length;
+			if (i == count - 1)
+				bcmgenet_tx_desc(ring, fragments[i].gf_Data, len, flags | DMA_EOP, io);
+			else
+				bcmgenet_tx_desc(ring, fragments[i].gf_Data, len, flags, NULL);
+			CachePreDMA(fragments[i].gf_Data, &len, DMA_ReadFromRAM);
+			flags = 0;
+		}
+		unit->internalStats.tx_dma++;
+		if (count > 1)
+			unit->internalStats.tx_gather++;
+	}
+
+	if (ring == prio)
+		unit->internalStats.tx_prio++;
+	if (unlikely(genetConfig.latency_stats))
 	{
-		len_stat |= DMA_SOP;
+		/* The write is replied when the control block of its last descriptor is reclaimed */
+		struct enet_cb *cb = &ring->tx_control_block[(ring->write_ptr ? ring->write_ptr : ring->size) - 1];
+		ULONG now = SystemClock();
+		cb->stamp = now;
+		cb->taken = taken;
+		LatencyRecord(unit, GENET_LATENCY_TX_QUEUE, taken, now);
 	}
-	len_stat |= DMA_EOP;
-	KprintfH("[genet] %s: Setting descriptor address 0x%lx, data buffer 0x%lx, len_stat 0x%lx\n",
-			 __func__, tx_cb_ptr->descriptor_address, tx_cb_ptr->data_buffer, len_stat);
+	if (unlikely(unit->typeStatsCount))
+	{
+		struct TypeStats *stats = FindTypeStats(unit, io->ios2_PacketType);
+		if (stats)
+		{
+			stats->packetsSent++;
+			stats->bytesSent += io->ios2_DataLength;
+		}
+	}
+	if (unlikely(ring->shape_rate))
+		ring->shape_tokens -= (io->ios2_DataLength + (raw ? 0 : ETH_HLEN) + TX_WIRE_OVERHEAD) * 8;
+	Trace(unit, GENET_TRACE_TX_WRITE, io->ios2_DataLength, ring->index);
 
-	dmadesc_set(tx_cb_ptr->descriptor_address, tx_cb_ptr->data_buffer, len_stat);
+	if (!unit->tx_ring.tx_batch || ++ring->tx_pending >= genetConfig.tx_doorbell_frames)
+	{
+		bcmgenet_tx_kick(ring);
+		KprintfH("[genet] %s: Transmitting packet, tx_prod_index %ld\n", __func__, ring->tx_prod_index);
+	}
 
-	CachePreDMA(tx_cb_ptr->data_buffer, &io->ios2_DataLength, DMA_ReadFromRAM);
+	/* No interrupt will reply this write, have the unit task's reclaim timer running */
+	if (unlikely(genetConfig.tx_lazy_reclaim) && !unit->tx_watchdog)
+	{
+		unit->tx_watchdog = TRUE;
+		Signal(unit->task, 1UL << unit->irq0_signal);
+	}
 
-	/* Advance our write pointer */
-	ring->tx_prod_index++;
-	ring->tx_prod_index &= DMA_P_INDEX_MASK;
+	return COMMAND_SCHEDULED;
+}
+
+static inline UWORD bcmgenet_tx_backlog_limit(void)
+{
+	return genetConfig.tx_backlog < TX_BACKLOG_SLOTS ? genetConfig.tx_backlog : TX_BACKLOG_SLOTS;
+}
+
+/* Ring is full: hold the write back, or fail it once the backlog is full too */
+static int bcmgenet_tx_backlog_put(struct GenetUnit *unit, struct bcmgenet_tx_ring *ring, struct IOSana2Req *io, ULONG taken)
+{
+	UWORD limit = bcmgenet_tx_backlog_limit();
+	UWORD count = ring->backlog_head - ring->backlog_tail;
 
-	writel(ring->tx_prod_index, (ULONG)unit->genetBase + TDMA_PROD_INDEX);
-	KprintfH("[genet] %s: Transmitting packet, tx_prod_index %ld\n", __func__, ring->tx_prod_index);
+	if (unlikely(count >= limit))
+	{
+		KprintfH("[genet] %s: TX backlog full\n", __func__);
+		Trace(unit, GENET_TRACE_TX_BACKLOG, count, 1);
+		unit->internalStats.tx_ring_full++;
+		return bcmgenet_tx_error(unit, io);
+	}
+
+	io->ios2_Req.io_Message.mn_Node.ln_Pred = NULL;
+	ring->backlog_taken[ring->backlog_head & (TX_BACKLOG_SLOTS - 1)] = taken;
+	ring->backlog[ring->backlog_head++ & (TX_BACKLOG_SLOTS - 1)] = io;
+	Trace(unit, GENET_TRACE_TX_BACKLOG, count + 1, 0);
 
-	ReleaseSemaphore(&ring->tx_ring_sem);
+	if (!ring->backlog_high && count + 1 >= limit - limit / 4)
+	{
+		KprintfH("[genet] %s: TX backlog above high watermark, %ld writes\n", __func__, count + 1);
+		ring->backlog_high = TRUE;
+		ReportEvents(unit, S2EVENT_BUFF | S2EVENT_TX | S2EVENT_SOFTWARE);
+	}
 	return COMMAND_SCHEDULED;
+}
 
-ret_error:
-	unit->internalStats.tx_dropped++;
-	io->ios2_WireError = S2WERR_BUFF_ERROR;
-	io->ios2_Req.io_Error = S2ERR_NO_RESOURCES;
-	ReportEvents(unit, S2EVENT_BUFF | S2EVENT_TX | S2EVENT_SOFTWARE | S2EVENT_ERROR);
-	ReleaseSemaphore(&ring->tx_ring_sem);
-	return COMMAND_PROCESSED;
+/* Move waiting writes onto the ring as far as descriptors are free, from the unit task */
+void bcmgenet_tx_backlog_drain(struct GenetUnit *unit)
+{
+	struct bcmgenet_tx_ring *ring = &unit->tx_ring;
+
+	if (ring->backlog_head == ring->backlog_tail)
+		return;
+
+	/* Part of the caller's batch when there is one, like bcmgenet_xmit() */
+	bcmgenet_tx_lock(unit);
+	BOOL batch = ring->tx_batch;
+	ring->tx_batch = TRUE;
+	while (ring->backlog_head != ring->backlog_tail)
+	{
+		struct IOSana2Req *io = ring->backlog[ring->backlog_tail & (TX_BACKLOG_SLOTS - 1)];
+		int ret = bcmgenet_tx_submit(unit, io, FALSE, ring->backlog_taken[ring->backlog_tail & (TX_BACKLOG_SLOTS - 1)]);
+		if (ret == TX_NO_DESCRIPTORS)
+			break;
+
+		ring->backlog_tail++;
+		if (ret == COMMAND_PROCESSED)
+			ReplyMsg((struct Message *)io);
+	}
+
+	if (ring->backlog_high && (UWORD)(ring->backlog_head - ring->backlog_tail) <= bcmgenet_tx_backlog_limit() / 4)
+	{
+		KprintfH("[genet] %s: TX backlog below low watermark\n", __func__);
+		ring->backlog_high = FALSE;
+	}
+	ring->tx_batch = batch;
+	if (!batch)
+		bcmgenet_tx_kick_pending(unit);
+	bcmgenet_tx_unlock(unit);
+}
+
+/* Unit goes offline, writes still waiting are failed */
+void bcmgenet_tx_backlog_flush(struct GenetUnit *unit)
+{
+	struct bcmgenet_tx_ring *ring = &unit->tx_ring;
+
+	bcmgenet_tx_lock(unit);
+	while (ring->backlog_head != ring->backlog_tail)
+	{
+		struct IOSana2Req *io = ring->backlog[ring->backlog_tail++ & (TX_BACKLOG_SLOTS - 1)];
+		io->ios2_WireError = S2WERR_UNIT_OFFLINE;
+		io->ios2_Req.io_Error = S2ERR_OUTOFSERVICE;
+		ReplyMsg((struct Message *)io);
+	}
+	ring->backlog_high = FALSE;
+	bcmgenet_tx_unlock(unit);
+}
+
+int bcmgenet_xmit(struct IOSana2Req *io, struct GenetUnit *unit)
+{
+	KprintfH("[genet] %s: unit %ld, io 0x%lx, flags 0x%lx\n", __func__, unit->unitNumber, io, io->ios2_Req.io_Flags);
+	struct bcmgenet_tx_ring *ring = &unit->tx_ring;
+	/* LATENCY_STATS: the TX stages start here, kept with the write in the backlog and on the ring */
+	ULONG taken = unlikely(genetConfig.latency_stats) ? SystemClock() : 0;
+	bcmgenet_tx_lock(unit);
+
+	/* No completion interrupts, make room from what the hardware sent meanwhile */
+	if (unlikely(genetConfig.tx_lazy_reclaim))
+	{
+		bcmgenet_tx_reclaim(unit, TX_DESCS);
+		bcmgenet_tx_backlog_drain(unit);
+	}
+
+	/* Behind a backlog a write waits its turn, frames leave in order. Urgent ones pass it on the priority ring. */
+	int ret = TX_NO_DESCRIPTORS;
+	if (likely(ring->backlog_head == ring->backlog_tail))
+		ret = bcmgenet_tx_submit(unit, io, FALSE, taken);
+	else if (unit->tx_prio_ring.size)
+		ret = bcmgenet_tx_submit(unit, io, TRUE, taken);
+	if (unlikely(ret == TX_NO_DESCRIPTORS))
+		ret = bcmgenet_tx_backlog_put(unit, ring, io, taken);
+
+	bcmgenet_tx_unlock(unit);
+	return ret;
 }
@@ -53,17 +53,37 @@ static void bcmgenet_umac_reset(struct GenetUnit *unit)
 	writel(CMD_SW_RESET | CMD_LCL_LOOP_EN, (ULONG)unit->genetBase + UMAC_CMD);
 	delay_us(2);
 
-	/* clear tx/rx counter */
+	/* clear tx/rx counter, bcmgenet_mib_harvest() starts over from zero */
 	writel(MIB_RESET_RX | MIB_RESET_TX | MIB_RESET_RUNT, (ULONG)unit->genetBase + UMAC_MIB_CTRL);
 	writel(0, (ULONG)unit->genetBase + UMAC_MIB_CTRL);
+	_memset(unit->mibLast, 0, sizeof(unit->mibLast));
 
-	writel(ENET_MAX_MTU_SIZE, (ULONG)unit->genetBase + UMAC_MAX_FRAME_LEN);
+	/* Zero-copy RX puts frames into stack buffers, which only hold RawMTU bytes */
+	writel(genetConfig.rx_zero_copy ? RX_DMA_BUF_LENGTH + ETH_FCS_LEN : ENET_MAX_MTU_SIZE, (ULONG)unit->genetBase + UMAC_MAX_FRAME_LEN);
 
-	/* init rx registers, enable ip header optimization */
+	/* init rx registers, enable ip header optimization unless frames go to stack buffers as they are */
 	ULONG reg = readl((ULONG)unit->genetBase + RBUF_CTRL);
-	reg |= RBUF_ALIGN_2B;
-	// // RBUF_64B_EN would be set here, but we don't use Receive Status Block
+	if (genetConfig.rx_zero_copy)
+		reg &= ~RBUF_ALIGN_2B;
+	else
+		reg |= RBUF_ALIGN_2B;
+	/*
+	 * Receive Status Block with the sum of every frame after its Ethernet
+	 * header, checked against the IPv4 and TCP/UDP headers by the RX loop.
+	 * Zero-copy RX has no room for it in front of the frame.
+	 */
+	unit->rx_status_block = genetConfig.rx_checksum_offload && !genetConfig.rx_zero_copy;
+	if (unit->rx_status_block)
+		reg |= RBUF_64B_EN;
+	else
+		reg &= ~RBUF_64B_EN;
 	writel(reg, ((ULONG)unit->genetBase + RBUF_CTRL));
+	clrsetbits_32((APTR)((ULONG)unit->genetBase + RBUF_CHK_CTRL), RBUF_RXCHK_EN | RBUF_L3_PARSE_DIS | RBUF_SKIP_FCS,
+				  unit->rx_status_block ? RBUF_RXCHK_EN | RBUF_L3_PARSE_DIS : 0);
+
+	/* Transmit Status Block in front of every frame, the MAC fills in checksums it asks for */
+	unit->tx_status_block = genetConfig.tx_checksum_offload != 0;
+	clrsetbits_32((APTR)((ULONG)unit->genetBase + TBUF_CTRL), TBUF_64B_EN, unit->tx_status_block ? TBUF_64B_EN : 0);
 
 	writel(1, ((ULONG)unit->genetBase + RBUF_TBUF_SIZE_CTRL));
 
@@ -129,51 +149,318 @@ static void bcmgenet_enable_dma(struct GenetUnit *unit)
 	setbits_32((APTR)((ULONG)unit->genetBase + TDMA_REG_BASE + DMA_CTRL), DMA_EN);
 }
 
-int bcmgenet_gmac_eth_rx(struct GenetUnit *unit, unsigned int budget)
+/* Stop the RX DMA while descriptors owned by the hardware are changed, returns DMA_CTRL to restore */
+static ULONG bcmgenet_rx_dma_pause(struct GenetUnit *unit)
+{
+	ULONG dma_ctrl = readl(unit->genetBase + RDMA_REG_BASE + DMA_CTRL);
+	if (dma_ctrl & DMA_EN)
+	{
+		writel(dma_ctrl & ~DMA_EN, unit->genetBase + RDMA_REG_BASE + DMA_CTRL);
+		for (int timeout = 0; timeout < DMA_TIMEOUT_VAL; timeout++)
+		{
+			if (!(readl(unit->genetBase + RDMA_REG_BASE + DMA_CTRL) & DMA_EN))
+			{
+				break;
+			}
+			delay_us(1);
+		}
+	}
+	return dma_ctrl;
+}
+
+static inline void bcmgenet_rx_set_buffer(struct enet_cb *rx_cb, APTR buffer)
+{
+	if (rx_cb->data_buffer != buffer)
+	{
+		rx_cb->data_buffer = buffer;
+		writel((ULONG)buffer, rx_cb->descriptor_address + DMA_DESC_ADDRESS_LO);
+	}
+}
+
+/* A bound read request that did not get its frame goes back to the head of its read ring */
+static void bcmgenet_rx_dma_return(struct IOSana2Req *io)
+{
+	struct Opener *opener = io->ios2_BufferManagement;
+
+	if (io->ios2_Req.io_Error)
+	{
+		/* Aborted while it was on the ring */
+		ReplyMsg((struct Message *)io);
+		return;
+	}
+
+	ReadRingUnget(&opener->ipv4Ring, io);
+}
+
+/*
+ * Point a descriptor about to be handed to the hardware at the buffer of a
+ * pending read, so the frame lands in the stack's memory. Only RAW IPv4
+ * reads qualify: the frame is stored with its Ethernet header, and IPv4 is
+ * the type most likely to arrive next. The buffer has to be reachable by
+ * the GENET (not CHIP memory) and cache line aligned, since it is
+ * invalidated after the DMA.
+ *
+ * A bound request waits for the frames in front of it, so one is only taken
+ * while enough requests stay queued for the unbound descriptors the
+ * hardware may fill first.
+ */
+static BOOL bcmgenet_rx_dma_bind(struct GenetUnit *unit, struct enet_cb *rx_cb)
+{
+	UWORD needed = RX_DMA_WINDOW - unit->rx_ring.dma_bound;
+
+	for (struct MinNode *node = unit->openers.mlh_Head; node->mln_Succ; node = node->mln_Succ)
+	{
+		struct Opener *opener = (struct Opener *)node;
+		if (!opener->DMACopyToBuff)
+			continue;
+
+		APTR buffer = NULL;
+		struct IOSana2Req *io = ReadRingPeek(&opener->ipv4Ring);
+		if (io && ReadRingCount(&opener->ipv4Ring) > needed && (io->ios2_Req.io_Flags & SANA2IOF_RAW) && io->ios2_Req.io_Error == 0)
+		{
+			buffer = opener->DMACopyToBuff(io->ios2_Data);
+			if (buffer && buffer > (APTR)0x1FFFFF && ((ULONG)buffer & (ARCH_DMA_MINALIGN - 1)) == 0)
+			{
+				/* ln_Pred stays cleared, abortIO() leaves the request to the unit task */
+				ReadRingGet(&opener->ipv4Ring);
+			}
+			else
+			{
+				buffer = NULL;
+			}
+		}
+
+		if (buffer)
+		{
+			ULONG len = RX_DMA_BUF_LENGTH;
+			CachePreDMA(buffer, &len, 0);
+			rx_cb->ioReq = io;
+			unit->rx_ring.dma_bound++;
+			bcmgenet_rx_set_buffer(rx_cb, buffer);
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
+
+/*
+ * Zero-copy RX refill: while an opener can take frames into its own buffers,
+ * processed descriptors are handed back to the hardware only while fewer
+ * than RX_DMA_WINDOW are free, each one bound to the next pending read if
+ * possible, otherwise pointed back at its internal buffer. Without such an
+ * opener the whole ring is handed back, as in copy mode.
+ */
+static void bcmgenet_rx_refill(struct GenetUnit *unit, UWORD rx_prod_index)
+{
+	struct bcmgenet_rx_ring *ring = &unit->rx_ring;
+	UWORD processed = (ring->rx_cons_index - ring->rx_release_index) & DMA_C_INDEX_MASK;
+	WORD count = processed;
+
+	BOOL dma_opener = FALSE;
+	for (struct MinNode *node = unit->openers.mlh_Head; node->mln_Succ && !dma_opener; node = node->mln_Succ)
+		dma_opener = ((struct Opener *)node)->DMACopyToBuff != NULL;
+
+	if (dma_opener)
+	{
+		UWORD limit = (rx_prod_index - ring->size + RX_DMA_WINDOW) & DMA_C_INDEX_MASK;
+		WORD window = (WORD)(limit - ring->rx_release_index);
+		if (window < count)
+			count = window;
+	}
+	if (count <= 0)
+		return;
+
+	BOOL bind = dma_opener;
+	while (count--)
+	{
+		struct enet_cb *rx_cb = &ring->rx_control_block[ring->release_ptr];
+		if (!bind || !(bind = bcmgenet_rx_dma_bind(unit, rx_cb)))
+			bcmgenet_rx_set_buffer(rx_cb, rx_cb->internal_buffer);
+		ring->rx_release_index++;
+		if (++ring->release_ptr == ring->size)
+			ring->release_ptr = 0;
+	}
+
+	writel(ring->rx_release_index, ring->regs + RDMA_RING_CONS_INDEX);
+}
+
+/*
+ * Take read requests of an opener (all openers if NULL) off the RX ring.
+ * Frames already received into their buffers are moved to the internal
+ * buffers first, the requests go back to their queue, or are replied if
+ * they were aborted meanwhile.
+ */
+void bcmgenet_rx_dma_unbind(struct GenetUnit *unit, struct Opener *opener)
+{
+	struct bcmgenet_rx_ring *ring = &unit->rx_ring;
+
+	if (!genetConfig.rx_zero_copy || !ring->rx_control_block || !ring->dma_bound)
+		return;
+
+	BOOL bound = FALSE;
+	for (UWORD i = 0; i < ring->size && !bound; i++)
+	{
+		struct IOSana2Req *io = ring->rx_control_block[i].ioReq;
+		bound = io && (!opener || io->ios2_BufferManagement == opener);
+	}
+	if (!bound)
+		return;
+
+	ULONG dma_ctrl = bcmgenet_rx_dma_pause(unit);
+	UWORD rx_prod_index = readl(ring->regs + RDMA_RING_PROD_INDEX) & DMA_P_INDEX_MASK;
+	UWORD received = (rx_prod_index - ring->rx_cons_index) & DMA_C_INDEX_MASK;
+
+	for (UWORD i = 0; i < ring->size; i++)
+	{
+		struct enet_cb *rx_cb = &ring->rx_control_block[(ring->read_ptr + i) % ring->size];
+		struct IOSana2Req *io = rx_cb->ioReq;
+		if (!io || (opener && io->ios2_BufferManagement != opener))
+			continue;
+
+		if (i < received)
+		{
+			ULONG length = (readl((ULONG)rx_cb->descriptor_address + DMA_DESC_LENGTH_STATUS) >> DMA_BUFLENGTH_SHIFT) & DMA_BUFLENGTH_MASK;
+			if (length > RX_DMA_BUF_LENGTH)
+				length = RX_DMA_BUF_LENGTH;
+			CachePostDMA(rx_cb->data_buffer, &length, 0);
+			CopyMem(rx_cb->data_buffer, rx_cb->internal_buffer, length);
+		}
+
+		rx_cb->ioReq = NULL;
+		ring->dma_bound--;
+		bcmgenet_rx_set_buffer(rx_cb, rx_cb->internal_buffer);
+		bcmgenet_rx_dma_return(io);
+	}
+
+	if (dma_ctrl & DMA_EN)
+		writel(dma_ctrl, unit->genetBase + RDMA_REG_BASE + DMA_CTRL);
+}
+
+ULONG bcmgenet_csum_partial(const UBYTE *data, ULONG length, ULONG sum)
+{
+	for (; length > 1; data += 2, length -= 2)
+		sum += (data[0] << 8) | data[1];
+	if (length)
+		sum += data[0] << 8;
+	return sum;
+}
+
+UWORD bcmgenet_csum_fold(ULONG sum)
 {
-	UWORD rx_prod_reg = readl((ULONG)unit->genetBase + RDMA_PROD_INDEX);
+	while (sum >> 16)
+		sum = (sum & 0xffff) + (sum >> 16);
+	return sum;
+}
+
+/*
+ * rx_csum of the Receive Status Block is the sum of everything after the
+ * Ethernet header. Without the padding of a short frame, and with an IPv4
+ * header that sums up to 0xffff as it should, that is the sum of the TCP or
+ * UDP segment, which with the pseudo header added comes to 0xffff as well.
+ */
+static BOOL bcmgenet_rx_csum_ok(const UBYTE *frame, ULONG length, ULONG rx_csum)
+{
+	if (*(UWORD *)&frame[12] != 0x0800 || length < ETH_HLEN + 20)
+		return FALSE;
+
+	const UBYTE *ip = frame + ETH_HLEN;
+	ULONG ihl = (ip[0] & 0x0f) * 4;
+	ULONG total = (ip[2] << 8) | ip[3];
+	ULONG min_l4;
+	switch (ip[9])
+	{
+	case 6: /* TCP */
+		min_l4 = 20;
+		break;
+	case 17: /* UDP, a zero checksum was not sent */
+		min_l4 = 8;
+		break;
+	default:
+		return FALSE;
+	}
+	if ((ip[0] >> 4) != 4 || ihl < 20 || total < ihl + min_l4 || total > length - ETH_HLEN ||
+		(ip[6] & 0x3f) || ip[7] /* fragment */ || (ip[9] == 17 && !ip[ihl + 6] && !ip[ihl + 7]))
+		return FALSE;
+
+	if (bcmgenet_csum_fold(bcmgenet_csum_partial(ip, ihl, 0)) != 0xffff)
+		return FALSE;
+
+	ULONG sum = rx_csum;
+	if (total < length - ETH_HLEN)
+	{
+		/* Take the padding out again, it starts on an odd byte when total is odd */
+		UWORD pad = bcmgenet_csum_fold(bcmgenet_csum_partial(ip + total, length - ETH_HLEN - total, 0));
+		if (total & 1)
+			pad = (pad << 8) | (pad >> 8);
+		sum += (UWORD)~pad;
+	}
+
+	/* Pseudo header: addresses, protocol and segment length */
+	sum = bcmgenet_csum_partial(ip + 12, 8, sum) + ip[9] + total - ihl;
+	return bcmgenet_csum_fold(sum) == 0xffff;
+}
+
+int bcmgenet_gmac_eth_rx(struct GenetUnit *unit, struct bcmgenet_rx_ring *ring, unsigned int budget)
+{
+	UWORD rx_prod_reg = readl(ring->regs + RDMA_RING_PROD_INDEX);
 	UWORD discards = (rx_prod_reg >> DMA_P_INDEX_DISCARD_CNT_SHIFT) & DMA_P_INDEX_DISCARD_CNT_MASK;
 	UWORD rx_prod_index = rx_prod_reg & DMA_P_INDEX_MASK;
 
-	if (rx_prod_index == unit->rx_ring.rx_cons_index)
+	if (rx_prod_index == ring->rx_cons_index)
 		return -EAGAIN;
 
-	if (unlikely(discards > unit->rx_ring.old_discards))
+	if (unlikely(discards > ring->old_discards))
 	{
-		discards = discards - unit->rx_ring.old_discards;
+		discards = discards - ring->old_discards;
 		unit->internalStats.rx_overruns += discards; // dropped packets?
-		unit->rx_ring.old_discards += discards;
+		ring->old_discards += discards;
 
 		/* Clear HW register when we reach 75% of maximum 0xFFFF */
-		if (unit->rx_ring.old_discards >= 0xC000)
+		if (ring->old_discards >= 0xC000)
 		{
-			unit->rx_ring.old_discards = 0;
-			writel(0, (ULONG)unit->genetBase + RDMA_PROD_INDEX);
+			ring->old_discards = 0;
+			writel(0, ring->regs + RDMA_RING_PROD_INDEX);
 		}
 	}
 
-	KprintfH("[genet] %s: rx_prod_index=%ld, rx_cons_index=%ld\n", __func__, rx_prod_index, unit->rx_ring.rx_cons_index);
+	KprintfH("[genet] %s: rx_prod_index=%ld, rx_cons_index=%ld\n", __func__, rx_prod_index, ring->rx_cons_index);
 
-	UWORD rx_cons_index = unit->rx_ring.rx_cons_index;
+	UWORD rx_cons_index = ring->rx_cons_index;
 	UWORD to_process = (rx_prod_index - rx_cons_index) & DMA_C_INDEX_MASK;
 	if(to_process > budget)
 		to_process = budget;
-	rx_prod_index = (rx_cons_index + to_process) & DMA_C_INDEX_MASK;
-	while (rx_cons_index != rx_prod_index)
+	UWORD rx_end_index = (rx_cons_index + to_process) & DMA_C_INDEX_MASK;
+	UWORD read_ptr = ring->read_ptr;
+	const UBYTE offset = ring->rx_buf_offset;
+	while (rx_cons_index != rx_end_index)
 	{
-		struct enet_cb *rx_cb = &unit->rx_ring.rx_control_block[rx_cons_index & 0xff];
-		APTR desc_base = rx_cb->descriptor_address;
-		ULONG length = readl((ULONG)desc_base + DMA_DESC_LENGTH_STATUS);
+		struct enet_cb *rx_cb = &ring->rx_control_block[read_ptr];
+		/* Zero-copy RX: the frame is in the buffer of the read request bound to the descriptor */
+		struct IOSana2Req *dma_io = rx_cb->ioReq;
+		APTR addr = rx_cb->data_buffer;
+		ring->dma_io = dma_io;
+		ULONG length;
+		if (unit->rx_status_block)
+		{
+			/* The status block repeats the descriptor's length and status, no register read needed */
+			length = STATUS_BLOCK_SIZE;
+			CachePostDMA(addr, &length, 0);
+			length = LE32(*(ULONG *)((ULONG)addr + STATUS_LENGTH_STATUS));
+		}
+		else
+		{
+			length = readl((ULONG)rx_cb->descriptor_address + DMA_DESC_LENGTH_STATUS);
+		}
 		UWORD dma_flags = length & 0xffff;
 		length = (length >> DMA_BUFLENGTH_SHIFT) & DMA_BUFLENGTH_MASK;
-		APTR addr = rx_cb->internal_buffer;
 
 		CachePostDMA(addr, &length, 0);
-		KprintfH("[genet] %s: packet=%08lx length=%ld\n", __func__, (UBYTE *)addr + RX_BUF_OFFSET, length - RX_BUF_OFFSET);
+		KprintfH("[genet] %s: packet=%08lx length=%ld\n", __func__, (UBYTE *)addr + offset, length - offset);
 
-		if (unlikely(length > RX_BUF_LENGTH))
+		if (unlikely(length > (dma_io ? RX_DMA_BUF_LENGTH : RX_BUF_LENGTH)))
 		{
 			KprintfH("[genet] %s: len %ld exceeds RX_BUF_LENGTH %ld\n", __func__, length, RX_BUF_LENGTH);
+			Trace(unit, GENET_TRACE_RX_ERROR, dma_flags, length);
 			unit->internalStats.rx_length_errors++;
 			goto next;
 		}
@@ -181,6 +468,7 @@ int bcmgenet_gmac_eth_rx(struct GenetUnit *unit, unsigned int budget)
 		if (unlikely(!(dma_flags & DMA_EOP) || !(dma_flags & DMA_SOP)))
 		{
 			KprintfH("[genet] %s: dropping fragmented packet, dma_flags=0x%x\n", __func__, (unsigned int)dma_flags);
+			Trace(unit, GENET_TRACE_RX_ERROR, dma_flags, length);
 			unit->internalStats.rx_fragmented_errors++;
 			goto next;
 		}
@@ -194,6 +482,7 @@ int bcmgenet_gmac_eth_rx(struct GenetUnit *unit, unsigned int budget)
 		{
 			KprintfH("[genet] %s: Packet error, length=%ld, dma_flag=0x%x\n",
 					__func__, length, (unsigned int)dma_flags);
+			Trace(unit, GENET_TRACE_RX_ERROR, dma_flags, length);
 			if (dma_flags & DMA_RX_CRC_ERROR)
 				unit->internalStats.rx_crc_errors++;
 			if (dma_flags & DMA_RX_OV)
@@ -211,31 +500,192 @@ int bcmgenet_gmac_eth_rx(struct GenetUnit *unit, unsigned int budget)
 			goto next;
 		} /* error packet */
 
-		ReceiveFrame(unit, (UBYTE *)addr + RX_BUF_OFFSET, length - RX_BUF_OFFSET, dma_flags);
+		ULONG rx_flags = dma_flags;
+		if (unit->rx_status_block &&
+			bcmgenet_rx_csum_ok((UBYTE *)addr + offset, length - offset, LE32(*(ULONG *)((ULONG)addr + STATUS_RX_CSUM)) & STATUS_RX_CSUM_MASK))
+		{
+			rx_flags |= RX_CSUM_OK;
+			unit->internalStats.rx_csum++;
+		}
+
+		ReceiveFrame(unit, (UBYTE *)addr + offset, length - offset, rx_flags);
 	next:
+		if (unlikely(dma_io != NULL))
+		{
+			rx_cb->ioReq = NULL;
+			ring->dma_bound--;
+			if (ring->dma_io == NULL)
+			{
+				/* Delivered without a copy, replied only now as other openers copied from its buffer */
+				unit->internalStats.rx_dma++;
+				if (unlikely(genetConfig.latency_stats))
+					LatencyRxReply(unit);
+				ReplyMsg((struct Message *)dma_io);
+			}
+			else
+			{
+				ring->dma_io = NULL;
+				bcmgenet_rx_dma_return(dma_io);
+			}
+		}
 		rx_cons_index++;
+		if (++read_ptr == ring->size)
+			read_ptr = 0;
+	}
+
+	ring->rx_cons_index = rx_cons_index;
+	ring->read_ptr = read_ptr;
+	Trace(unit, GENET_TRACE_RX_RING, ring->index, to_process);
+	/* Only the default ring takes frames into stack buffers */
+	if (genetConfig.rx_zero_copy && ring == &unit->rx_ring)
+	{
+		bcmgenet_rx_refill(unit, rx_prod_index);
+	}
+	else
+	{
+		ring->rx_release_index = rx_cons_index;
+		ring->release_ptr = read_ptr;
+		writel(rx_cons_index, ring->regs + RDMA_RING_CONS_INDEX);
 	}
 
-	unit->rx_ring.rx_cons_index = rx_cons_index;
-	writel(rx_cons_index, (ULONG)unit->genetBase + RDMA_CONS_INDEX);
-	
 	return to_process;
 }
 
 #define DIV_ROUND_UP(n, d) (((n) + (d) - 1) / (d))
 
-static void bcmgenet_set_rx_coalesce(struct GenetUnit *unit, ULONG usecs, ULONG pkts)
+static void bcmgenet_set_rx_coalesce(struct GenetUnit *unit, struct bcmgenet_rx_ring *ring, ULONG usecs, ULONG pkts)
 {
-	Kprintf("[genet] %s: Setting RX coalesce parameters: usecs=%ld, pkts=%ld\n", __func__, usecs, pkts);
-	unit->rx_ring.rx_coalesce_usecs = usecs;
-	unit->rx_ring.rx_max_coalesced_frames = pkts;
+	Kprintf("[genet] %s: Setting RX ring %ld coalesce parameters: usecs=%ld, pkts=%ld\n", __func__, ring->index, usecs, pkts);
+	Trace(unit, GENET_TRACE_COALESCE, usecs, pkts);
+	ring->rx_coalesce_usecs = usecs;
+	ring->rx_max_coalesced_frames = pkts;
 
-	writel(pkts, unit->genetBase + RDMA_RING_REG_BASE + DMA_MBUF_DONE_THRESH);
+	writel(pkts, ring->regs + DMA_MBUF_DONE_THRESH);
 	
-	ULONG reg = readl(unit->genetBase + RDMA_REG_BASE + DMA_RING16_TIMEOUT);
+	ULONG reg = readl(unit->genetBase + RDMA_REG_BASE + DMA_RING0_TIMEOUT + ring->index * 4);
 	reg &= ~DMA_TIMEOUT_MASK;
 	reg |= DIV_ROUND_UP(usecs * 1000, 8192);
-	writel(reg, unit->genetBase + RDMA_REG_BASE + DMA_RING16_TIMEOUT);
+	writel(reg, unit->genetBase + RDMA_REG_BASE + DMA_RING0_TIMEOUT + ring->index * 4);
+}
+
+/*
+ * Adaptive RX coalescing profiles, from interactive latency to bulk
+ * throughput. A profile is used from either rate on.
+ */
+static const struct
+{
+	ULONG packets_per_sec;
+	ULONG bytes_per_sec;
+	ULONG usecs;
+	ULONG frames;
+} rx_moderation_profiles[] = {
+	{0, 0, 0, 1},
+	{2000, 1000000, 50, 4},
+	{8000, 8000000, 125, 16},
+	{25000, 30000000, 250, 32},
+	{60000, 80000000, 500, 64},
+};
+
+#define RX_MODERATION_PROFILES (sizeof(rx_moderation_profiles) / sizeof(rx_moderation_profiles[0]))
+
+static void bcmgenet_rx_moderation_start(struct GenetUnit *unit)
+{
+	struct bcmgenet_rx_ring *ring = &unit->rx_ring;
+
+	ring->moderation = 0;
+	ring->moderation_packets = unit->internalStats.rx_packets;
+	ring->moderation_bytes = unit->internalStats.rx_bytes;
+	ring->packets_per_sec = 0;
+	if (genetConfig.rx_adaptive_coalesce)
+		bcmgenet_set_rx_coalesce(unit, ring, rx_moderation_profiles[0].usecs, rx_moderation_profiles[0].frames);
+	else
+		bcmgenet_set_rx_coalesce(unit, ring, genetConfig.rx_coalesce_usecs, genetConfig.rx_coalesce_frames);
+}
+
+/*
+ * Measure the receive rate since the last call and, with adaptive
+ * coalescing, pick the profile for it. Load going up switches right away to
+ * cut the interrupt rate, going down steps one profile per interval so a
+ * short pause in a transfer does not flap.
+ */
+void bcmgenet_rx_moderate(struct GenetUnit *unit, ULONG interval_ms)
+{
+	struct bcmgenet_rx_ring *ring = &unit->rx_ring;
+	Counter64 packets = unit->internalStats.rx_packets;
+	Counter64 bytes = unit->internalStats.rx_bytes;
+
+	if (interval_ms == 0)
+		return;
+
+	/* Statistics are cleared on S2_ONLINE */
+	if (packets < ring->moderation_packets || bytes < ring->moderation_bytes)
+	{
+		ring->moderation_packets = 0;
+		ring->moderation_bytes = 0;
+	}
+
+	/* Differences over one interval fit in 32 bits, keeps 64-bit division out */
+	ULONG packets_per_sec = (ULONG)(packets - ring->moderation_packets) * 1000 / interval_ms;
+	ULONG bytes_per_sec = (ULONG)(bytes - ring->moderation_bytes) / interval_ms * 1000;
+	ring->moderation_packets = packets;
+	ring->moderation_bytes = bytes;
+	ring->packets_per_sec = packets_per_sec;
+
+	if (!genetConfig.rx_adaptive_coalesce)
+		return;
+
+	UBYTE target = RX_MODERATION_PROFILES - 1;
+	while (target > 0 && packets_per_sec < rx_moderation_profiles[target].packets_per_sec &&
+		   bytes_per_sec < rx_moderation_profiles[target].bytes_per_sec)
+		target--;
+
+	UBYTE profile = ring->moderation;
+	if (target > profile)
+		profile = target;
+	else if (target < profile)
+		profile--;
+
+	if (profile != ring->moderation)
+	{
+		KprintfH("[genet] %s: %ld packets/s, %ld bytes/s, profile %ld\n", __func__, packets_per_sec, bytes_per_sec, profile);
+		ring->moderation = profile;
+		bcmgenet_set_rx_coalesce(unit, ring, rx_moderation_profiles[profile].usecs, rx_moderation_profiles[profile].frames);
+	}
+}
+
+/*
+ * Fold the MIB counters into the 64-bit totals of internalStats. The MAC
+ * counts in 32 bits, the byte counters wrap after 34 seconds at line rate,
+ * so this has to run more often than that. Unit task only.
+ */
+void bcmgenet_mib_harvest(struct GenetUnit *unit)
+{
+	for (ULONG i = 0; i < GENET_MIB_COUNT; i++)
+	{
+		ULONG reg;
+		if (i < GENET_MIB_TX_64)
+			reg = UMAC_MIB_RX + i * 4;
+		else if (i < GENET_MIB_RX_RUNTS)
+			reg = UMAC_MIB_TX + (i - GENET_MIB_TX_64) * 4;
+		else
+			reg = UMAC_MIB_RUNT + (i - GENET_MIB_RX_RUNTS) * 4;
+
+		ULONG value = readl((ULONG)unit->genetBase + reg);
+		unit->internalStats.mib[i] += (ULONG)(value - unit->mibLast[i]);
+		unit->mibLast[i] = value;
+	}
+}
+
+/* The bottom-half ran out of budget: a burst is building up, do not wait for the next sample */
+void bcmgenet_rx_moderate_backlog(struct GenetUnit *unit)
+{
+	struct bcmgenet_rx_ring *ring = &unit->rx_ring;
+
+	if (ring->moderation < RX_MODERATION_PROFILES - 1)
+	{
+		ring->moderation++;
+		bcmgenet_set_rx_coalesce(unit, ring, rx_moderation_profiles[ring->moderation].usecs, rx_moderation_profiles[ring->moderation].frames);
+	}
 }
 
 int bcmgenet_set_coalesce(struct GenetUnit *unit, ULONG tx_max_coalesced_frames, ULONG rx_max_coalesced_frames, ULONG rx_coalesce_usecs)
@@ -259,147 +709,214 @@ int bcmgenet_set_coalesce(struct GenetUnit *unit, ULONG tx_max_coalesced_frames,
 	 * always generate an interrupt either after MBDONE packets have been
 	 * transmitted, or when the ring is empty.
 	 */
-	writel(tx_max_coalesced_frames, (ULONG)unit->genetBase + TDMA_RING_REG_BASE + DMA_MBUF_DONE_THRESH);
+	writel(tx_max_coalesced_frames, unit->tx_ring.regs + DMA_MBUF_DONE_THRESH);
 
-	bcmgenet_set_rx_coalesce(unit, rx_coalesce_usecs, rx_max_coalesced_frames);
+	bcmgenet_set_rx_coalesce(unit, &unit->rx_ring, rx_coalesce_usecs, rx_max_coalesced_frames);
 
 	return S2ERR_NO_ERROR;
 }
 
-static int bcmgenet_init_rx_ring(struct GenetUnit *unit)
+/* Set up ring q on size descriptors starting at first, and their buffers */
+static int bcmgenet_init_rx_ring(struct GenetUnit *unit, struct bcmgenet_rx_ring *ring, UBYTE q, UWORD first, UWORD size)
 {
-	Kprintf("[genet] %s: Initializing RX ring\n", __func__);
-	struct bcmgenet_rx_ring *ring = &unit->rx_ring;
+	Kprintf("[genet] %s: Initializing RX ring %ld, descriptors %ld-%ld\n", __func__, q, first, first + size - 1);
+	ring->regs = (ULONG)unit->genetBase + RDMA_RING_REG(q);
+	ring->index = q;
+	ring->size = size;
 
 	/* Initialize common Rx ring structures */
-	const APTR desc_base = unit->genetBase + GENET_RX_OFF;
-	ring->rx_control_block = AllocPooled(unit->memoryPool, RX_DESCS * sizeof(struct enet_cb));
+	const APTR desc_base = unit->genetBase + GENET_RX_OFF + first * DMA_DESC_SIZE;
+	ring->rx_control_block = AllocPooled(unit->memoryPool, size * sizeof(struct enet_cb));
 	if (!ring->rx_control_block)
 	{
 		return S2ERR_NO_RESOURCES;
 	}
 
-	_memset(ring->rx_control_block, 0, RX_DESCS * sizeof(struct enet_cb));
+	_memset(ring->rx_control_block, 0, size * sizeof(struct enet_cb));
 
 	const ULONG len_stat = (RX_BUF_LENGTH << DMA_BUFLENGTH_SHIFT);// | DMA_OWN;
 
-	for (ULONG i = 0; i < RX_DESCS; i++)
+	for (ULONG i = 0; i < size; i++)
 	{
-		APTR buffer = &unit->rxbuffer[i * RX_BUF_LENGTH];
+		APTR buffer = &unit->rxbuffer[(first + i) * RX_BUF_LENGTH];
 		APTR descriptor_address = desc_base + i * DMA_DESC_SIZE;
 
 		ring->rx_control_block[i].descriptor_address = descriptor_address;
 		ring->rx_control_block[i].internal_buffer = buffer;
+		ring->rx_control_block[i].data_buffer = buffer;
 
 		writel((ULONG)buffer, descriptor_address + DMA_DESC_ADDRESS_LO);
 		writel(len_stat, descriptor_address + DMA_DESC_LENGTH_STATUS);
 	}
 
-	bcmgenet_set_rx_coalesce(unit, genetConfig.rx_coalesce_usecs, genetConfig.rx_coalesce_frames);
+	ring->rx_buf_offset = genetConfig.rx_zero_copy ? 0 : (unit->rx_status_block ? STATUS_BLOCK_SIZE : 0) + RX_BUF_OFFSET;
+	ring->dma_io = NULL;
+	ring->dma_bound = 0;
 
 	/* cannot init RDMA_PROD_INDEX to 0, so align RDMA_CONS_INDEX on it instead */
-	ring->rx_cons_index = readl((ULONG)unit->genetBase + RDMA_PROD_INDEX) & DMA_P_INDEX_MASK;
-	writel(ring->rx_cons_index, (ULONG)unit->genetBase + RDMA_CONS_INDEX);
-	Kprintf("[genet] %s: rx_cons_index=%ld\n", __func__, unit->rx_ring.rx_cons_index);
+	ring->rx_cons_index = readl(ring->regs + RDMA_RING_PROD_INDEX) & DMA_P_INDEX_MASK;
+	ring->read_ptr = 0;
+	/* In zero-copy mode the hardware only gets RX_DMA_WINDOW descriptors of the default ring */
+	ring->rx_release_index = ring->rx_cons_index;
+	ring->release_ptr = 0;
+	if (genetConfig.rx_zero_copy && q == DEFAULT_Q)
+	{
+		ring->rx_release_index = (ring->rx_cons_index - size + RX_DMA_WINDOW) & DMA_C_INDEX_MASK;
+		ring->release_ptr = RX_DMA_WINDOW;
+	}
+	writel(ring->rx_release_index, ring->regs + RDMA_RING_CONS_INDEX);
+	Kprintf("[genet] %s: rx_cons_index=%ld\n", __func__, ring->rx_cons_index);
 
-	writel((RX_DESCS << DMA_RING_SIZE_SHIFT) | RX_BUF_LENGTH, unit->genetBase + RDMA_RING_REG_BASE + DMA_RING_BUF_SIZE);
-	writel((DMA_FC_THRESH_LO << DMA_XOFF_THRESHOLD_SHIFT) | DMA_FC_THRESH_HI, unit->genetBase + RDMA_XON_XOFF_THRESH);
+	writel((size << DMA_RING_SIZE_SHIFT) | RX_BUF_LENGTH, ring->regs + DMA_RING_BUF_SIZE);
+	writel((DMA_FC_THRESH_LO << DMA_XOFF_THRESHOLD_SHIFT) | DMA_FC_THRESH_HI, ring->regs + RDMA_RING_XON_XOFF_THRESH);
 
-	/* Set start and end address, read and write pointers */
-	writel(0x0, unit->genetBase + RDMA_RING_REG_BASE + DMA_START_ADDR);
-	writel(0x0, unit->genetBase + RDMA_READ_PTR);
-	writel(0x0, unit->genetBase + RDMA_WRITE_PTR);
-	writel(RX_DESCS * DMA_DESC_SIZE / 4 - 1, unit->genetBase + RDMA_RING_REG_BASE + DMA_END_ADDR);
+	/* Set start and end address, read and write pointers, in words */
+	const ULONG start = first * DMA_DESC_SIZE / 4;
+	writel(start, ring->regs + DMA_START_ADDR);
+	writel(start, ring->regs + RDMA_RING_READ_PTR);
+	writel(start, ring->regs + RDMA_RING_WRITE_PTR);
+	writel((first + size) * DMA_DESC_SIZE / 4 - 1, ring->regs + DMA_END_ADDR);
 
 	return S2ERR_NO_ERROR;
 }
 
 static int bcmgenet_init_rx_queues(struct GenetUnit *unit)
 {
-	int ret = bcmgenet_init_rx_ring(unit);
+	ULONG ring_cfg = 1 << DEFAULT_Q;
+	UWORD first = 0;
+
+	/* The priority ring takes the first descriptors, the default ring the rest */
+	unit->rx_prio_ring.size = 0;
+	/* Back on interrupts, the unit task polls again once the rate calls for it */
+	unit->rx_polling = FALSE;
+	if (genetConfig.rx_prio_ring)
+	{
+		int ret = bcmgenet_init_rx_ring(unit, &unit->rx_prio_ring, RX_PRIO_Q, 0, RX_PRIO_DESCS);
+		if (ret != S2ERR_NO_ERROR)
+		{
+			return ret;
+		}
+		/* Few frames, each one wanted right away */
+		bcmgenet_set_rx_coalesce(unit, &unit->rx_prio_ring, 0, RX_PRIO_COALESCE_FRAMES);
+		ring_cfg |= 1 << RX_PRIO_Q;
+		first = RX_PRIO_DESCS;
+	}
+
+	int ret = bcmgenet_init_rx_ring(unit, &unit->rx_ring, DEFAULT_Q, first, RX_DESCS - first);
 	if (ret != S2ERR_NO_ERROR)
 	{
 		return ret;
 	}
+	bcmgenet_rx_moderation_start(unit);
 
 	/* Configure Rx queues as descriptor rings */
-	writel(1 << DEFAULT_Q, unit->genetBase + RDMA_REG_BASE + DMA_RING_CFG);
+	writel(ring_cfg, unit->genetBase + RDMA_REG_BASE + DMA_RING_CFG);
 
 	/* Enable Rx rings */
-	ULONG dma_ctrl = 1 << (DEFAULT_Q + DMA_RING_BUF_EN_SHIFT);
+	ULONG dma_ctrl = ring_cfg << DMA_RING_BUF_EN_SHIFT;
 	writel(dma_ctrl, unit->genetBase + RDMA_REG_BASE + DMA_CTRL);
 	return S2ERR_NO_ERROR;
 }
 
-static int bcmgenet_init_tx_ring(struct GenetUnit *unit)
+/* Set up ring q on size descriptors starting at first, with the TX buffers of those descriptors */
+static int bcmgenet_init_tx_ring(struct GenetUnit *unit, struct bcmgenet_tx_ring *ring, UBYTE q, UWORD first, UWORD size)
 {
-	Kprintf("[genet] %s: Initializing TX ring\n", __func__);
-	struct bcmgenet_tx_ring *ring = &unit->tx_ring;
-
-	InitSemaphore(&ring->tx_ring_sem);
+	Kprintf("[genet] %s: Initializing TX ring %ld, descriptors %ld-%ld\n", __func__, q, first, first + size - 1);
+	ring->regs = (ULONG)unit->genetBase + TDMA_RING_REG(q);
+	ring->index = q;
+	ring->size = size;
 
 	/* Initialize common TX ring structures */
-	APTR desc_base = unit->genetBase + GENET_TX_OFF;
-	ring->tx_control_block = AllocPooled(unit->memoryPool, TX_DESCS * sizeof(struct enet_cb));
+	APTR desc_base = unit->genetBase + GENET_TX_OFF + first * DMA_DESC_SIZE;
+	ring->tx_control_block = AllocPooled(unit->memoryPool, size * sizeof(struct enet_cb));
 	if (!ring->tx_control_block)
 	{
 		return S2ERR_NO_RESOURCES;
 	}
 
-	_memset(ring->tx_control_block, 0, TX_DESCS * sizeof(struct enet_cb));
-	for (ULONG i = 0; i < TX_DESCS; i++)
+	_memset(ring->tx_control_block, 0, size * sizeof(struct enet_cb));
+	for (ULONG i = 0; i < size; i++)
 	{
 		ring->tx_control_block[i].descriptor_address = desc_base + i * DMA_DESC_SIZE;
-		ring->tx_control_block[i].internal_buffer = &unit->txbuffer[i * RX_BUF_LENGTH];
+		ring->tx_control_block[i].internal_buffer = &unit->txbuffer[(first + i) * RX_BUF_LENGTH];
 	}
 
 	/* Cannot init TDMA_CONS_INDEX to 0, so align TDMA_PROD_INDEX on it instead */
-	ring->tx_cons_index = readl((ULONG)unit->genetBase + TDMA_CONS_INDEX) & DMA_C_INDEX_MASK;
-	writel(ring->tx_cons_index, (ULONG)unit->genetBase + TDMA_PROD_INDEX);
+	ring->tx_cons_index = readl(ring->regs + TDMA_RING_CONS_INDEX) & DMA_C_INDEX_MASK;
+	writel(ring->tx_cons_index, ring->regs + TDMA_RING_PROD_INDEX);
 	ring->tx_prod_index = ring->tx_cons_index;
-	ring->write_ptr = ring->tx_cons_index;
-	ring->clean_ptr = ring->tx_cons_index;
+	ring->write_ptr = 0;
+	ring->clean_ptr = 0;
+	ring->tx_pending = 0;
+	ring->tx_batch = FALSE;
+	ring->backlog_head = 0;
+	ring->backlog_tail = 0;
+	ring->backlog_high = FALSE;
+	/* Full bucket, the rate limit itself stays as it was set */
+	bcmgenet_tx_shape_set(ring, ring->shape_rate, ring->shape_burst);
 
 	/* Default, can be overridden using coalesce settings */
-	writel(genetConfig.tx_coalesce_frames, (ULONG)unit->genetBase + TDMA_RING_REG_BASE + DMA_MBUF_DONE_THRESH);
+	writel(genetConfig.tx_coalesce_frames, ring->regs + DMA_MBUF_DONE_THRESH);
 
-	/* Disable rate control for now */
-	writel(0x0, (ULONG)unit->genetBase + TDMA_FLOW_PERIOD);
-	writel((TX_DESCS << DMA_RING_SIZE_SHIFT) | RX_BUF_LENGTH, (ULONG)unit->genetBase + TDMA_RING_REG_BASE + DMA_RING_BUF_SIZE);
+	/*
+	 * No hardware rate control, its flow period is not documented beyond
+	 * the frame size Linux programs. Rate limits are a token bucket in
+	 * bcmgenet_tx_submit() instead.
+	 */
+	writel(0x0, ring->regs + TDMA_RING_FLOW_PERIOD);
+	writel((size << DMA_RING_SIZE_SHIFT) | RX_BUF_LENGTH, ring->regs + DMA_RING_BUF_SIZE);
 
-	/* Set start and end address, read and write pointers */
-	writel(0x0, (ULONG)unit->genetBase + TDMA_RING_REG_BASE + DMA_START_ADDR);
-	writel(0x0, (ULONG)unit->genetBase + TDMA_READ_PTR);
-	writel(0x0, (ULONG)unit->genetBase + TDMA_WRITE_PTR);
-	writel(TX_DESCS * DMA_DESC_SIZE / 4 - 1, (ULONG)unit->genetBase + TDMA_RING_REG_BASE + DMA_END_ADDR);
+	/* Set start and end address, read and write pointers, in words */
+	const ULONG start = first * DMA_DESC_SIZE / 4;
+	writel(start, ring->regs + DMA_START_ADDR);
+	writel(start, ring->regs + TDMA_RING_READ_PTR);
+	writel(start, ring->regs + TDMA_RING_WRITE_PTR);
+	writel((first + size) * DMA_DESC_SIZE / 4 - 1, ring->regs + DMA_END_ADDR);
 
 	return S2ERR_NO_ERROR;
 }
 
 static int bcmgenet_init_tx_queues(struct GenetUnit *unit)
 {
-	// We'll only setup queue 0
+	ULONG ring_cfg = 1 << DEFAULT_Q;
+	ULONG dma_priority[3] = {0, 0, 0};
+	UWORD first = 0;
 
 	/* Enable strict priority arbiter mode */
 	writel(DMA_ARBITER_SP, unit->genetBase + TDMA_REG_BASE + DMA_ARB_CTRL);
 
-	/* Initialize Tx priority queues */
-	int ret = bcmgenet_init_tx_ring(unit);
+	/* The priority ring takes the first descriptors, the default ring the rest */
+	unit->tx_prio_ring.size = 0;
+	if (genetConfig.tx_prio_ring)
+	{
+		int ret = bcmgenet_init_tx_ring(unit, &unit->tx_prio_ring, TX_PRIO_Q, 0, TX_PRIO_DESCS);
+		if (ret != S2ERR_NO_ERROR)
+		{
+			return ret;
+		}
+		/* Completions of the few frames there are not held back */
+		writel(1, unit->tx_prio_ring.regs + DMA_MBUF_DONE_THRESH);
+		ring_cfg |= 1 << TX_PRIO_Q;
+		first = TX_PRIO_DESCS;
+	}
+
+	int ret = bcmgenet_init_tx_ring(unit, &unit->tx_ring, DEFAULT_Q, first, TX_DESCS - first);
 	if (ret != S2ERR_NO_ERROR)
 	{
 		return ret;
 	}
 
-	/* Set Tx queue priorities */
-	writel(0, unit->genetBase + TDMA_REG_BASE + DMA_PRIORITY_0);
-	writel(0, unit->genetBase + TDMA_REG_BASE + DMA_PRIORITY_1);
-	writel(0, unit->genetBase + TDMA_REG_BASE + DMA_PRIORITY_2);
+	/* Set Tx queue priorities, the arbiter serves the lower value first */
+	dma_priority[DMA_PRIO_REG_INDEX(DEFAULT_Q)] |= 1 << DMA_PRIO_REG_SHIFT(DEFAULT_Q);
+	writel(dma_priority[0], unit->genetBase + TDMA_REG_BASE + DMA_PRIORITY_0);
+	writel(dma_priority[1], unit->genetBase + TDMA_REG_BASE + DMA_PRIORITY_1);
+	writel(dma_priority[2], unit->genetBase + TDMA_REG_BASE + DMA_PRIORITY_2);
 
 	/* Configure Tx queues as descriptor rings */
-	writel(1 << DEFAULT_Q, (ULONG)unit->genetBase + TDMA_REG_BASE + DMA_RING_CFG);
+	writel(ring_cfg, (ULONG)unit->genetBase + TDMA_REG_BASE + DMA_RING_CFG);
 
 	/* Enable Tx rings */
-	ULONG dma_ctrl = 1 << (DEFAULT_Q + DMA_RING_BUF_EN_SHIFT);
+	ULONG dma_ctrl = ring_cfg << DMA_RING_BUF_EN_SHIFT;
 	writel(dma_ctrl, unit->genetBase + TDMA_REG_BASE + DMA_CTRL);
 	return S2ERR_NO_ERROR;
 }
@@ -545,6 +1062,158 @@ void bcmgenet_set_rx_mode(struct GenetUnit *unit)
 	unit->mdfEnabled = TRUE;
 }
 
+/*
+ * Hardware Filter Block: the first filters steer ARP and ICMP to the
+ * priority ring. The last ones send frames of packet types nobody reads to
+ * HFB_DISCARD_Q, which is never enabled, meant to have the MAC drop them
+ * before DMA. Discard filters compare the Ethernet type only, everything in
+ * front of it is don't care. That set is learned from orphans in
+ * ReceiveFrame() and undone as soon as a reader for the type shows up.
+ *
+ * NOT VERIFIED ON HARDWARE: what GENET v5 does with a frame steered to a
+ * disabled ring is not documented. If RBUF holds it waiting for the ring
+ * instead of dropping it, all reception stalls behind it. Hence HFB_FILTER
+ * defaults to 0. Check on a Pi 4 with HFB_FILTER=1 and an unread type
+ * flooding the line: the RBUF discard counter should go up and IPv4 keep
+ * flowing. Record the outcome here.
+ */
+static inline ULONG bcmgenet_hfb_index(int slot)
+{
+	return HFB_FILTER_CNT - HFB_DISCARD_FILTERS + slot;
+}
+
+/* Filter word for the Ethernet type, in frame byte order as ReceiveFrame() reads it */
+static inline ULONG bcmgenet_hfb_type_word(UWORD packetType)
+{
+	const UBYTE *type = (const UBYTE *)&packetType;
+	return HFB_MASK_BYTES | type[0] << 8 | type[1];
+}
+
+/* Match the first len frame bytes against words, NULL for all don't care, and steer hits to ring q */
+static void bcmgenet_hfb_set_filter(struct GenetUnit *unit, ULONG f_index, const ULONG *words, ULONG len, ULONG q)
+{
+	for (ULONG i = 0; i < len / 2; i++)
+		writel(words ? words[i] : 0, (ULONG)unit->genetBase + GENET_HFB_OFF + (f_index * HFB_FILTER_SIZE + i) * 4);
+
+	ULONG reg = (ULONG)unit->genetBase + HFB_FLT_LEN + ((HFB_FILTER_CNT - 1 - f_index) / 4) * 4;
+	clrsetbits_32((APTR)reg, 0xff << (8 * (f_index % 4)), len << (8 * (f_index % 4)));
+
+	reg = (ULONG)unit->genetBase + RDMA_REG_BASE + DMA_INDEX2RING_0 + (f_index / 8) * 4;
+	clrsetbits_32((APTR)reg, 0xf << (4 * (f_index % 8)), q << (4 * (f_index % 8)));
+}
+
+static void bcmgenet_hfb_enable_filter(struct GenetUnit *unit, ULONG f_index, BOOL enable)
+{
+	ULONG reg = (ULONG)unit->genetBase + HFB_FLT_ENABLE + (f_index < 32 ? 4 : 0);
+	ULONG val = readl(reg);
+	if (enable)
+		val |= BIT(f_index % 32);
+	else
+		val &= ~BIT(f_index % 32);
+	writel(val, reg);
+}
+
+void bcmgenet_hfb_init(struct GenetUnit *unit)
+{
+	writel(0, (ULONG)unit->genetBase + HFB_CTRL);
+	writel(0, (ULONG)unit->genetBase + HFB_FLT_ENABLE);
+	writel(0, (ULONG)unit->genetBase + HFB_FLT_ENABLE + 4);
+	_memset(unit->hfbType, 0, sizeof(unit->hfbType));
+	unit->hfbCount = 0;
+	unit->hfbNext = 0;
+
+	if (!genetConfig.rx_prio_ring && !genetConfig.hfb_filter)
+		return;
+
+	if (genetConfig.rx_prio_ring)
+	{
+		ULONG words[12] = {0};
+
+		Kprintf("[genet] %s: Steering ARP and ICMP to RX ring %ld\n", __func__, RX_PRIO_Q);
+		/* ARP */
+		words[6] = bcmgenet_hfb_type_word(0x0806);
+		bcmgenet_hfb_set_filter(unit, 0, words, ETH_HLEN, RX_PRIO_Q);
+		/* ICMP, IPv4 protocol 1 */
+		words[6] = bcmgenet_hfb_type_word(0x0800);
+		words[11] = HFB_MASK_LO_BYTE | 1;
+		bcmgenet_hfb_set_filter(unit, 1, words, 24, RX_PRIO_Q);
+		/* ICMPv6 for neighbour discovery, IPv6 next header 58 */
+		words[6] = bcmgenet_hfb_type_word(0x86dd);
+		words[10] = HFB_MASK_HI_BYTE | 58 << 8;
+		words[11] = 0;
+		bcmgenet_hfb_set_filter(unit, 2, words, 22, RX_PRIO_Q);
+		writel(BIT(0) | BIT(1) | BIT(2), (ULONG)unit->genetBase + HFB_FLT_ENABLE + 4);
+	}
+
+	if (genetConfig.hfb_filter)
+	{
+		Kprintf("[genet] %s: %ld filters for discarded packet types\n", __func__, HFB_DISCARD_FILTERS);
+		for (int slot = 0; slot < HFB_DISCARD_FILTERS; slot++)
+			bcmgenet_hfb_set_filter(unit, bcmgenet_hfb_index(slot), NULL, ETH_HLEN, HFB_DISCARD_Q);
+	}
+	writel(RBUF_HFB_EN, (ULONG)unit->genetBase + HFB_CTRL);
+}
+
+/* Drop frames of this type in hardware from now on. Called by the unit task */
+void bcmgenet_hfb_discard(struct GenetUnit *unit, UWORD packetType)
+{
+	/* 802.3 frames have a length there, IPv4 and ARP readers may just be late */
+	if (!genetConfig.hfb_filter || packetType <= ETH_DATA_LEN || packetType == 0x0800 || packetType == 0x0806)
+		return;
+
+	Forbid();
+	int slot = -1;
+	for (int i = 0; i < HFB_DISCARD_FILTERS; i++)
+	{
+		if (unit->hfbType[i] == packetType)
+		{
+			Permit();
+			return;
+		}
+		if (slot < 0 && unit->hfbType[i] == 0)
+			slot = i;
+	}
+
+	if (slot < 0)
+	{
+		/* All taken, reuse the filters round robin */
+		slot = unit->hfbNext;
+		unit->hfbNext = (unit->hfbNext + 1) % HFB_DISCARD_FILTERS;
+		bcmgenet_hfb_enable_filter(unit, bcmgenet_hfb_index(slot), FALSE);
+	}
+	else
+	{
+		unit->hfbCount++;
+	}
+
+	ULONG f_index = bcmgenet_hfb_index(slot);
+	writel(bcmgenet_hfb_type_word(packetType), (ULONG)unit->genetBase + GENET_HFB_OFF + (f_index * HFB_FILTER_SIZE + ETH_HLEN / 2 - 1) * 4);
+	unit->hfbType[slot] = packetType;
+	bcmgenet_hfb_enable_filter(unit, f_index, TRUE);
+	Permit();
+
+	KprintfH("[genet] %s: Discarding packet type 0x%04lx with filter %ld\n", __func__, packetType, f_index);
+	Trace(unit, GENET_TRACE_HFB, packetType, 1);
+}
+
+/* Stop dropping this type, 0 for all types. Called in the context of a read request */
+void bcmgenet_hfb_accept(struct GenetUnit *unit, UWORD packetType)
+{
+	Forbid();
+	for (int slot = 0; slot < HFB_DISCARD_FILTERS; slot++)
+	{
+		if (unit->hfbType[slot] != 0 && (packetType == 0 || unit->hfbType[slot] == packetType))
+		{
+			KprintfH("[genet] %s: Accepting packet type 0x%04lx again\n", __func__, unit->hfbType[slot]);
+			Trace(unit, GENET_TRACE_HFB, unit->hfbType[slot], 0);
+			bcmgenet_hfb_enable_filter(unit, bcmgenet_hfb_index(slot), FALSE);
+			unit->hfbType[slot] = 0;
+			unit->hfbCount--;
+		}
+	}
+	Permit();
+}
+
 int bcmgenet_gmac_eth_start(struct GenetUnit *unit)
 {
 	int ret = S2ERR_NO_ERROR;
@@ -574,7 +1243,7 @@ int bcmgenet_gmac_eth_start(struct GenetUnit *unit)
 
 	bcmgenet_gmac_write_hwaddr(unit, unit->currentMacAddress);
 
-	// bcmgenet_hfb_init()
+	bcmgenet_hfb_init(unit);
 
 	ret = bcmgenet_init_dma(unit);
 	if (ret != S2ERR_NO_ERROR)
@@ -596,6 +1265,23 @@ int bcmgenet_gmac_eth_start(struct GenetUnit *unit)
 		goto init_dma;
 	}
 
+	if (unit->rx_prio_ring.size || unit->tx_prio_ring.size)
+	{
+		unit->irq1_isr.is_Node.ln_Type = NT_INTERRUPT;
+		unit->irq1_isr.is_Node.ln_Name = "bcmgenet_isr1";
+		unit->irq1_isr.is_Data = (APTR)unit;
+		unit->irq1_isr.is_Code = (APTR)bcmgenet_isr1;
+
+		ret = AddIntServerEx(unit->irq1_number, 0, FALSE, &unit->irq1_isr);
+		if (ret < 0)
+		{
+			Kprintf("[genet] %s: can't register IRQ %ld\n", __func__, unit->irq1_number);
+			RemIntServerEx(unit->irq0_number, &unit->irq0_isr);
+			ret = S2ERR_SOFTWARE;
+			goto init_dma;
+		}
+	}
+
 	// bcmgenet_mii_probe(unit);
 	//  rx_pause=1, tx_pause=1
 	// bcmgenet_phy_pause_set(unit, unit->rx_pause, unit->tx_pause);
@@ -618,9 +1304,15 @@ int bcmgenet_gmac_eth_start(struct GenetUnit *unit)
 	}
 	Kprintf("[genet] %s: Interrupt servers installed\n", __func__);
 
-	/* Monitor link interrupts now */
-	bcmgenet_irq0_enable(unit, UMAC_IRQ_LINK_EVENT | UMAC_IRQ_PHY_DET_R);
-	bcmgenet_irq0_enable(unit, UMAC_IRQ_RXDMA_DONE | UMAC_IRQ_TXDMA_DONE);
+	/* Monitor link interrupts now, and TX FIFO underruns for the statistics */
+	bcmgenet_irq0_enable(unit, UMAC_IRQ_LINK_EVENT | UMAC_IRQ_PHY_DET_R | UMAC_IRQ_TBUF_UNDERRUN);
+	/* With TX_LAZY_RECLAIM transmit completion never interrupts */
+	unit->tx_watchdog = FALSE;
+	bcmgenet_irq0_enable(unit, UMAC_IRQ_RXDMA_DONE | (genetConfig.tx_lazy_reclaim ? 0 : UMAC_IRQ_TXDMA_DONE));
+	if (unit->rx_prio_ring.size)
+		bcmgenet_irq1_enable(unit, UMAC_IRQ1_RX_PRIO);
+	if (unit->tx_prio_ring.size && !genetConfig.tx_lazy_reclaim)
+		bcmgenet_irq1_enable(unit, UMAC_IRQ1_TX_PRIO);
 
 	/* Enable Rx/Tx */
 	setbits_32((APTR)((ULONG)unit->genetBase + UMAC_CMD), CMD_TX_EN | CMD_RX_EN);
@@ -630,6 +1322,8 @@ int bcmgenet_gmac_eth_start(struct GenetUnit *unit)
 
 err_irq:
 	RemIntServerEx(unit->irq0_number, &unit->irq0_isr);
+	if (unit->rx_prio_ring.size || unit->tx_prio_ring.size)
+		RemIntServerEx(unit->irq1_number, &unit->irq1_isr);
 
 init_dma:
 	unit->rxbuffer = NULL;
@@ -731,15 +1425,25 @@ void bcmgenet_gmac_eth_stop(struct GenetUnit *unit)
 	clrbits_32((APTR)((ULONG)unit->genetBase + UMAC_CMD), CMD_RX_EN);
 	delay_us(1000);
 	bcmgenet_disable_dma(unit);
+	/* Read requests still bound to RX descriptors go back to their queues */
+	bcmgenet_rx_dma_unbind(unit, NULL);
 	/* Disable MAC transmit. TX DMA disabled must be done before this */
 	clrbits_32((APTR)((ULONG)unit->genetBase + UMAC_CMD), CMD_TX_EN);
 	delay_us(1000);
 
 	bcmgenet_intr_disable(unit);
 	RemIntServerEx(unit->irq0_number, &unit->irq0_isr);
+	/* Statistics stay readable while offline */
+	bcmgenet_mib_harvest(unit);
+	if (unit->rx_prio_ring.size || unit->tx_prio_ring.size)
+		RemIntServerEx(unit->irq1_number, &unit->irq1_isr);
+	unit->rx_prio_ring.size = 0;
+	unit->rx_polling = FALSE;
 
 	/* tx reclaim */
 	bcmgenet_tx_reclaim(unit, TX_DESCS);
+	bcmgenet_tx_backlog_flush(unit);
+	unit->tx_prio_ring.size = 0;
 	// /* Really kill the PHY state machine and disconnect from it */
 	// phy_disconnect(dev->phydev);
 
@@ -16,6 +16,7 @@
 
 #include <devices/sana2.h>
 #include <devices/sana2specialstats.h>
+#include <devices/genet.h>
 
 #include <device.h>
 #include <minlist.h>
@@ -153,27 +154,36 @@ struct Opener *createOpener(struct TagItem *tags)
     Kprintf("[genet] %s: S2_DMACopyToBuff64 %lx\n", __func__, GetTagData(S2_DMACopyToBuff64, NULL, tags));
     Kprintf("[genet] %s: S2_DMACopyFromBuff64 %lx\n", __func__, GetTagData(S2_DMACopyFromBuff64, NULL, tags));
     Kprintf("[genet] %s: S2_Log %lx\n", __func__, GetTagData(S2_Log, NULL, tags));
+    Kprintf("[genet] %s: GENET_TxPriority %lx\n", __func__, GetTagData(GENET_TxPriority, FALSE, tags));
+    Kprintf("[genet] %s: GENET_Checksum %lx\n", __func__, GetTagData(GENET_Checksum, FALSE, tags));
 
     opener->packetFilter = (struct Hook *)GetTagData(S2_PacketFilter, NULL, tags);
     opener->CopyToBuff = (BOOL (*)(APTR, APTR, ULONG))getBufferFunction(tags, S2_CopyToBuff32, S2_CopyToBuff16, S2_CopyToBuff);
     opener->CopyFromBuff = (BOOL (*)(APTR, APTR, ULONG))getBufferFunction(tags, S2_CopyFromBuff32, S2_CopyFromBuff16, S2_CopyFromBuff);
 
-    if (genetConfig.use_dma)
+    if (genetConfig.use_dma || genetConfig.rx_zero_copy)
     {
         opener->DMACopyToBuff = (APTR (*)(APTR))GetTagData(S2_DMACopyToBuff32, NULL, tags);
+    }
+    if (genetConfig.use_dma)
+    {
         opener->DMACopyFromBuff = (APTR (*)(APTR))GetTagData(S2_DMACopyFromBuff32, NULL, tags);
+        opener->DMAGatherFromBuff = (ULONG (*)(APTR, struct GenetFragment *, ULONG))GetTagData(GENET_DMAGatherFromBuff, NULL, tags);
     }
 
+    opener->txPriority = GetTagData(GENET_TxPriority, FALSE, tags) != FALSE;
+    opener->checksum = GetTagData(GENET_Checksum, FALSE, tags) != FALSE;
+
     Kprintf("[genet] %s: CopyToBuff=%lx, CopyFromBuff=%lx, PacketFilter=%lx\n",
             __func__, opener->CopyToBuff, opener->CopyFromBuff, opener->packetFilter);
-    Kprintf("[genet] %s: DMACopyToBuff=%lx, DMACopyFromBuff=%lx\n",
-            __func__, opener->DMACopyToBuff, opener->DMACopyFromBuff);
+    Kprintf("[genet] %s: DMACopyToBuff=%lx, DMACopyFromBuff=%lx, DMAGatherFromBuff=%lx\n",
+            __func__, opener->DMACopyToBuff, opener->DMACopyFromBuff, opener->DMAGatherFromBuff);
 
     _NewMinList(&opener->readQueue);
     _NewMinList(&opener->orphanQueue);
     _NewMinList(&opener->eventQueue);
-    _NewMinList(&opener->ipv4Queue);
-    _NewMinList(&opener->arpQueue);
+    ReadRingInit(&opener->ipv4Ring);
+    ReadRingInit(&opener->arpRing);
 
     InitSemaphore(&opener->openerSemaphore);
 
@@ -208,6 +218,8 @@ void openLib(struct IOSana2Req *io asm("a1"), LONG unitNumber asm("d0"),
             io->ios2_Req.io_Error = IOERR_OPENFAIL;
             return;
         }
+        /* Once for the life of the unit, writers may be inside it whenever the unit goes online */
+        InitSemaphore(&base->unit->tx_ring.tx_ring_sem);
     }
 
     if (flags & SANA2OPF_MINE && base->unit->unit.unit_OpenCnt > 0)
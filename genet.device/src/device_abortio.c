@@ -19,7 +19,8 @@ LONG abortIO(struct IOSana2Req *io asm("a1"), struct GenetDevice *base asm("a6")
     {
         Forbid();
         /* If the IO was not quick and is of type message (not handled yet or in process), abord it and remove from queue. 
-         * The TX task clears ln_Pred to indicate the request is already on TX ring and can't be cancelled. */
+         * The TX task clears ln_Pred to indicate the request is already on TX ring and can't be cancelled,
+         * reads in a read ring have it cleared as well. */
         if ((io->ios2_Req.io_Flags & IOF_QUICK) == 0 && io->ios2_Req.io_Message.mn_Node.ln_Type == NT_MESSAGE && io->ios2_Req.io_Message.mn_Node.ln_Pred != NULL)
         {
             Remove(&io->ios2_Req.io_Message.mn_Node);
@@ -27,6 +28,16 @@ LONG abortIO(struct IOSana2Req *io asm("a1"), struct GenetDevice *base asm("a6")
             io->ios2_WireError = S2WERR_GENERIC_ERROR;
             ReplyMsg(&io->ios2_Req.io_Message);
         }
+        /* A read in an opener's read ring or bound to an RX descriptor is replied by the unit task */
+        else if (io->ios2_Req.io_Command == CMD_READ && (io->ios2_Req.io_Flags & IOF_QUICK) == 0 && io->ios2_Req.io_Message.mn_Node.ln_Type == NT_MESSAGE)
+        {
+            struct GenetUnit *unit = (struct GenetUnit *)io->ios2_Req.io_Unit;
+            io->ios2_Req.io_Error = IOERR_ABORTED;
+            io->ios2_WireError = S2WERR_GENERIC_ERROR;
+            unit->readAborted = TRUE;
+            if (unit->task)
+                Signal(unit->task, 1UL << unit->unit.unit_MsgPort.mp_SigBit);
+        }
         Permit();
     }
     KprintfH("[genet] %s: IO request %lx aborted\n", __func__, io);
@@ -13,12 +13,25 @@ void beginIO(struct IOSana2Req *io asm("a1"), struct GenetDevice *base asm("a6")
 {
     struct GenetUnit *unit = (struct GenetUnit *)io->ios2_Req.io_Unit;
 
-    if ((io->ios2_Req.io_Command == CMD_WRITE || io->ios2_Req.io_Command == S2_BROADCAST) && AttemptSemaphore(&unit->tx_ring.tx_ring_sem))
+    /* Writes go on the TX ring from the caller's task, or from the one holding the ring */
+    if (io->ios2_Req.io_Command == CMD_WRITE || io->ios2_Req.io_Command == S2_BROADCAST)
     {
-        KprintfH("[genet] %s: Quick CMD_WRITE\n", __func__);
-        ProcessCommand(io);
-        ReleaseSemaphore(&unit->tx_ring.tx_ring_sem);
+        KprintfH("[genet] %s: CMD_WRITE\n", __func__);
+        if (likely(unit->state == STATE_ONLINE))
+        {
+            bcmgenet_tx_enqueue(unit, io);
+        }
+        else
+        {
+            /* Nobody would send it from the intake, fail it here like Do_CMD_WRITE() does */
+            Kprintf("[genet] %s: Unit is offline, cannot write\n", __func__);
+            io->ios2_WireError = S2WERR_UNIT_OFFLINE;
+            io->ios2_Req.io_Error = S2ERR_OUTOFSERVICE;
+            if (!(io->ios2_Req.io_Flags & IOF_QUICK))
+                ReplyMsg((struct Message *)io);
+        }
     }
+    /* Reads are posted straight into the opener's read ring, the semaphore only serializes producers */
     else if (io->ios2_Req.io_Command == CMD_READ && AttemptSemaphore(&((struct Opener *)io->ios2_BufferManagement)->openerSemaphore))
     {
         KprintfH("[genet] %s: Quick CMD_READ\n", __func__);
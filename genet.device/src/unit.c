@@ -125,6 +125,14 @@ int UnitConfigure(struct GenetUnit *unit)
 		return result;
 	}
 
+	/* Rate limits from the prefs, GENETCMD_SETTXRATE changes them until the unit is closed */
+	bcmgenet_tx_shape_set(&unit->tx_ring, genetConfig.tx_rate_kbps, genetConfig.tx_rate_burst);
+	bcmgenet_tx_shape_set(&unit->tx_prio_ring, genetConfig.tx_prio_rate_kbps, genetConfig.tx_rate_burst);
+
+	/* Trace events from the prefs, GENETCMD_SETTRACE changes them until the unit is closed */
+	if (genetConfig.trace_events && !TraceStart(unit, genetConfig.trace_events))
+		Kprintf("[genet] %s: No trace, TRACE_EVENTS ignored\n", __func__);
+
 	unit->state = STATE_CONFIGURED;
 	return S2ERR_NO_ERROR;
 }
@@ -164,8 +172,13 @@ int UnitClose(struct GenetUnit *unit, struct Opener *opener)
 			UnitOffline(unit);
 		}
 		UnitTaskStop(unit);
+		unit->traceMask = 0;
 		DeletePool(unit->memoryPool);
 		unit->memoryPool = NULL;
+		/* Type statistics and the trace were allocated from the pool */
+		unit->typeStats = NULL;
+		unit->typeStatsCount = 0;
+		unit->trace = NULL;
 		unit->state = STATE_UNCONFIGURED;
 	}
 	else if (opener != NULL)
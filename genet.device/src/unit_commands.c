@@ -14,6 +14,7 @@
 #include <device.h>
 #include <debug.h>
 #include <compat.h>
+#include <runtime_config.h>
 
 static const UWORD GENET_SupportedCommands[] = {
     CMD_FLUSH,
@@ -27,11 +28,12 @@ static const UWORD GENET_SupportedCommands[] = {
     S2_DELMULTICASTADDRESS,
     S2_MULTICAST,
     S2_BROADCAST,
-    // S2_TRACKTYPE,
-    // S2_UNTRACKTYPE,
-    // S2_GETTYPESTATS,
-    // S2_GETSPECIALSTATS,
+    S2_TRACKTYPE,
+    S2_UNTRACKTYPE,
+    S2_GETTYPESTATS,
+    S2_GETSPECIALSTATS,
     S2_GETGLOBALSTATS,
+    S2_GETEXTENDEDGLOBALSTATS,
     S2_ONEVENT,
     S2_READORPHAN,
     S2_ONLINE,
@@ -40,6 +42,13 @@ static const UWORD GENET_SupportedCommands[] = {
     S2_DELMULTICASTADDRESSES,
 
     NSCMD_DEVICEQUERY,
+
+    GENETCMD_GETTXRATE,
+    GENETCMD_SETTXRATE,
+    GENETCMD_GETSTATS,
+    GENETCMD_GETLATENCY,
+    GENETCMD_GETTRACE,
+    GENETCMD_SETTRACE,
     0};
 
 /* Mask of events known by the driver */
@@ -51,6 +60,7 @@ static const UWORD GENET_SupportedCommands[] = {
 void ReportEvents(struct GenetUnit *unit, ULONG eventSet)
 {
     KprintfH("[genet] %s: Reporting events %08lx\n", __func__, eventSet);
+    Trace(unit, GENET_TRACE_EVENT, eventSet, 0);
 
     /* Report event to every listener of every opener accepting the mask */
     for (struct MinNode *node = unit->openers.mlh_Head; node->mln_Succ; node = node->mln_Succ)
@@ -128,6 +138,10 @@ static int Do_CMD_FLUSH(struct IOSana2Req *io)
         ReplyMsg((struct Message *)req);
     }
 
+    /* Reads bound to RX descriptors are flushed with the queues */
+    if (unit->state == STATE_ONLINE)
+        bcmgenet_rx_dma_unbind(unit, NULL);
+
     /* For every opener, flush all internal queues */
     for (struct MinNode *node = unit->openers.mlh_Head; node->mln_Succ; node = node->mln_Succ)
     {
@@ -154,14 +168,14 @@ static int Do_CMD_FLUSH(struct IOSana2Req *io)
             ReplyMsg((struct Message *)req);
         }
 
-        while ((req = (struct IOSana2Req *)RemHeadMinList(&opener->ipv4Queue)))
+        while ((req = ReadRingGet(&opener->ipv4Ring)))
         {
             req->ios2_Req.io_Error = IOERR_ABORTED;
             req->ios2_WireError = 0;
             ReplyMsg((struct Message *)req);
         }
 
-        while ((req = (struct IOSana2Req *)RemHeadMinList(&opener->arpQueue)))
+        while ((req = ReadRingGet(&opener->arpRing)))
         {
             req->ios2_Req.io_Error = IOERR_ABORTED;
             req->ios2_WireError = 0;
@@ -174,6 +188,57 @@ static int Do_CMD_FLUSH(struct IOSana2Req *io)
     return COMMAND_PROCESSED;
 }
 
+/* Reply aborted requests of a ring, the pending ones are kept in order. Producers are held off by openerSemaphore */
+static void ReplyAbortedInRing(struct ReadRing *ring)
+{
+    struct IOSana2Req **link = &ring->stash;
+    while (*link)
+    {
+        struct IOSana2Req *req = *link;
+        if (req->ios2_Req.io_Error == IOERR_ABORTED)
+        {
+            *link = (struct IOSana2Req *)req->ios2_Req.io_Message.mn_Node.ln_Succ;
+            ring->stashed--;
+            ReplyMsg((struct Message *)req);
+        }
+        else
+        {
+            link = (struct IOSana2Req **)&req->ios2_Req.io_Message.mn_Node.ln_Succ;
+        }
+    }
+
+    UWORD kept = ring->tail;
+    for (UWORD i = ring->tail; i != ring->head; i++)
+    {
+        struct IOSana2Req *req = ring->slot[i & (READ_RING_SIZE - 1)];
+        if (req->ios2_Req.io_Error == IOERR_ABORTED)
+            ReplyMsg((struct Message *)req);
+        else
+            ring->slot[kept++ & (READ_RING_SIZE - 1)] = req;
+    }
+    __atomic_store_n(&ring->head, kept, __ATOMIC_RELEASE);
+}
+
+/* abortIO() only marks reads it can't unlink, the unit task replies them here */
+void ReplyAbortedReads(struct GenetUnit *unit)
+{
+    KprintfH("[genet] %s: Replying aborted reads\n", __func__);
+    unit->readAborted = FALSE;
+
+    /* Reads bound to RX descriptors are replied when taken off the ring */
+    if (unit->state == STATE_ONLINE)
+        bcmgenet_rx_dma_unbind(unit, NULL);
+
+    for (struct MinNode *node = unit->openers.mlh_Head; node->mln_Succ; node = node->mln_Succ)
+    {
+        struct Opener *opener = (struct Opener *)node;
+        ObtainSemaphore(&opener->openerSemaphore);
+        ReplyAbortedInRing(&opener->ipv4Ring);
+        ReplyAbortedInRing(&opener->arpRing);
+        ReleaseSemaphore(&opener->openerSemaphore);
+    }
+}
+
 static int Do_NSCMD_DEVICEQUERY(struct IOStdReq *io)
 {
     KprintfH("[genet] %s: NSCMD_DEVICEQUERY\n", __func__);
@@ -211,15 +276,31 @@ static inline int Do_CMD_READ(struct IOSana2Req *io)
     struct Opener *opener = io->ios2_BufferManagement;
     UWORD packetType = io->ios2_PacketType;
 
-    /* Get the appropriate queue for this packet type */
-    struct MinList *queue = GetPacketTypeQueue(opener, packetType);
+    /* Get the appropriate ring for this packet type */
+    struct ReadRing *ring = GetPacketTypeRing(opener, packetType);
 
     /* Queue the request */
     io->ios2_Req.io_Flags &= ~IOF_QUICK;
     ObtainSemaphore(&opener->openerSemaphore);
-    AddTailMinList(queue, (struct MinNode *)io);
+    BOOL queued = TRUE;
+    if (likely(ring != NULL))
+        queued = ReadRingPut(ring, io);
+    else
+        AddTailMinList(&opener->readQueue, (struct MinNode *)io);
     ReleaseSemaphore(&opener->openerSemaphore);
 
+    /* Someone reads this type now, the MAC must not drop it anymore */
+    if (unlikely(ring == NULL && unit->hfbCount))
+        bcmgenet_hfb_accept(unit, packetType);
+
+    if (unlikely(!queued))
+    {
+        Kprintf("[genet] %s: Too many reads pending for packet type 0x%lx\n", __func__, packetType);
+        io->ios2_WireError = S2WERR_BUFF_ERROR;
+        io->ios2_Req.io_Error = S2ERR_NO_RESOURCES;
+        return COMMAND_PROCESSED;
+    }
+
     KprintfH("[genet] %s: Queued CMD_READ request for packet type 0x%lx\n", __func__, packetType);
     return COMMAND_SCHEDULED;
 }
@@ -240,6 +321,10 @@ static inline int Do_S2_READORPHAN(struct IOSana2Req *io)
     struct Opener *opener = io->ios2_BufferManagement;
     // io->ios2_Req.io_Flags &= ~IOF_QUICK;
     AddTailMinList(&opener->orphanQueue, (struct MinNode *)io);
+
+    /* Orphans of any type are wanted again */
+    if (unlikely(unit->hfbCount))
+        bcmgenet_hfb_accept(unit, 0);
     return COMMAND_SCHEDULED;
 }
 
@@ -380,12 +465,211 @@ static int Do_S2_OFFLINE(struct IOSana2Req *io)
     return COMMAND_PROCESSED;
 }
 
+/* Rate limit of a TX ring, kept in the ring so a new one applies to the next frame */
+static int Do_GENETCMD_TXRATE(struct IOSana2Req *io)
+{
+    struct GenetUnit *unit = (struct GenetUnit *)io->ios2_Req.io_Unit;
+    struct GenetTxRate *rate = io->ios2_StatData;
+    BOOL set = io->ios2_Req.io_Command == GENETCMD_SETTXRATE;
+
+    if (rate == NULL)
+    {
+        io->ios2_WireError = S2WERR_NULL_POINTER;
+        io->ios2_Req.io_Error = S2ERR_BAD_ARGUMENT;
+        return COMMAND_PROCESSED;
+    }
+    Kprintf("[genet] %s: %s ring %ld\n", __func__, set ? "GENETCMD_SETTXRATE" : "GENETCMD_GETTXRATE", rate->gtr_Ring);
+
+    if (rate->gtr_Ring > GENET_TXRING_PRIORITY || (rate->gtr_Ring == GENET_TXRING_PRIORITY && !genetConfig.tx_prio_ring))
+    {
+        io->ios2_WireError = S2WERR_BAD_STATDATA;
+        io->ios2_Req.io_Error = S2ERR_BAD_ARGUMENT;
+        return COMMAND_PROCESSED;
+    }
+
+    struct bcmgenet_tx_ring *ring = rate->gtr_Ring == GENET_TXRING_PRIORITY ? &unit->tx_prio_ring : &unit->tx_ring;
+    bcmgenet_tx_lock(unit);
+    if (set)
+    {
+        Kprintf("[genet] %s: %ld kbit/s, burst %ld bytes\n", __func__, rate->gtr_Rate, rate->gtr_Burst);
+        bcmgenet_tx_shape_set(ring, rate->gtr_Rate, rate->gtr_Burst);
+    }
+    rate->gtr_Rate = ring->shape_rate;
+    rate->gtr_Burst = ring->shape_burst;
+    bcmgenet_tx_unlock(unit);
+
+    /* Writes the old limit held back may go now */
+    if (set && unit->state == STATE_ONLINE)
+        bcmgenet_tx_backlog_drain(unit);
+
+    return COMMAND_PROCESSED;
+}
+
+static inline void SetQuad(S2QUAD *quad, Counter64 value)
+{
+    quad->s2q_High = value >> 32;
+    quad->s2q_Low = value;
+}
+
+/* Both copy what fits into the caller's structure, which may be from an older or newer version */
+static int Do_S2_GETEXTENDEDGLOBALSTATS(struct IOSana2Req *io)
+{
+    struct GenetUnit *unit = (struct GenetUnit *)io->ios2_Req.io_Unit;
+    struct Sana2ExtDeviceStats *stats = io->ios2_StatData;
+    struct Sana2ExtDeviceStats ext;
+
+    KprintfH("[genet] %s: S2_GETEXTENDEDGLOBALSTATS\n", __func__);
+    if (stats == NULL)
+    {
+        io->ios2_WireError = S2WERR_NULL_POINTER;
+        io->ios2_Req.io_Error = S2ERR_BAD_ARGUMENT;
+        return COMMAND_PROCESSED;
+    }
+
+    _memset(&ext, 0, sizeof(ext));
+    ext.s2xds_Length = stats->s2xds_Length;
+    ext.s2xds_Actual = sizeof(ext);
+    SetQuad(&ext.s2xds_PacketsReceived, unit->internalStats.rx_packets);
+    SetQuad(&ext.s2xds_PacketsSent, unit->internalStats.tx_packets);
+    SetQuad(&ext.s2xds_BadData, unit->internalStats.rx_other_errors + unit->internalStats.rx_crc_errors +
+                                    unit->internalStats.rx_frame_errors + unit->internalStats.rx_length_errors +
+                                    unit->internalStats.rx_fragmented_errors);
+    SetQuad(&ext.s2xds_Overruns, unit->internalStats.rx_overruns + unit->internalStats.tx_dropped);
+    SetQuad(&ext.s2xds_UnknownTypesReceived, unit->internalStats.rx_dropped);
+    ext.s2xds_LastStart = unit->internalStats.last_start;
+
+    CopyMem(&ext, stats, stats->s2xds_Length < sizeof(ext) ? stats->s2xds_Length : sizeof(ext));
+    return COMMAND_PROCESSED;
+}
+
+/* Share of part in total, in 32-bit arithmetic as there is no 64-bit division */
+static ULONG Percent(Counter64 part, Counter64 total)
+{
+    while (total >= (1UL << 25))
+    {
+        part >>= 1;
+        total >>= 1;
+    }
+    return total ? (ULONG)part * 100 / (ULONG)total : 0;
+}
+
+static int Do_S2_GETSPECIALSTATS(struct IOSana2Req *io)
+{
+    struct GenetUnit *unit = (struct GenetUnit *)io->ios2_Req.io_Unit;
+    struct Sana2SpecialStatHeader *header = io->ios2_StatData;
+    struct internal_stats *stats = &unit->internalStats;
+
+    KprintfH("[genet] %s: S2_GETSPECIALSTATS\n", __func__);
+    if (header == NULL)
+    {
+        io->ios2_WireError = S2WERR_NULL_POINTER;
+        io->ios2_Req.io_Error = S2ERR_BAD_ARGUMENT;
+        return COMMAND_PROCESSED;
+    }
+
+    if (unit->state == STATE_ONLINE)
+        bcmgenet_mib_harvest(unit);
+
+    /* Good frames the MAC took in against the ones that showed up in a ring */
+    Counter64 ringed = stats->rx_packets + stats->rx_bad_multicast + stats->rx_overruns + stats->rx_other_errors +
+                       stats->rx_frame_errors + stats->rx_length_errors + stats->rx_fragmented_errors;
+    Counter64 good = stats->mib[GENET_MIB_RX_GOOD];
+
+    const struct Sana2SpecialStatRecord records[] = {
+        {S2SS_ETHERNET_BADMULTICAST, stats->rx_bad_multicast, (STRPTR) "Unwanted multicast frames"},
+        {S2SS_ETHERNET_RETRIES, stats->mib[GENET_MIB_TX_COLLISIONS], (STRPTR) "Collisions"},
+        {S2SS_ETHERNET_FIFO_UNDERRUNS, stats->tx_underruns, (STRPTR) "TX FIFO underruns"},
+        {GENETSS_RX_DISCARDS, stats->rx_overruns, (STRPTR) "RX ring full discards"},
+        {GENETSS_TX_RING_FULL, stats->tx_ring_full, (STRPTR) "TX ring full drops"},
+        {GENETSS_RX_ZERO_COPY, stats->rx_dma, (STRPTR) "RX zero copy"},
+        {GENETSS_RX_COPY, stats->rx_packets - stats->rx_dma, (STRPTR) "RX copied"},
+        {GENETSS_RX_ZERO_COPY_PERCENT, Percent(stats->rx_dma, stats->rx_packets), (STRPTR) "RX zero copy %"},
+        {GENETSS_TX_ZERO_COPY, stats->tx_dma, (STRPTR) "TX zero copy"},
+        {GENETSS_TX_COPY, stats->tx_copy, (STRPTR) "TX copied"},
+        {GENETSS_TX_ZERO_COPY_PERCENT, Percent(stats->tx_dma, stats->tx_dma + stats->tx_copy), (STRPTR) "TX zero copy %"},
+        {GENETSS_RX_FILTERED, good > ringed ? good - ringed : 0, (STRPTR) "RX hardware filter drops"},
+        {GENETSS_INTERRUPTS_PER_SEC, unit->irqs_per_sec, (STRPTR) "Interrupts/s"},
+    };
+
+    struct Sana2SpecialStatRecord *out = (struct Sana2SpecialStatRecord *)(header + 1);
+    ULONG count = sizeof(records) / sizeof(records[0]);
+    if (count > header->RecordCountMax)
+        count = header->RecordCountMax;
+    for (ULONG i = 0; i < count; i++)
+        out[i] = records[i];
+    header->RecordCountSupplied = count;
+
+    return COMMAND_PROCESSED;
+}
+
+static int Do_GENETCMD_GETSTATS(struct IOSana2Req *io)
+{
+    struct GenetUnit *unit = (struct GenetUnit *)io->ios2_Req.io_Unit;
+    struct GenetStats *stats = io->ios2_StatData;
+    struct GenetStats genet;
+
+    KprintfH("[genet] %s: GENETCMD_GETSTATS\n", __func__);
+    if (stats == NULL)
+    {
+        io->ios2_WireError = S2WERR_NULL_POINTER;
+        io->ios2_Req.io_Error = S2ERR_BAD_ARGUMENT;
+        return COMMAND_PROCESSED;
+    }
+
+    /* Up to date MIB counters rather than the ones of the last periodic harvest */
+    if (unit->state == STATE_ONLINE)
+        bcmgenet_mib_harvest(unit);
+
+    genet.gs_Length = stats->gs_Length;
+    genet.gs_Actual = sizeof(genet);
+    SetQuad(&genet.gs_PacketsReceived, unit->internalStats.rx_packets);
+    SetQuad(&genet.gs_BytesReceived, unit->internalStats.rx_bytes);
+    SetQuad(&genet.gs_PacketsSent, unit->internalStats.tx_packets);
+    SetQuad(&genet.gs_BytesSent, unit->internalStats.tx_bytes);
+    for (ULONG i = 0; i < GENET_MIB_COUNT; i++)
+        SetQuad(&genet.gs_Mib[i], unit->internalStats.mib[i]);
+
+    CopyMem(&genet, stats, stats->gs_Length < sizeof(genet) ? stats->gs_Length : sizeof(genet));
+    return COMMAND_PROCESSED;
+}
+
+static int Do_GENETCMD_GETLATENCY(struct IOSana2Req *io)
+{
+    struct GenetUnit *unit = (struct GenetUnit *)io->ios2_Req.io_Unit;
+    struct GenetLatency *latency = io->ios2_StatData;
+    struct GenetLatency genet;
+
+    KprintfH("[genet] %s: GENETCMD_GETLATENCY\n", __func__);
+    if (latency == NULL)
+    {
+        io->ios2_WireError = S2WERR_NULL_POINTER;
+        io->ios2_Req.io_Error = S2ERR_BAD_ARGUMENT;
+        return COMMAND_PROCESSED;
+    }
+
+    if (!genetConfig.latency_stats)
+    {
+        io->ios2_Req.io_Error = S2ERR_NOT_SUPPORTED;
+        return COMMAND_PROCESSED;
+    }
+
+    genet.gl_Length = latency->gl_Length;
+    genet.gl_Actual = sizeof(genet);
+    CopyMem(unit->internalStats.latency_max, genet.gl_Max, sizeof(genet.gl_Max));
+    CopyMem(unit->internalStats.latency, genet.gl_Histogram, sizeof(genet.gl_Histogram));
+
+    CopyMem(&genet, latency, latency->gl_Length < sizeof(genet) ? latency->gl_Length : sizeof(genet));
+    return COMMAND_PROCESSED;
+}
+
 void ProcessCommand(struct IOSana2Req *io)
 {
     struct GenetUnit *unit = (struct GenetUnit *)io->ios2_Req.io_Unit;
 
     ULONG complete = COMMAND_SCHEDULED;
 
+    Trace(unit, GENET_TRACE_COMMAND, io->ios2_Req.io_Command, (ULONG)io);
+
     /*
         Only NSCMD_DEVICEQUERY can use standard sized request. All other must be of
         size IOSana2Req
@@ -453,6 +737,26 @@ void ProcessCommand(struct IOSana2Req *io)
             complete = COMMAND_PROCESSED;
             break;
 
+        case S2_GETEXTENDEDGLOBALSTATS:
+            complete = Do_S2_GETEXTENDEDGLOBALSTATS(io);
+            break;
+
+        case S2_GETSPECIALSTATS:
+            complete = Do_S2_GETSPECIALSTATS(io);
+            break;
+
+        case S2_TRACKTYPE:
+            complete = Do_S2_TRACKTYPE(io);
+            break;
+
+        case S2_UNTRACKTYPE:
+            complete = Do_S2_UNTRACKTYPE(io);
+            break;
+
+        case S2_GETTYPESTATS:
+            complete = Do_S2_GETTYPESTATS(io);
+            break;
+
         case S2_ADDMULTICASTADDRESS: /* Fallthrough */
         case S2_ADDMULTICASTADDRESSES:
             complete = Do_S2_ADDMULTICASTADDRESSES(io);
@@ -483,6 +787,24 @@ void ProcessCommand(struct IOSana2Req *io)
             complete = Do_S2_ONEVENT(io);
             break;
 
+        case GENETCMD_GETTXRATE: /* Fallthrough */
+        case GENETCMD_SETTXRATE:
+            complete = Do_GENETCMD_TXRATE(io);
+            break;
+
+        case GENETCMD_GETSTATS:
+            complete = Do_GENETCMD_GETSTATS(io);
+            break;
+        case GENETCMD_GETLATENCY:
+            complete = Do_GENETCMD_GETLATENCY(io);
+            break;
+        case GENETCMD_GETTRACE:
+            complete = Do_GENETCMD_GETTRACE(io);
+            break;
+        case GENETCMD_SETTRACE:
+            complete = Do_GENETCMD_SETTRACE(io);
+            break;
+
         default:
             io->ios2_Req.io_Error = IOERR_NOCMD;
             complete = COMMAND_PROCESSED;
@@ -0,0 +1,182 @@
+// SPDX-License-Identifier: MPL-2.0 OR GPL-2.0+
+#ifdef __INTELLISENSE__
+#include <clib/exec_protos.h>
+#else
+#include <proto/exec.h>
+#endif
+
+#include <exec/types.h>
+#include <exec/memory.h>
+#include <devices/sana2.h>
+
+#include <device.h>
+#include <debug.h>
+#include <compat.h>
+#include <runtime_config.h>
+
+/* 802.3 frames carry a length there, they are all one type */
+static inline UWORD TrackedType(ULONG packetType)
+{
+    return packetType <= ETH_DATA_LEN ? ETH_DATA_LEN : (UWORD)packetType;
+}
+
+/* Multiplicative hash, the golden ratio in 16 bits spreads neighbouring types */
+static inline ULONG TypeStatsSlot(struct GenetUnit *unit, UWORD type)
+{
+    return ((ULONG)type * 40503 >> 8) & unit->typeStatsMask;
+}
+
+/*
+ * Called for every frame while a type is tracked: from ReceiveFrame() in the
+ * unit task and from bcmgenet_xmit() in whichever task sends. Probes at most
+ * the whole table, deleted slots do not end the search.
+ */
+struct TypeStats *FindTypeStats(struct GenetUnit *unit, UWORD packetType)
+{
+    UWORD type = TrackedType(packetType);
+    ULONG slot = TypeStatsSlot(unit, type);
+
+    for (ULONG i = 0; i <= unit->typeStatsMask; i++)
+    {
+        struct TypeStats *stats = &unit->typeStats[slot];
+        if (stats->type == type)
+            return stats;
+        if (stats->type == TYPE_STATS_EMPTY)
+            return NULL;
+        slot = (slot + 1) & unit->typeStatsMask;
+    }
+    return NULL;
+}
+
+static BOOL AllocTypeStats(struct GenetUnit *unit)
+{
+    ULONG max = genetConfig.tracked_types < TYPE_STATS_MAX ? genetConfig.tracked_types : TYPE_STATS_MAX;
+    ULONG size = 1;
+
+    /* At most half full, probe sequences stay short */
+    while (size < max * 2)
+        size <<= 1;
+
+    unit->typeStats = AllocPooled(unit->memoryPool, size * sizeof(struct TypeStats));
+    if (unit->typeStats == NULL)
+        return FALSE;
+    _memset(unit->typeStats, 0, size * sizeof(struct TypeStats));
+    unit->typeStatsMask = size - 1;
+    unit->typeStatsCount = 0;
+    return TRUE;
+}
+
+int Do_S2_TRACKTYPE(struct IOSana2Req *io)
+{
+    struct GenetUnit *unit = (struct GenetUnit *)io->ios2_Req.io_Unit;
+    UWORD type = TrackedType(io->ios2_PacketType);
+
+    Kprintf("[genet] %s: Tracking packet type 0x%04lx\n", __func__, type);
+
+    /* Marks deleted slots, not a type anyone sends */
+    if (type == TYPE_STATS_DELETED)
+    {
+        io->ios2_Req.io_Error = S2ERR_BAD_ARGUMENT;
+        return COMMAND_PROCESSED;
+    }
+
+    if (genetConfig.tracked_types == 0)
+    {
+        io->ios2_Req.io_Error = S2ERR_NOT_SUPPORTED;
+        return COMMAND_PROCESSED;
+    }
+
+    if (unit->typeStats == NULL && !AllocTypeStats(unit))
+    {
+        Kprintf("[genet] %s: Failed to allocate memory for type statistics\n", __func__);
+        io->ios2_Req.io_Error = S2ERR_NO_RESOURCES;
+        ReportEvents(unit, S2EVENT_SOFTWARE | S2EVENT_ERROR);
+        return COMMAND_PROCESSED;
+    }
+
+    /* Tracked already, by another opener or the same one. Counted like multicast addresses */
+    struct TypeStats *stats = FindTypeStats(unit, type);
+    if (stats != NULL)
+    {
+        stats->users++;
+        return COMMAND_PROCESSED;
+    }
+
+    /* The table was sized by TRACKED_TYPES when it was allocated, the prefs may have changed since */
+    if (unit->typeStatsCount >= genetConfig.tracked_types || unit->typeStatsCount >= (unit->typeStatsMask + 1) / 2)
+    {
+        io->ios2_Req.io_Error = S2ERR_NO_RESOURCES;
+        io->ios2_WireError = S2WERR_GENERIC_ERROR;
+        return COMMAND_PROCESSED;
+    }
+
+    /* The table is never full, there is an empty or deleted slot on the way */
+    ULONG slot = TypeStatsSlot(unit, type);
+    while (unit->typeStats[slot].type != TYPE_STATS_EMPTY && unit->typeStats[slot].type != TYPE_STATS_DELETED)
+        slot = (slot + 1) & unit->typeStatsMask;
+
+    stats = &unit->typeStats[slot];
+    _memset(stats, 0, sizeof(struct TypeStats));
+    stats->users = 1;
+    __atomic_store_n(&stats->type, type, __ATOMIC_RELEASE);
+    unit->typeStatsCount++;
+
+    return COMMAND_PROCESSED;
+}
+
+int Do_S2_UNTRACKTYPE(struct IOSana2Req *io)
+{
+    struct GenetUnit *unit = (struct GenetUnit *)io->ios2_Req.io_Unit;
+    UWORD type = TrackedType(io->ios2_PacketType);
+    struct TypeStats *stats = unit->typeStatsCount ? FindTypeStats(unit, type) : NULL;
+
+    Kprintf("[genet] %s: Untracking packet type 0x%04lx\n", __func__, type);
+
+    if (stats == NULL)
+    {
+        io->ios2_Req.io_Error = S2ERR_BAD_STATE;
+        io->ios2_WireError = S2WERR_NOT_TRACKED;
+        return COMMAND_PROCESSED;
+    }
+
+    if (--stats->users == 0)
+    {
+        stats->type = TYPE_STATS_DELETED;
+        /* Nothing tracked, start over without deleted slots */
+        if (--unit->typeStatsCount == 0)
+            _memset(unit->typeStats, 0, (unit->typeStatsMask + 1) * sizeof(struct TypeStats));
+    }
+
+    return COMMAND_PROCESSED;
+}
+
+int Do_S2_GETTYPESTATS(struct IOSana2Req *io)
+{
+    struct GenetUnit *unit = (struct GenetUnit *)io->ios2_Req.io_Unit;
+    struct Sana2PacketTypeStats *out = io->ios2_StatData;
+    struct TypeStats *stats = unit->typeStatsCount ? FindTypeStats(unit, io->ios2_PacketType) : NULL;
+
+    KprintfH("[genet] %s: S2_GETTYPESTATS 0x%04lx\n", __func__, io->ios2_PacketType);
+
+    if (out == NULL)
+    {
+        io->ios2_WireError = S2WERR_NULL_POINTER;
+        io->ios2_Req.io_Error = S2ERR_BAD_ARGUMENT;
+        return COMMAND_PROCESSED;
+    }
+
+    if (stats == NULL)
+    {
+        io->ios2_Req.io_Error = S2ERR_BAD_STATE;
+        io->ios2_WireError = S2WERR_NOT_TRACKED;
+        return COMMAND_PROCESSED;
+    }
+
+    out->PacketsSent = stats->packetsSent;
+    out->PacketsReceived = stats->packetsReceived;
+    out->BytesSent = stats->bytesSent;
+    out->BytesReceived = stats->bytesReceived;
+    out->PacketsDropped = stats->packetsDropped;
+
+    return COMMAND_PROCESSED;
+}
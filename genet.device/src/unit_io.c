@@ -7,6 +7,7 @@
 #include <proto/exec.h>
 #endif
 
+#include <devices/genet.h>
 #include <genet/bcmgenet-regs.h>
 #include <device.h>
 #include <compat.h>
@@ -50,6 +51,14 @@ static inline void CopyPacket(struct IOSana2Req *io, UBYTE *packet, ULONG packet
         KprintfH("[genet] %s: Packet is a broadcast (DMA flag)\n", __func__);
         io->ios2_Req.io_Flags |= SANA2IOF_BCAST;
     }
+
+    /* Checksums verified from the Receive Status Block, for openers that asked with GENET_Checksum */
+    if (unlikely(opener->checksum))
+    {
+        io->ios2_Req.io_Flags &= ~GENETIOF_CHECKSUM;
+        if (dma_flags & RX_CSUM_OK)
+            io->ios2_Req.io_Flags |= GENETIOF_CHECKSUM;
+    }
    
     /*
         If RAW packet is requested, copy everything, otherwise copy only contents of
@@ -73,6 +82,17 @@ static inline void CopyPacket(struct IOSana2Req *io, UBYTE *packet, ULONG packet
         packetFiltered = TRUE;
     }
 
+    /* Zero-copy RX: the frame is already in this request's buffer, the RX loop replies it */
+    if (unlikely(io == unit->rx_ring.dma_io))
+    {
+        if (!packetFiltered)
+        {
+            io->ios2_DataLength = packetLength;
+            unit->rx_ring.dma_io = NULL;
+        }
+        return;
+    }
+
     /* Packet not filtered. Send it now and reply request. */
     if (likely(!packetFiltered))
     {
@@ -89,6 +109,8 @@ static inline void CopyPacket(struct IOSana2Req *io, UBYTE *packet, ULONG packet
         /* Set number of bytes received */
         io->ios2_DataLength = packetLength;
 
+        if (unlikely(genetConfig.latency_stats))
+            LatencyRxReply(unit);
         ReplyMsg((struct Message *)io);
         KprintfH("[genet] %s: Packet copied and request replied\n", __func__);
     }
@@ -111,12 +133,19 @@ static inline BOOL MulticastFilter(struct GenetUnit *unit, uint64_t destAddr)
 
 BOOL ReceiveFrame(struct GenetUnit *unit, UBYTE *packet, ULONG packetLength, ULONG dma_flags)
 {
+    if (unlikely(genetConfig.latency_stats))
+    {
+        unit->lat_rx_frame = SystemClock();
+        LatencyRecord(unit, GENET_LATENCY_RX_RING, unit->lat_rx_pickup, unit->lat_rx_frame);
+    }
+
     /* We only need to filter in software if MDF is not enabled */
     if (unlikely(!unit->mdfEnabled && (dma_flags & DMA_RX_MULT)))
     {
         uint64_t destAddr = ((uint64_t)*(UWORD *)&packet[0] << 32) | *(ULONG *)&packet[2];
         if (!MulticastFilter(unit, destAddr))
         {
+            unit->internalStats.rx_bad_multicast++;
             return FALSE; // Not a multicast address we accept, drop the packet
         }
     }
@@ -124,21 +153,43 @@ BOOL ReceiveFrame(struct GenetUnit *unit, UBYTE *packet, ULONG packetLength, ULO
     unit->internalStats.rx_packets++;
     unit->internalStats.rx_bytes += packetLength;
     UWORD packetType = *(UWORD *)&packet[12];
+    struct TypeStats *typeStats = NULL;
+    if (unlikely(unit->typeStatsCount))
+    {
+        typeStats = FindTypeStats(unit, packetType);
+        if (typeStats)
+        {
+            typeStats->packetsReceived++;
+            typeStats->bytesReceived += packetLength;
+        }
+    }
+    struct IOSana2Req *dmaIo = unit->rx_ring.dma_io;
     UBYTE orphan = TRUE;
     BOOL activity = FALSE;
     KprintfH("[genet] %s: Received packet of length %ld with type 0x%lx\n", __func__, packetLength, packetType);
+    Trace(unit, GENET_TRACE_RX_FRAME, packetLength, packetType);
 
-    /* Fast path for common packet types */
-    //TODO get rid of semaphores
+    /* Fast path for common packet types, the read rings need no lock on this side */
     if (likely(packetType == 0x0800 || packetType == 0x0806))
     {
         for (struct MinNode *node = unit->openers.mlh_Head; node->mln_Succ; node = node->mln_Succ)
         {
             struct Opener *opener = (struct Opener *)node;
-            struct MinList *queue = GetPacketTypeQueue(opener, packetType);
-            ObtainSemaphore(&opener->openerSemaphore);
-            struct IOSana2Req *io = (struct IOSana2Req *)RemHeadMinList(queue);
-            ReleaseSemaphore(&opener->openerSemaphore);
+            struct IOSana2Req *io = NULL;
+
+            /* The request the frame was received into was the head of this ring, bcmgenet_rx_dma_return() replies it if aborted */
+            if (unlikely(dmaIo != NULL) && dmaIo->ios2_BufferManagement == opener && dmaIo->ios2_PacketType == packetType &&
+                dmaIo->ios2_Req.io_Error == 0)
+            {
+                io = dmaIo;
+            }
+            else
+            {
+                /* AbortIO() cannot unlink a read from the ring, it only marks it. Reply those on the way to a live one */
+                struct ReadRing *ring = packetType == 0x0800 ? &opener->ipv4Ring : &opener->arpRing;
+                while ((io = ReadRingGet(ring)) != NULL && unlikely(io->ios2_Req.io_Error))
+                    ReplyMsg((struct Message *)io);
+            }
 
             if (likely(io != NULL))
             {
@@ -202,6 +253,16 @@ BOOL ReceiveFrame(struct GenetUnit *unit, UBYTE *packet, ULONG packetLength, ULO
             }
             /* Continue to offer to other openers with orphan requests */
         }
+
+        Trace(unit, GENET_TRACE_RX_ORPHAN, packetType, activity);
+
+        /* Nobody wants this type, let the MAC drop it from now on */
+        if (!activity)
+        {
+            if (typeStats)
+                typeStats->packetsDropped++;
+            bcmgenet_hfb_discard(unit, packetType);
+        }
     }
     return activity;
 }
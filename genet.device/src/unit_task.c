@@ -20,6 +20,29 @@
 
 struct Device *TimerBase = NULL;
 
+/* Mask the RX interrupts, the unit task polls the rings from now on */
+static void RxPollStart(struct GenetUnit *unit)
+{
+    KprintfH("[genet] %s: %ld packets/s, polling RX\n", __func__, unit->rx_ring.packets_per_sec);
+    Trace(unit, GENET_TRACE_POLL, 1, unit->rx_ring.packets_per_sec);
+    unit->rx_polling = TRUE;
+    unit->rx_idle_polls = 0;
+    bcmgenet_irq0_disable(unit, UMAC_IRQ_RXDMA_DONE);
+    if (unit->rx_prio_ring.size)
+        bcmgenet_irq1_disable(unit, UMAC_IRQ1_RX_PRIO);
+}
+
+/* The line went quiet, back to RX interrupts */
+static void RxPollStop(struct GenetUnit *unit)
+{
+    KprintfH("[genet] %s: %ld empty polls, back to RX interrupts\n", __func__, unit->rx_idle_polls);
+    Trace(unit, GENET_TRACE_POLL, 0, unit->rx_ring.packets_per_sec);
+    unit->rx_polling = FALSE;
+    bcmgenet_irq0_enable(unit, UMAC_IRQ_RXDMA_DONE);
+    if (unit->rx_prio_ring.size)
+        bcmgenet_irq1_enable(unit, UMAC_IRQ1_RX_PRIO);
+}
+
 static void UnitTask(struct GenetUnit *unit, struct Task *parent)
 {
     // Initialize the built in msg port, we'll receive commands here
@@ -41,7 +64,17 @@ static void UnitTask(struct GenetUnit *unit, struct Task *parent)
     struct MsgPort *microHZTimerPort = CreateMsgPort();
     unit->openerPort = CreateMsgPort();
     struct timerequest *packetTimerReq = CreateIORequest(microHZTimerPort, sizeof(struct timerequest));
-    if (microHZTimerPort == NULL || unit->openerPort == NULL || packetTimerReq == NULL)
+    /* Paces RX polling, replies to the same port as the housekeeping timer */
+    struct timerequest *pollTimerReq = CreateIORequest(microHZTimerPort, sizeof(struct timerequest));
+    BOOL pollTimerPending = FALSE;
+    /* Wakes the TX backlog once a rate limit lets frames go again */
+    struct timerequest *shapeTimerReq = CreateIORequest(microHZTimerPort, sizeof(struct timerequest));
+    BOOL shapeTimerPending = FALSE;
+    /* TX_LAZY_RECLAIM: replies finished writes nobody else picked up */
+    struct timerequest *reclaimTimerReq = CreateIORequest(microHZTimerPort, sizeof(struct timerequest));
+    BOOL reclaimTimerPending = FALSE;
+    if (microHZTimerPort == NULL || unit->openerPort == NULL || packetTimerReq == NULL || pollTimerReq == NULL ||
+        shapeTimerReq == NULL || reclaimTimerReq == NULL)
     {
         Kprintf("[genet] %s: Failed to create timer msg port or request\n", __func__);
         goto free_ports;
@@ -56,6 +89,12 @@ static void UnitTask(struct GenetUnit *unit, struct Task *parent)
 
     /* used to reset stats on S2_ONLINE */
     TimerBase = packetTimerReq->tr_node.io_Device;
+    pollTimerReq->tr_node.io_Device = packetTimerReq->tr_node.io_Device;
+    pollTimerReq->tr_node.io_Unit = packetTimerReq->tr_node.io_Unit;
+    shapeTimerReq->tr_node.io_Device = packetTimerReq->tr_node.io_Device;
+    shapeTimerReq->tr_node.io_Unit = packetTimerReq->tr_node.io_Unit;
+    reclaimTimerReq->tr_node.io_Device = packetTimerReq->tr_node.io_Device;
+    reclaimTimerReq->tr_node.io_Unit = packetTimerReq->tr_node.io_Unit;
 
     // Start the timer
     packetTimerReq->tr_node.io_Command = TR_ADDREQUEST;
@@ -87,9 +126,15 @@ static void UnitTask(struct GenetUnit *unit, struct Task *parent)
         {
             budget = genetConfig.budget;
             struct IOSana2Req *io;
-            // Drain command queue and process it
-            while ((io = (struct IOSana2Req *)GetMsg(&unit->unit.unit_MsgPort)) && --budget)
+
+            /* abortIO() could not unlink a read, it signalled us to reply it */
+            if (unlikely(unit->readAborted))
+                ReplyAbortedReads(unit);
+
+            // Drain command queue and process it. Writes do not come this way, beginIO() sends them
+            while (budget && (io = (struct IOSana2Req *)GetMsg(&unit->unit.unit_MsgPort)))
             {
+                budget--;
                 ProcessCommand(io);
             }
             if (budget == 0)
@@ -113,7 +158,11 @@ static void UnitTask(struct GenetUnit *unit, struct Task *parent)
                     break;
                 case OPENER_CMD_REM:
                     if (omsg->opener)
+                    {
+                        if (unit->state == STATE_ONLINE)
+                            bcmgenet_rx_dma_unbind(unit, omsg->opener);
                         RemoveMinNode((struct MinNode *)omsg->opener);
+                    }
                     break;
                 }
                 ReplyMsg(&omsg->msg);
@@ -125,12 +174,46 @@ static void UnitTask(struct GenetUnit *unit, struct Task *parent)
             }
         }
 
+        /* Poll interval is over, look at the RX rings again */
+        if (pollTimerPending && (sigset & (1UL << microHZTimerPort->mp_SigBit)) && CheckIO(&pollTimerReq->tr_node))
+        {
+            WaitIO(&pollTimerReq->tr_node);
+            pollTimerPending = FALSE;
+            sigset |= 1UL << unit->irq0_signal;
+        }
+
         /* process IRQ0 events */
         if (sigset & (1UL << unit->irq0_signal))
         {
             KprintfH("[genet] %s: Interrupt bottom-half processing, status=0x%08lx\n", __func__, unit->irq0_status);
             ULONG status = unit->irq0_status;
+            ULONG status1 = unit->irq1_status;
             unit->irq0_status = 0;
+            unit->irq1_status = 0;
+            Trace(unit, GENET_TRACE_BOTTOM_HALF, status, status1);
+            ULONG received = 0;
+            BOOL backlog = FALSE;
+
+            /* Frames received after an interrupt, or behind those of a full budget, keep the time of that interrupt */
+            if (unlikely(genetConfig.latency_stats))
+            {
+                ULONG irq = unit->lat_irq;
+                unit->lat_irq = 0;
+                unit->lat_rx_pickup = SystemClock();
+                if (irq)
+                {
+                    LatencyRecord(unit, GENET_LATENCY_RX_IRQ, irq, unit->lat_rx_pickup);
+                    unit->lat_rx_irq = irq;
+                }
+            }
+
+            /* While polling every wake-up looks at both rings, their interrupts stay masked */
+            if (unit->rx_polling)
+            {
+                status |= UMAC_IRQ_RXDMA_DONE;
+                if (unit->rx_prio_ring.size)
+                    status1 |= UMAC_IRQ1_RX_PRIO;
+            }
 
             if (unlikely((status & UMAC_IRQ_PHY_DET_R) && unit->phydev->autoneg != AUTONEG_ENABLE))
             {
@@ -152,43 +235,176 @@ static void UnitTask(struct GenetUnit *unit, struct Task *parent)
                 Kprintf("[genet] %s: PHY link up event\n", __func__);
             }
 
+            /* Transmit completion: reply every finished write in one pass, then fill the freed descriptors */
+            if ((status & UMAC_IRQ_TXDMA_DONE || status1 & UMAC_IRQ1_TX_PRIO) && unit->state == STATE_ONLINE)
+            {
+                bcmgenet_tx_reclaim(unit, TX_DESCS);
+                bcmgenet_tx_backlog_drain(unit);
+                if (status & UMAC_IRQ_TXDMA_DONE)
+                    bcmgenet_irq0_enable(unit, UMAC_IRQ_TXDMA_DONE);
+                if (status1 & UMAC_IRQ1_TX_PRIO)
+                    bcmgenet_irq1_enable(unit, UMAC_IRQ1_TX_PRIO);
+            }
+
+            /* Priority ring first, ARP and ICMP must not wait behind a budget of bulk frames */
+            if (unlikely((status1 & UMAC_IRQ1_RX_PRIO) && unit->state == STATE_ONLINE))
+            {
+                budget = genetConfig.budget;
+                int res = bcmgenet_gmac_eth_rx(unit, &unit->rx_prio_ring, budget);
+                if (res > 0)
+                {
+                    received += res;
+                }
+                if (res == budget)
+                {
+                    // Still more to process, signal ourselves again
+                    backlog = TRUE;
+                    unit->irq1_status |= UMAC_IRQ1_RX_PRIO;
+                    Signal(unit->task, 1UL << unit->irq0_signal);
+                }
+                else if (!unit->rx_polling)
+                {
+                    bcmgenet_irq1_enable(unit, UMAC_IRQ1_RX_PRIO);
+                }
+            }
+
             /* Receive processing */
             if (likely((status & UMAC_IRQ_RXDMA_DONE) && unit->state == STATE_ONLINE))
             {
                 KprintfH("[genet] %s: RX signal received, processing packets\n", __func__);
                 budget = genetConfig.budget;
-                int res = bcmgenet_gmac_eth_rx(unit, budget);
+                int res = bcmgenet_gmac_eth_rx(unit, &unit->rx_ring, budget);
                 if (res > 0)
                 {
                     budget -= res;
+                    received += res;
                 }
                 KprintfH("[genet] %s: Remaining budget: %ld\n", __func__, budget);
                 if (budget == 0)
                 {
+                    if (genetConfig.rx_adaptive_coalesce)
+                        bcmgenet_rx_moderate_backlog(unit);
                     // Still more to process, signal ourselves again
+                    backlog = TRUE;
                     unit->irq0_status |= UMAC_IRQ_RXDMA_DONE;
                     Signal(unit->task, 1UL << unit->irq0_signal);
                 }
-                else
+                else if (!unit->rx_polling)
                 {
                     /* We caught up, enable interrupts */
                     bcmgenet_irq0_enable(unit, UMAC_IRQ_RXDMA_DONE);
                 }
             }
-        }
 
-        // Timer expired, query PHY for link state, reclaim TX
-        if (sigset & (1UL << microHZTimerPort->mp_SigBit))
-        {
-            if (CheckIO(&packetTimerReq->tr_node))
+            /* Caught up, frames found by a poll had no interrupt */
+            if (!backlog)
+                unit->lat_rx_irq = 0;
+
+            /* Replies of a two-way stream ride along with its receive interrupts */
+            if (genetConfig.tx_lazy_reclaim && unit->state == STATE_ONLINE)
+                bcmgenet_tx_reclaim_lazy(unit);
+
+            /*
+             * Polling: a full budget goes on right away, otherwise the next
+             * poll waits for the poll timer so other tasks get the CPU. After
+             * enough empty polls in a row the interrupts take over again.
+             */
+            if (unit->rx_polling && !backlog && unit->state == STATE_ONLINE)
             {
-                WaitIO(&packetTimerReq->tr_node);
+                if (received)
+                    unit->rx_idle_polls = 0;
+                else if (++unit->rx_idle_polls >= genetConfig.rx_poll_idle)
+                    RxPollStop(unit);
+
+                if (unit->rx_polling && !pollTimerPending)
+                {
+                    pollTimerReq->tr_node.io_Command = TR_ADDREQUEST;
+                    pollTimerReq->tr_time.tv_secs = 0;
+                    pollTimerReq->tr_time.tv_micro = genetConfig.rx_poll_usecs;
+                    SendIO(&pollTimerReq->tr_node);
+                    pollTimerPending = TRUE;
+                }
             }
+        }
+
+        /* Tokens are back, send what the rate limit held */
+        if (shapeTimerPending && (sigset & (1UL << microHZTimerPort->mp_SigBit)) && CheckIO(&shapeTimerReq->tr_node))
+        {
+            WaitIO(&shapeTimerReq->tr_node);
+            shapeTimerPending = FALSE;
+            if (unit->state == STATE_ONLINE)
+                bcmgenet_tx_backlog_drain(unit);
+        }
+
+        /* Deadline for the replies of writes still in flight */
+        if (reclaimTimerPending && (sigset & (1UL << microHZTimerPort->mp_SigBit)) && CheckIO(&reclaimTimerReq->tr_node))
+        {
+            WaitIO(&reclaimTimerReq->tr_node);
+            reclaimTimerPending = FALSE;
+            if (unit->state == STATE_ONLINE)
+                bcmgenet_tx_watchdog(unit);
+        }
+
+        if (unit->tx_watchdog && !reclaimTimerPending && unit->state == STATE_ONLINE)
+        {
+            reclaimTimerReq->tr_node.io_Command = TR_ADDREQUEST;
+            reclaimTimerReq->tr_time.tv_secs = 0;
+            reclaimTimerReq->tr_time.tv_micro = genetConfig.tx_reclaim_usecs;
+            SendIO(&reclaimTimerReq->tr_node);
+            reclaimTimerPending = TRUE;
+        }
+
+        /* A rate limit holds writes back, wake up when they may go */
+        if (unit->tx_shape_usecs && !shapeTimerPending && unit->state == STATE_ONLINE)
+        {
+            shapeTimerReq->tr_node.io_Command = TR_ADDREQUEST;
+            shapeTimerReq->tr_time.tv_secs = unit->tx_shape_usecs / 1000000;
+            shapeTimerReq->tr_time.tv_micro = unit->tx_shape_usecs % 1000000;
+            unit->tx_shape_usecs = 0;
+            SendIO(&shapeTimerReq->tr_node);
+            shapeTimerPending = TRUE;
+        }
+
+        // Timer expired, query PHY for link state, reclaim TX, harvest MIB counters
+        if ((sigset & (1UL << microHZTimerPort->mp_SigBit)) && CheckIO(&packetTimerReq->tr_node))
+        {
+            WaitIO(&packetTimerReq->tr_node);
 
             /* Just in case we got stuck */
             if (unit->state == STATE_ONLINE)
             {
-                bcmgenet_irq0_enable(unit, UMAC_IRQ_TXDMA_DONE | UMAC_IRQ_RXDMA_DONE);
+                ULONG txIrq = genetConfig.tx_lazy_reclaim ? 0 : UMAC_IRQ_TXDMA_DONE;
+                if (genetConfig.tx_lazy_reclaim)
+                {
+                    bcmgenet_tx_watchdog(unit);
+                }
+                else
+                {
+                    bcmgenet_tx_reclaim(unit, TX_DESCS);
+                    bcmgenet_tx_backlog_drain(unit);
+                }
+                bcmgenet_rx_moderate(unit, genetConfig.periodic_task_ms);
+                bcmgenet_mib_harvest(unit);
+                bcmgenet_irq_sample(unit, genetConfig.periodic_task_ms);
+                if (!unit->rx_polling && genetConfig.rx_poll_rate &&
+                    unit->rx_ring.packets_per_sec >= genetConfig.rx_poll_rate)
+                    RxPollStart(unit);
+
+                if (unit->tx_prio_ring.size && txIrq)
+                    bcmgenet_irq1_enable(unit, UMAC_IRQ1_TX_PRIO);
+                if (unit->rx_polling)
+                {
+                    if (txIrq)
+                        bcmgenet_irq0_enable(unit, txIrq);
+                    if (!pollTimerPending)
+                        Signal(unit->task, 1UL << unit->irq0_signal);
+                }
+                else
+                {
+                    bcmgenet_irq0_enable(unit, txIrq | UMAC_IRQ_RXDMA_DONE);
+                    if (unit->rx_prio_ring.size)
+                        bcmgenet_irq1_enable(unit, UMAC_IRQ1_RX_PRIO);
+                }
             }
 
             // TODO pool PHY for state, BCM2711 genet has a bug where PHY interrupts don't work properly
@@ -205,11 +421,29 @@ static void UnitTask(struct GenetUnit *unit, struct Task *parent)
             Kprintf("[genet] %s: Received SIGBREAKF_CTRL_C, stopping genet task\n", __func__);
             AbortIO(&packetTimerReq->tr_node);
             WaitIO(&packetTimerReq->tr_node);
+            if (pollTimerPending)
+            {
+                AbortIO(&pollTimerReq->tr_node);
+                WaitIO(&pollTimerReq->tr_node);
+            }
+            if (shapeTimerPending)
+            {
+                AbortIO(&shapeTimerReq->tr_node);
+                WaitIO(&shapeTimerReq->tr_node);
+            }
+            if (reclaimTimerPending)
+            {
+                AbortIO(&reclaimTimerReq->tr_node);
+                WaitIO(&reclaimTimerReq->tr_node);
+            }
         }
     } while ((sigset & SIGBREAKF_CTRL_C) == 0);
 
     CloseDevice(&packetTimerReq->tr_node);
 free_ports:
+    DeleteIORequest(&reclaimTimerReq->tr_node);
+    DeleteIORequest(&shapeTimerReq->tr_node);
+    DeleteIORequest(&pollTimerReq->tr_node);
     DeleteIORequest(&packetTimerReq->tr_node);
     DeleteMsgPort(microHZTimerPort);
     DeleteMsgPort(unit->openerPort);
@@ -0,0 +1,146 @@
+// SPDX-License-Identifier: MPL-2.0 OR GPL-2.0+
+#ifdef __INTELLISENSE__
+#include <clib/exec_protos.h>
+#else
+#include <proto/exec.h>
+#endif
+
+#include <exec/types.h>
+#include <exec/memory.h>
+#include <devices/sana2.h>
+
+#include <device.h>
+#include <debug.h>
+#include <compat.h>
+#include <runtime_config.h>
+
+/* Not a sequence of any entry written yet, marks entries being written */
+#define TRACE_INVALID 0xffffffff
+
+#define TRACE_VALID_EVENTS ((1UL << GENET_TRACE_EVENTS) - 1)
+
+/*
+ * Called through Trace() from the interrupts, the unit task and every task
+ * that sends, without a lock: the atomic add hands each writer its own
+ * entry. The sequence goes in last, a reader that finds another one knows
+ * the entry was being written or was overwritten.
+ */
+void TraceRecord(struct GenetUnit *unit, ULONG event, ULONG arg0, ULONG arg1)
+{
+    ULONG sequence = __atomic_fetch_add(&unit->traceNext, 1, __ATOMIC_RELAXED);
+    struct GenetTraceEntry *entry = &unit->trace[sequence & unit->traceSlots];
+
+    __atomic_store_n(&entry->gte_Sequence, TRACE_INVALID, __ATOMIC_RELAXED);
+    entry->gte_Time = SystemClock();
+    entry->gte_Event = event;
+    entry->gte_Arg[0] = arg0;
+    entry->gte_Arg[1] = arg1;
+    __atomic_store_n(&entry->gte_Sequence, sequence, __ATOMIC_RELEASE);
+}
+
+/*
+ * Record the events in mask from now on, allocating the trace the first time
+ * an event is enabled. From the unit task, the trace stays until the unit is
+ * closed. Returns FALSE when there is no trace to record to.
+ */
+BOOL TraceStart(struct GenetUnit *unit, ULONG mask)
+{
+    mask &= TRACE_VALID_EVENTS;
+
+    if (mask && unit->trace == NULL)
+    {
+        ULONG size = 2;
+
+        if (genetConfig.trace_records == 0)
+            return FALSE;
+
+        while (size < genetConfig.trace_records)
+            size <<= 1;
+
+        struct GenetTraceEntry *trace = AllocPooled(unit->memoryPool, size * sizeof(struct GenetTraceEntry));
+        if (trace == NULL)
+        {
+            Kprintf("[genet] %s: Failed to allocate %ld trace entries\n", __func__, size);
+            return FALSE;
+        }
+        _memset(trace, 0xff, size * sizeof(struct GenetTraceEntry));
+
+        unit->traceSlots = size - 1;
+        unit->traceNext = 0;
+        __atomic_store_n(&unit->trace, trace, __ATOMIC_RELEASE);
+    }
+
+    Kprintf("[genet] %s: Tracing events 0x%08lx\n", __func__, mask);
+    __atomic_store_n(&unit->traceMask, mask, __ATOMIC_RELEASE);
+    return TRUE;
+}
+
+int Do_GENETCMD_GETTRACE(struct IOSana2Req *io)
+{
+    struct GenetUnit *unit = (struct GenetUnit *)io->ios2_Req.io_Unit;
+    struct GenetTrace *out = io->ios2_StatData;
+    struct GenetTrace header;
+
+    KprintfH("[genet] %s: GENETCMD_GETTRACE\n", __func__);
+    if (out == NULL)
+    {
+        io->ios2_WireError = S2WERR_NULL_POINTER;
+        io->ios2_Req.io_Error = S2ERR_BAD_ARGUMENT;
+        return COMMAND_PROCESSED;
+    }
+
+    ULONG entries = unit->trace ? unit->traceSlots + 1 : 0;
+    ULONG room = out->gt_Length > sizeof(header) ? (out->gt_Length - sizeof(header)) / sizeof(struct GenetTraceEntry) : 0;
+    ULONG next = __atomic_load_n(&unit->traceNext, __ATOMIC_ACQUIRE);
+    ULONG count = next < entries ? next : entries;
+
+    if (count > room)
+        count = room;
+
+    header.gt_Length = out->gt_Length;
+    header.gt_Actual = sizeof(header) + entries * sizeof(struct GenetTraceEntry);
+    header.gt_Magic = GENET_TRACE_MAGIC;
+    header.gt_Mask = unit->traceMask;
+    header.gt_Next = next;
+    header.gt_Count = count;
+    CopyMem(&header, out, out->gt_Length < sizeof(header) ? out->gt_Length : sizeof(header));
+
+    /* Writers go on meanwhile, an entry that changed under the copy is left for the reader to drop */
+    for (ULONG i = 0; i < count; i++)
+    {
+        ULONG sequence = next - count + i;
+        struct GenetTraceEntry *entry = &unit->trace[sequence & unit->traceSlots];
+        ULONG before = __atomic_load_n(&entry->gte_Sequence, __ATOMIC_ACQUIRE);
+
+        out->gt_Entry[i] = *entry;
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&entry->gte_Sequence, __ATOMIC_RELAXED) != before)
+            out->gt_Entry[i].gte_Sequence = TRACE_INVALID;
+    }
+
+    return COMMAND_PROCESSED;
+}
+
+int Do_GENETCMD_SETTRACE(struct IOSana2Req *io)
+{
+    struct GenetUnit *unit = (struct GenetUnit *)io->ios2_Req.io_Unit;
+    ULONG *mask = io->ios2_StatData;
+
+    if (mask == NULL)
+    {
+        io->ios2_WireError = S2WERR_NULL_POINTER;
+        io->ios2_Req.io_Error = S2ERR_BAD_ARGUMENT;
+        return COMMAND_PROCESSED;
+    }
+
+    ULONG previous = unit->traceMask;
+    if (!TraceStart(unit, *mask))
+    {
+        io->ios2_Req.io_Error = S2ERR_NO_RESOURCES;
+        io->ios2_WireError = S2WERR_GENERIC_ERROR;
+        return COMMAND_PROCESSED;
+    }
+
+    *mask = previous;
+    return COMMAND_PROCESSED;
+}
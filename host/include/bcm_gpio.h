@@ -0,0 +1,33 @@
+// SPDX-License-Identifier: MPL-2.0 OR GPL-2.0+
+/* Host (Linux) variant of the common bcm_gpio.h. There are no pins to mux on the host. */
+#ifndef _BCM_GPIO_H
+#define _BCM_GPIO_H
+
+#include <exec/types.h>
+
+#define PIN_RGMII_MDIO 28
+#define PIN_RGMII_MDC 29
+
+#define GPIO_AF_INPUT 0
+#define GPIO_AF_OUTPUT 1
+#define GPIO_AF_5 2
+
+#define GPIO_PULL_NONE 0
+#define GPIO_PULL_DOWN 1
+#define GPIO_PULL_UP 2
+
+static inline void gpioSetAlternate(APTR gpioBase, ULONG pin, ULONG function)
+{
+    (void)gpioBase;
+    (void)pin;
+    (void)function;
+}
+
+static inline void gpioSetPull(APTR gpioBase, ULONG pin, ULONG pull)
+{
+    (void)gpioBase;
+    (void)pin;
+    (void)pull;
+}
+
+#endif /* _BCM_GPIO_H */
@@ -0,0 +1,66 @@
+// SPDX-License-Identifier: MPL-2.0 OR GPL-2.0+
+/*
+ * Host (Linux) variant of the common compat.h.
+ *
+ * Register accessors are routed through the host MMIO window, so every
+ * access that lands in a simulated block (see genet_sim.h) is decoded by
+ * the model instead of touching plain memory. The host is little endian,
+ * like the GENET, so no byte swapping is needed.
+ */
+#ifndef _COMPAT_H
+#define _COMPAT_H
+
+#include <exec/types.h>
+#include <errno.h>
+#include <limits.h>
+
+#include <minlist.h>
+
+#define likely(x) __builtin_expect(!!(x), 1)
+#define unlikely(x) __builtin_expect(!!(x), 0)
+
+#define BIT(nr) (1UL << (nr))
+#define roundup(x, y) ((((x) + ((y) - 1)) / (y)) * (y))
+
+#define ARCH_DMA_MINALIGN 64
+
+#define LE32(x) (x)
+#define LE16(x) (x)
+
+/* MMIO window claimed by the simulator, [host_mmio_start, host_mmio_end) */
+extern uintptr_t host_mmio_start;
+extern uintptr_t host_mmio_end;
+
+ULONG host_mmio_read(uintptr_t addr);
+void host_mmio_write(uintptr_t addr, ULONG value);
+
+static inline ULONG mmio_read32(uintptr_t addr)
+{
+    if (addr - host_mmio_start < host_mmio_end - host_mmio_start)
+        return host_mmio_read(addr);
+    return *(volatile ULONG *)addr;
+}
+
+static inline void mmio_write32(uintptr_t addr, ULONG value)
+{
+    if (addr - host_mmio_start < host_mmio_end - host_mmio_start)
+        host_mmio_write(addr, value);
+    else
+        *(volatile ULONG *)addr = value;
+}
+
+#define readl(addr) mmio_read32((uintptr_t)(addr))
+#define writel(value, addr) mmio_write32((uintptr_t)(addr), (ULONG)(value))
+
+#define setbits_32(addr, set) writel(readl(addr) | (set), addr)
+#define clrbits_32(addr, clear) writel(readl(addr) & ~(clear), addr)
+#define clrsetbits_32(addr, clear, set) writel((readl(addr) & ~(clear)) | (set), addr)
+
+void delay_us(ULONG us);
+
+static inline void *_memset(void *ptr, int value, ULONG len)
+{
+    return __builtin_memset(ptr, value, len);
+}
+
+#endif /* _COMPAT_H */
@@ -0,0 +1,20 @@
+// SPDX-License-Identifier: MPL-2.0 OR GPL-2.0+
+/*
+ * Host (Linux) variant of the common debug.h.
+ * Kprintf() goes to stderr when GENET_HOST_DEBUG is set in the environment.
+ */
+#ifndef _DEBUG_H
+#define _DEBUG_H
+
+void Kprintf(const char *format, ...);
+
+#ifdef DEBUG_HIGH
+#define KprintfH(...) Kprintf(__VA_ARGS__)
+#else
+#define KprintfH(...) \
+    do                \
+    {                 \
+    } while (0)
+#endif
+
+#endif /* _DEBUG_H */
@@ -0,0 +1,49 @@
+// SPDX-License-Identifier: MPL-2.0 OR GPL-2.0+
+/*
+ * Host (Linux) stand-in for the NDK devices/timer.h.
+ * The libc struct timeval is pulled in first and the Amiga one is renamed,
+ * so both can live in the same translation unit.
+ */
+#ifndef DEVICES_TIMER_H
+#define DEVICES_TIMER_H
+
+#include <sys/time.h>
+
+#include <exec/types.h>
+#include <exec/io.h>
+
+#define timeval TimeVal
+
+#define UNIT_MICROHZ 0
+#define UNIT_VBLANK 1
+#define UNIT_ECLOCK 2
+#define UNIT_WAITUNTIL 3
+#define UNIT_WAITECLOCK 4
+
+#define TIMERNAME "timer.device"
+
+struct timeval
+{
+    ULONG tv_secs;
+    ULONG tv_micro;
+};
+
+typedef struct timeval TimeVal_Type;
+
+struct EClockVal
+{
+    ULONG ev_hi;
+    ULONG ev_lo;
+};
+
+struct timerequest
+{
+    struct IORequest tr_node;
+    struct timeval tr_time;
+};
+
+#define TR_ADDREQUEST CMD_NONSTD
+#define TR_GETSYSTIME (CMD_NONSTD + 1)
+#define TR_SETSYSTIME (CMD_NONSTD + 2)
+
+#endif /* DEVICES_TIMER_H */
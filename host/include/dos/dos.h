@@ -0,0 +1,25 @@
+// SPDX-License-Identifier: MPL-2.0 OR GPL-2.0+
+/* Host (Linux) stand-in for the NDK dos/dos.h */
+#ifndef DOS_DOS_H
+#define DOS_DOS_H
+
+#include <exec/types.h>
+
+typedef LONG BPTR;
+typedef LONG BSTR;
+
+#define MODE_OLDFILE 1005
+#define MODE_NEWFILE 1006
+#define MODE_READWRITE 1004
+
+#define SIGBREAKB_CTRL_C 12
+#define SIGBREAKB_CTRL_D 13
+#define SIGBREAKB_CTRL_E 14
+#define SIGBREAKB_CTRL_F 15
+
+#define SIGBREAKF_CTRL_C (1UL << SIGBREAKB_CTRL_C)
+#define SIGBREAKF_CTRL_D (1UL << SIGBREAKB_CTRL_D)
+#define SIGBREAKF_CTRL_E (1UL << SIGBREAKB_CTRL_E)
+#define SIGBREAKF_CTRL_F (1UL << SIGBREAKB_CTRL_F)
+
+#endif /* DOS_DOS_H */
@@ -0,0 +1,14 @@
+// SPDX-License-Identifier: MPL-2.0 OR GPL-2.0+
+/* Host (Linux) stand-in for the NDK dos/dosextens.h */
+#ifndef DOS_DOSEXTENS_H
+#define DOS_DOSEXTENS_H
+
+#include <exec/libraries.h>
+#include <dos/dos.h>
+
+struct DosLibrary
+{
+    struct Library dl_lib;
+};
+
+#endif /* DOS_DOSEXTENS_H */
@@ -0,0 +1,22 @@
+// SPDX-License-Identifier: MPL-2.0 OR GPL-2.0+
+/* Host (Linux) stand-in for the NDK exec/execbase.h */
+#ifndef EXEC_EXECBASE_H
+#define EXEC_EXECBASE_H
+
+#include <exec/libraries.h>
+#include <exec/tasks.h>
+
+struct ExecBase
+{
+    struct Library LibNode;
+    UWORD SoftVer;
+    UWORD AttnFlags;
+    struct Task *ThisTask;
+};
+
+/* CachePreDMA()/CachePostDMA() flags */
+#define DMA_Continue (1L << 1)
+#define DMA_NoModify (1L << 2)
+#define DMA_ReadFromRAM (1L << 3)
+
+#endif /* EXEC_EXECBASE_H */
@@ -0,0 +1,15 @@
+// SPDX-License-Identifier: MPL-2.0 OR GPL-2.0+
+/* Host (Linux) stand-in for the NDK exec/interrupts.h */
+#ifndef EXEC_INTERRUPTS_H
+#define EXEC_INTERRUPTS_H
+
+#include <exec/nodes.h>
+
+struct Interrupt
+{
+    struct Node is_Node;
+    APTR is_Data;
+    void (*is_Code)(void);
+};
+
+#endif /* EXEC_INTERRUPTS_H */
@@ -0,0 +1,40 @@
+// SPDX-License-Identifier: MPL-2.0 OR GPL-2.0+
+/* Host (Linux) stand-in for the NDK exec/memory.h */
+#ifndef EXEC_MEMORY_H
+#define EXEC_MEMORY_H
+
+#include <exec/nodes.h>
+
+struct MemEntry
+{
+    union
+    {
+        ULONG meu_Reqs;
+        APTR meu_Addr;
+    } me_Un;
+    ULONG me_Length;
+};
+
+#define me_Reqs me_Un.meu_Reqs
+#define me_Addr me_Un.meu_Addr
+
+struct MemList
+{
+    struct Node ml_Node;
+    UWORD ml_NumEntries;
+    struct MemEntry ml_ME[1];
+};
+
+#define MEMF_ANY 0L
+#define MEMF_PUBLIC (1L << 0)
+#define MEMF_CHIP (1L << 1)
+#define MEMF_FAST (1L << 2)
+#define MEMF_LOCAL (1L << 8)
+#define MEMF_24BITDMA (1L << 9)
+#define MEMF_KICK (1L << 10)
+#define MEMF_CLEAR (1L << 16)
+#define MEMF_LARGEST (1L << 17)
+#define MEMF_REVERSE (1L << 18)
+#define MEMF_TOTAL (1L << 19)
+
+#endif /* EXEC_MEMORY_H */
@@ -0,0 +1,33 @@
+// SPDX-License-Identifier: MPL-2.0 OR GPL-2.0+
+/* Host (Linux) stand-in for the NDK exec/ports.h */
+#ifndef EXEC_PORTS_H
+#define EXEC_PORTS_H
+
+#include <exec/nodes.h>
+#include <exec/lists.h>
+#include <exec/tasks.h>
+
+struct MsgPort
+{
+    struct Node mp_Node;
+    UBYTE mp_Flags;
+    UBYTE mp_SigBit;
+    void *mp_SigTask;
+    struct List mp_MsgList;
+};
+
+#define mp_SoftInt mp_SigTask
+
+#define PF_ACTION 3
+#define PA_SIGNAL 0
+#define PA_SOFTINT 1
+#define PA_IGNORE 2
+
+struct Message
+{
+    struct Node mn_Node;
+    struct MsgPort *mn_ReplyPort;
+    UWORD mn_Length;
+};
+
+#endif /* EXEC_PORTS_H */
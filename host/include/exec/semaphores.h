@@ -0,0 +1,24 @@
+// SPDX-License-Identifier: MPL-2.0 OR GPL-2.0+
+/*
+ * Host (Linux) stand-in for the NDK exec/semaphores.h.
+ * The queue and owner fields are kept for source compatibility, the actual
+ * locking is done by the exec shim.
+ */
+#ifndef EXEC_SEMAPHORES_H
+#define EXEC_SEMAPHORES_H
+
+#include <exec/nodes.h>
+#include <exec/lists.h>
+#include <exec/tasks.h>
+
+struct SignalSemaphore
+{
+    struct Node ss_Link;
+    WORD ss_NestCount;
+    struct MinList ss_WaitQueue;
+    WORD ss_QueueCount;
+    struct Task *ss_Owner;
+    WORD ss_SharedCount;
+};
+
+#endif /* EXEC_SEMAPHORES_H */
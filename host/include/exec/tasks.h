@@ -0,0 +1,62 @@
+// SPDX-License-Identifier: MPL-2.0 OR GPL-2.0+
+/* Host (Linux) stand-in for the NDK exec/tasks.h */
+#ifndef EXEC_TASKS_H
+#define EXEC_TASKS_H
+
+#include <exec/nodes.h>
+#include <exec/lists.h>
+
+struct Task
+{
+    struct Node tc_Node;
+    UBYTE tc_Flags;
+    UBYTE tc_State;
+    BYTE tc_IDNestCnt;
+    BYTE tc_TDNestCnt;
+    ULONG tc_SigAlloc;
+    ULONG tc_SigWait;
+    ULONG tc_SigRecvd;
+    ULONG tc_SigExcept;
+    UWORD tc_TrapAlloc;
+    UWORD tc_TrapAble;
+    APTR tc_ExceptData;
+    APTR tc_ExceptCode;
+    APTR tc_TrapData;
+    APTR tc_TrapCode;
+    APTR tc_SPReg;
+    APTR tc_SPLower;
+    APTR tc_SPUpper;
+    void (*tc_Switch)(void);
+    void (*tc_Launch)(void);
+    struct List tc_MemEntry;
+    APTR tc_UserData;
+
+    /* Host only: backing thread and signal state, owned by the exec shim */
+    APTR tc_Host;
+};
+
+#define TS_INVALID 0
+#define TS_ADDED 1
+#define TS_RUN 2
+#define TS_READY 3
+#define TS_WAIT 4
+#define TS_EXCEPT 5
+#define TS_REMOVED 6
+
+#define SIGB_ABORT 0
+#define SIGB_CHILD 1
+#define SIGB_BLIT 4
+#define SIGB_SINGLE 4
+#define SIGB_INTUITION 5
+#define SIGB_NET 7
+#define SIGB_DOS 8
+
+#define SIGF_ABORT (1UL << SIGB_ABORT)
+#define SIGF_CHILD (1UL << SIGB_CHILD)
+#define SIGF_BLIT (1UL << SIGB_BLIT)
+#define SIGF_SINGLE (1UL << SIGB_SINGLE)
+#define SIGF_INTUITION (1UL << SIGB_INTUITION)
+#define SIGF_NET (1UL << SIGB_NET)
+#define SIGF_DOS (1UL << SIGB_DOS)
+
+#endif /* EXEC_TASKS_H */
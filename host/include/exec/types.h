@@ -0,0 +1,64 @@
+// SPDX-License-Identifier: MPL-2.0 OR GPL-2.0+
+/*
+ * Host (Linux) stand-in for the NDK exec/types.h.
+ *
+ * Only what the driver core needs is declared here. Widths follow the 68k
+ * ABI (LONG/ULONG are 32 bit), pointers stay native. Everything the driver
+ * casts to ULONG (buffers, MMIO windows, tasks) is allocated below 4GB by
+ * the host exec shim, and the host tools are linked as non-PIE executables
+ * so that code and static data are there as well.
+ */
+#ifndef EXEC_TYPES_H
+#define EXEC_TYPES_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* The register annotations of the 68k ABI have no meaning on the host */
+#define asm(x)
+
+typedef void *APTR;
+typedef const void *CONST_APTR;
+typedef int32_t LONG;
+typedef uint32_t ULONG;
+typedef uint32_t LONGBITS;
+typedef int16_t WORD;
+typedef uint16_t UWORD;
+typedef uint16_t WORDBITS;
+typedef int8_t BYTE;
+typedef uint8_t UBYTE;
+typedef uint8_t BYTEBITS;
+typedef uint16_t RPTR;
+typedef unsigned char *STRPTR;
+typedef const unsigned char *CONST_STRPTR;
+typedef int16_t SHORT;
+typedef uint16_t USHORT;
+typedef int16_t COUNT;
+typedef uint16_t UCOUNT;
+typedef ULONG CPTR;
+typedef float FLOAT;
+typedef double DOUBLE;
+typedef int16_t BOOL;
+typedef unsigned char TEXT;
+
+#ifndef TRUE
+#define TRUE 1
+#endif
+#ifndef FALSE
+#define FALSE 0
+#endif
+
+/* NDK style NULL, so that comparisons against integer results work as on the target */
+#undef NULL
+#define NULL 0L
+
+#define BYTEMASK 0xFF
+
+#define VOID void
+#define CONST const
+#define GLOBAL extern
+#define IMPORT extern
+#define STATIC static
+#define REGISTER register
+
+#endif /* EXEC_TYPES_H */
@@ -0,0 +1,100 @@
+// SPDX-License-Identifier: MPL-2.0 OR GPL-2.0+
+/*
+ * Software model of the GENET v5 block, for running the driver core on a
+ * Linux host.
+ *
+ * The register file is mapped in low memory and registered as the host MMIO
+ * window, so the driver's readl()/writel() calls on unit->genetBase are
+ * decoded here. Modelled are:
+ *  - RDMA/TDMA rings: producer/consumer indices, discard counter, ring
+ *    enables, start/end address and buffer size registers, MBDONE
+ *    thresholds and the RX timeout registers
+ *  - the descriptor areas at GENET_RX_OFF/GENET_TX_OFF; the DMA engines
+ *    fetch and write descriptors and frame data from/to host memory
+ *  - INTRL2_0/INTRL2_1 status/mask with level-triggered delivery to the
+ *    interrupt servers registered through AddIntServerEx()
+ *  - UMAC_CMD (RX/TX enable, promiscuous), the MDF and the MAC address
+ *  - the MIB counters of good frames by size, cast and bytes, runts, and
+ *    their reset through UMAC_MIB_CTRL
+ *  - MDIO_CMD with a gigabit PHY behind it that always has link
+ *
+ * Time is simulated: the TX engine serialises frames at the configured link
+ * speed and the RX coalescing timeouts run against the same clock, which
+ * only moves when genet_sim_advance() is called. Every register access is
+ * counted and charged with a configurable bus cost, so register traffic of a
+ * code path can be compared independently of host CPU speed.
+ */
+#ifndef GENET_SIM_H
+#define GENET_SIM_H
+
+#include <exec/types.h>
+
+/* Size of the GENET register block */
+#define GENET_SIM_REGS_SIZE 0x10000
+
+/* GIC interrupt numbers handed out by the host device tree */
+#define GENET_SIM_IRQ0 189
+#define GENET_SIM_IRQ1 190
+
+/* MDIO address of the modelled PHY */
+#define GENET_SIM_PHY_ADDR 1
+
+struct GenetSim;
+
+struct GenetSimConfig
+{
+    ULONG link_mbps;     /* TX serialisation speed, 0 = frames leave instantly */
+    ULONG mmio_read_ns;  /* modelled bus cost of an uncached register read */
+    ULONG mmio_write_ns; /* modelled bus cost of an uncached register write */
+};
+
+struct GenetSimStats
+{
+    uint64_t mmio_reads;
+    uint64_t mmio_writes;
+    uint64_t desc_reads;  /* descriptor words fetched by the DMA engines */
+    uint64_t desc_writes; /* descriptor words written back by the DMA engines */
+    uint64_t bus_ns;      /* modelled time spent in register accesses */
+
+    uint64_t rx_frames;   /* frames DMA'd into an RX ring */
+    uint64_t rx_bytes;
+    uint64_t rx_discards; /* frames lost because the ring was full */
+    uint64_t rx_filtered; /* frames rejected by the MAC address filter */
+    uint64_t rx_disabled; /* frames arriving with RX or DMA disabled */
+
+    uint64_t tx_frames; /* frames put on the wire */
+    uint64_t tx_bytes;
+    uint64_t tx_descs; /* descriptors consumed by the TX engine */
+    uint64_t tx_errors; /* descriptor chains without SOP/EOP */
+    uint64_t tx_csum;   /* checksums inserted as asked by a Transmit Status Block */
+
+    uint64_t irq0_raised; /* INTRL2_0 interrupts delivered */
+    uint64_t irq1_raised; /* INTRL2_1 interrupts delivered */
+};
+
+/* Called for every frame the TX engine puts on the wire (FCS not included) */
+typedef void (*GenetSimTxSink)(void *context, const UBYTE *frame, ULONG length);
+
+struct GenetSim *genet_sim_create(const struct GenetSimConfig *config);
+void genet_sim_destroy(struct GenetSim *sim);
+struct GenetSim *genet_sim_instance(void);
+
+APTR genet_sim_regs(struct GenetSim *sim);
+const UBYTE *genet_sim_mac_address(struct GenetSim *sim);
+
+void genet_sim_set_tx_sink(struct GenetSim *sim, GenetSimTxSink sink, void *context);
+
+/* Offer a frame from the wire. Returns TRUE if it was DMA'd into a ring. */
+BOOL genet_sim_receive(struct GenetSim *sim, const UBYTE *frame, ULONG length);
+
+/* Move simulated time forward, running the TX engine and RX timeouts */
+void genet_sim_advance(struct GenetSim *sim, uint64_t ns);
+uint64_t genet_sim_now(struct GenetSim *sim);
+
+/* Number of TX descriptors posted but not yet fetched by the engine */
+ULONG genet_sim_tx_pending(struct GenetSim *sim);
+
+void genet_sim_get_stats(struct GenetSim *sim, struct GenetSimStats *stats);
+void genet_sim_reset_stats(struct GenetSim *sim);
+
+#endif /* GENET_SIM_H */
@@ -0,0 +1,56 @@
+// SPDX-License-Identifier: MPL-2.0 OR GPL-2.0+
+/*
+ * Host-only interface of the exec shim: low memory allocation, interrupt
+ * sources and the counters the host tools report.
+ *
+ * Tasks are POSIX threads, so the counters are updated atomically and can
+ * be read while the unit task is running.
+ */
+#ifndef HOST_EXEC_H
+#define HOST_EXEC_H
+
+#include <exec/types.h>
+
+struct HostExecStats
+{
+    uint64_t cache_pre_dma;       /* CachePreDMA() calls */
+    uint64_t cache_pre_dma_bytes;
+    uint64_t cache_post_dma;      /* CachePostDMA() calls */
+    uint64_t cache_post_dma_bytes;
+    uint64_t interrupts;          /* interrupt server invocations */
+    uint64_t messages_put;
+    uint64_t messages_replied;
+    uint64_t signals;             /* Signal() calls */
+    uint64_t waits;               /* Wait() calls */
+    uint64_t waits_blocked;       /* Wait() calls that had to sleep */
+    uint64_t tasks_started;
+    uint64_t semaphore_obtains;
+    uint64_t semaphore_contended; /* ObtainSemaphore() had to queue */
+    uint64_t semaphore_attempts;
+    uint64_t semaphore_attempts_failed;
+};
+
+/* Memory below 4GB, so that the driver's pointer to ULONG casts hold */
+APTR HostAllocLow(ULONG size);
+void HostFreeLow(APTR memory, ULONG size);
+
+/*
+ * Level-triggered interrupt source. The servers added with AddIntServerEx()
+ * for that irq are called for as long as asserted() returns TRUE, unless
+ * interrupts are held off with Disable().
+ */
+typedef BOOL (*HostIrqAsserted)(void *context);
+void HostRegisterInterruptSource(ULONG irq, HostIrqAsserted asserted, void *context);
+void HostUnregisterInterruptSource(ULONG irq);
+void HostCheckInterrupt(ULONG irq);
+
+void HostGetExecStats(struct HostExecStats *stats);
+void HostResetExecStats(void);
+
+/* Monotonic host clock in nanoseconds */
+uint64_t HostNanoTime(void);
+
+/* Refresh the 1MHz system timer counter mapped at 0xf2003004 */
+void HostSysTimerUpdate(void);
+
+#endif /* HOST_EXEC_H */
@@ -0,0 +1,47 @@
+// SPDX-License-Identifier: MPL-2.0 OR GPL-2.0+
+/* Host (Linux) variant of the common minlist.h */
+#ifndef _MINLIST_H
+#define _MINLIST_H
+
+#include <exec/types.h>
+#include <exec/lists.h>
+
+static inline void _NewMinList(struct MinList *list)
+{
+    list->mlh_Head = (struct MinNode *)&list->mlh_Tail;
+    list->mlh_Tail = NULL;
+    list->mlh_TailPred = (struct MinNode *)&list->mlh_Head;
+}
+
+static inline void AddHeadMinList(struct MinList *list, struct MinNode *node)
+{
+    node->mln_Succ = list->mlh_Head;
+    node->mln_Pred = (struct MinNode *)&list->mlh_Head;
+    list->mlh_Head->mln_Pred = node;
+    list->mlh_Head = node;
+}
+
+static inline void AddTailMinList(struct MinList *list, struct MinNode *node)
+{
+    node->mln_Succ = (struct MinNode *)&list->mlh_Tail;
+    node->mln_Pred = list->mlh_TailPred;
+    list->mlh_TailPred->mln_Succ = node;
+    list->mlh_TailPred = node;
+}
+
+static inline void RemoveMinNode(struct MinNode *node)
+{
+    node->mln_Pred->mln_Succ = node->mln_Succ;
+    node->mln_Succ->mln_Pred = node->mln_Pred;
+}
+
+static inline struct MinNode *RemHeadMinList(struct MinList *list)
+{
+    struct MinNode *node = list->mlh_Head;
+    if (node->mln_Succ == NULL)
+        return NULL;
+    RemoveMinNode(node);
+    return node;
+}
+
+#endif /* _MINLIST_H */
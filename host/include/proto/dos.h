@@ -0,0 +1,17 @@
+// SPDX-License-Identifier: MPL-2.0 OR GPL-2.0+
+/* Host (Linux) stand-in for <proto/dos.h> */
+#ifndef PROTO_DOS_H
+#define PROTO_DOS_H
+
+#include <exec/types.h>
+#include <dos/dos.h>
+#include <dos/dosextens.h>
+
+extern struct DosLibrary *DOSBase;
+
+BPTR Open(CONST_STRPTR name, LONG accessMode);
+LONG Close(BPTR file);
+STRPTR FGets(BPTR fh, STRPTR buf, ULONG buflen);
+LONG StrToLong(CONST_STRPTR string, LONG *value);
+
+#endif /* PROTO_DOS_H */
@@ -0,0 +1,92 @@
+// SPDX-License-Identifier: MPL-2.0 OR GPL-2.0+
+/*
+ * Host (Linux) stand-in for <proto/exec.h>.
+ * Prototypes of the exec.library calls the driver uses, implemented by the
+ * host exec shim (host/src/exec.c).
+ */
+#ifndef PROTO_EXEC_H
+#define PROTO_EXEC_H
+
+#include <exec/types.h>
+#include <exec/nodes.h>
+#include <exec/lists.h>
+#include <exec/ports.h>
+#include <exec/io.h>
+#include <exec/devices.h>
+#include <exec/tasks.h>
+#include <exec/semaphores.h>
+#include <exec/memory.h>
+#include <exec/interrupts.h>
+#include <exec/execbase.h>
+
+extern struct ExecBase *SysBase;
+
+/* Memory */
+APTR AllocMem(ULONG byteSize, ULONG requirements);
+void FreeMem(APTR memoryBlock, ULONG byteSize);
+APTR AllocVec(ULONG byteSize, ULONG requirements);
+void FreeVec(APTR memoryBlock);
+APTR CreatePool(ULONG requirements, ULONG puddleSize, ULONG threshSize);
+void DeletePool(APTR poolHeader);
+APTR AllocPooled(APTR poolHeader, ULONG memSize);
+void FreePooled(APTR poolHeader, APTR memory, ULONG memSize);
+void CopyMem(CONST_APTR source, APTR dest, ULONG size);
+void CopyMemQuick(CONST_APTR source, APTR dest, ULONG size);
+
+/* Caches */
+void CachePreDMA(CONST_APTR address, ULONG *length, ULONG flags);
+void CachePostDMA(CONST_APTR address, ULONG *length, ULONG flags);
+void CacheClearE(APTR address, ULONG length, ULONG caches);
+
+/* Lists */
+void AddHead(struct List *list, struct Node *node);
+void AddTail(struct List *list, struct Node *node);
+void Remove(struct Node *node);
+struct Node *RemHead(struct List *list);
+struct Node *RemTail(struct List *list);
+
+/* Multitasking */
+void Forbid(void);
+void Permit(void);
+void Disable(void);
+void Enable(void);
+struct Task *FindTask(CONST_STRPTR name);
+APTR AddTask(struct Task *task, APTR initPC, APTR finalPC);
+void RemTask(struct Task *task);
+BYTE SetTaskPri(struct Task *task, LONG priority);
+
+/* Signals */
+BYTE AllocSignal(LONG signalNum);
+void FreeSignal(LONG signalNum);
+void Signal(struct Task *task, ULONG signalSet);
+ULONG Wait(ULONG signalSet);
+ULONG SetSignal(ULONG newSignals, ULONG signalSet);
+
+/* Semaphores */
+void InitSemaphore(struct SignalSemaphore *sigSem);
+void ObtainSemaphore(struct SignalSemaphore *sigSem);
+ULONG AttemptSemaphore(struct SignalSemaphore *sigSem);
+void ReleaseSemaphore(struct SignalSemaphore *sigSem);
+
+/* Messages */
+struct MsgPort *CreateMsgPort(void);
+void DeleteMsgPort(struct MsgPort *port);
+void PutMsg(struct MsgPort *port, struct Message *message);
+struct Message *GetMsg(struct MsgPort *port);
+void ReplyMsg(struct Message *message);
+struct Message *WaitPort(struct MsgPort *port);
+
+/* Libraries and devices */
+struct Library *OpenLibrary(CONST_STRPTR libName, ULONG version);
+void CloseLibrary(struct Library *library);
+APTR CreateIORequest(const struct MsgPort *port, ULONG size);
+void DeleteIORequest(APTR iorequest);
+BYTE OpenDevice(CONST_STRPTR devName, ULONG unit, struct IORequest *ioRequest, ULONG flags);
+void CloseDevice(struct IORequest *ioRequest);
+BYTE DoIO(struct IORequest *ioRequest);
+void SendIO(struct IORequest *ioRequest);
+struct IORequest *CheckIO(struct IORequest *ioRequest);
+BYTE WaitIO(struct IORequest *ioRequest);
+LONG AbortIO(struct IORequest *ioRequest);
+
+#endif /* PROTO_EXEC_H */
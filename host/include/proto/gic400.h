@@ -0,0 +1,17 @@
+// SPDX-License-Identifier: MPL-2.0 OR GPL-2.0+
+/*
+ * Host (Linux) stand-in for <proto/gic400.h>.
+ * Interrupt servers registered here are raised by the GENET simulator.
+ */
+#ifndef PROTO_GIC400_H
+#define PROTO_GIC400_H
+
+#include <exec/types.h>
+#include <exec/interrupts.h>
+
+extern struct Library *GIC400_Base;
+
+LONG AddIntServerEx(ULONG irq, ULONG priority, BOOL edge, struct Interrupt *interrupt);
+void RemIntServerEx(ULONG irq, struct Interrupt *interrupt);
+
+#endif /* PROTO_GIC400_H */
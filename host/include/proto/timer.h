@@ -0,0 +1,14 @@
+// SPDX-License-Identifier: MPL-2.0 OR GPL-2.0+
+/* Host (Linux) stand-in for <proto/timer.h> */
+#ifndef PROTO_TIMER_H
+#define PROTO_TIMER_H
+
+#include <exec/types.h>
+#include <devices/timer.h>
+
+extern struct Device *TimerBase;
+
+void GetSysTime(struct timeval *dest);
+ULONG ReadEClock(struct EClockVal *dest);
+
+#endif /* PROTO_TIMER_H */
@@ -0,0 +1,18 @@
+// SPDX-License-Identifier: MPL-2.0 OR GPL-2.0+
+/* Host (Linux) stand-in for <proto/utility.h> */
+#ifndef PROTO_UTILITY_H
+#define PROTO_UTILITY_H
+
+#include <exec/types.h>
+#include <exec/libraries.h>
+#include <utility/tagitem.h>
+#include <utility/hooks.h>
+
+extern struct Library *UtilityBase;
+
+ULONG GetTagData(Tag tagValue, ULONG defaultVal, const struct TagItem *tagList);
+struct TagItem *FindTagItem(Tag tagVal, const struct TagItem *tagList);
+ULONG CallHookPkt(struct Hook *hook, APTR object, APTR paramPacket);
+LONG Stricmp(CONST_STRPTR string1, CONST_STRPTR string2);
+
+#endif /* PROTO_UTILITY_H */
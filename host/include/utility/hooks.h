@@ -0,0 +1,19 @@
+// SPDX-License-Identifier: MPL-2.0 OR GPL-2.0+
+/* Host (Linux) stand-in for the NDK utility/hooks.h */
+#ifndef UTILITY_HOOKS_H
+#define UTILITY_HOOKS_H
+
+#include <exec/nodes.h>
+
+struct Hook
+{
+    struct MinNode h_MinNode;
+    ULONG (*h_Entry)();
+    ULONG (*h_SubEntry)();
+    APTR h_Data;
+};
+
+/* On the host hooks are plain C functions: ULONG entry(struct Hook *, APTR object, APTR message) */
+typedef ULONG (*HOOKFUNC)();
+
+#endif /* UTILITY_HOOKS_H */
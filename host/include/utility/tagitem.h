@@ -0,0 +1,24 @@
+// SPDX-License-Identifier: MPL-2.0 OR GPL-2.0+
+/* Host (Linux) stand-in for the NDK utility/tagitem.h */
+#ifndef UTILITY_TAGITEM_H
+#define UTILITY_TAGITEM_H
+
+#include <exec/types.h>
+
+typedef ULONG Tag;
+
+struct TagItem
+{
+    Tag ti_Tag;
+    ULONG ti_Data;
+};
+
+#define TAG_DONE (0L)
+#define TAG_END (0L)
+#define TAG_IGNORE (1L)
+#define TAG_MORE (2L)
+#define TAG_SKIP (3L)
+
+#define TAG_USER ((ULONG)(1UL << 31))
+
+#endif /* UTILITY_TAGITEM_H */
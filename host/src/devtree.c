@@ -0,0 +1,36 @@
+// SPDX-License-Identifier: MPL-2.0 OR GPL-2.0+
+/*
+ * Host replacement of devtree_parse.c: instead of walking the device tree
+ * the unit is bound to the simulated GENET.
+ */
+#include <exec/types.h>
+
+#include <debug.h>
+#include <device.h>
+#include <genet_sim.h>
+#include <host_exec.h>
+
+static UBYTE gpioRegisters[0x100] __attribute__((aligned(64)));
+
+int DevTreeParse(struct GenetUnit *unit)
+{
+    struct GenetSim *sim = genet_sim_instance();
+    if (sim == NULL)
+    {
+        Kprintf("[genet] %s: No simulated GENET, call genet_sim_create() first\n", __func__);
+        return S2ERR_NO_RESOURCES;
+    }
+
+    unit->compatible = (CONST_STRPTR) "brcm,bcm2711-genet-v5";
+    unit->localMacAddress = genet_sim_mac_address(sim);
+    unit->phy_interface = PHY_INTERFACE_MODE_RGMII_RXID;
+    unit->genetBase = genet_sim_regs(sim);
+    unit->irq0_number = GENET_SIM_IRQ0;
+    unit->irq1_number = GENET_SIM_IRQ1;
+    unit->phyaddr = GENET_SIM_PHY_ADDR;
+    unit->gpioBase = gpioRegisters;
+
+    Kprintf("[genet] %s: compatible: %s\n", __func__, unit->compatible);
+    Kprintf("[genet] %s: register base: %08lx\n", __func__, unit->genetBase);
+    return 0;
+}
@@ -0,0 +1,69 @@
+// SPDX-License-Identifier: MPL-2.0 OR GPL-2.0+
+/*
+ * Host (Linux) dos.library shim. Just enough to read the runtime
+ * configuration: ENV: is mapped to the directory named by $GENET_HOST_ENV.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <proto/dos.h>
+
+#define MAX_FILES 16
+
+static FILE *files[MAX_FILES];
+
+BPTR Open(CONST_STRPTR name, LONG accessMode)
+{
+    const char *path = (const char *)name;
+    char hostPath[1024];
+
+    if (strncmp(path, "ENV:", 4) == 0)
+    {
+        const char *env = getenv("GENET_HOST_ENV");
+        if (!env)
+            return 0;
+        snprintf(hostPath, sizeof(hostPath), "%s/%s", env, path + 4);
+        path = hostPath;
+    }
+
+    for (int i = 0; i < MAX_FILES; i++)
+    {
+        if (files[i] == NULL)
+        {
+            files[i] = fopen(path, accessMode == MODE_OLDFILE ? "r" : accessMode == MODE_NEWFILE ? "w" : "r+");
+            return files[i] ? i + 1 : 0;
+        }
+    }
+    return 0;
+}
+
+LONG Close(BPTR file)
+{
+    if (file <= 0 || file > MAX_FILES || files[file - 1] == NULL)
+        return FALSE;
+    fclose(files[file - 1]);
+    files[file - 1] = NULL;
+    return TRUE;
+}
+
+STRPTR FGets(BPTR fh, STRPTR buf, ULONG buflen)
+{
+    if (fh <= 0 || fh > MAX_FILES || files[fh - 1] == NULL)
+        return NULL;
+    return (STRPTR)fgets((char *)buf, buflen, files[fh - 1]);
+}
+
+LONG StrToLong(CONST_STRPTR string, LONG *value)
+{
+    const char *start = (const char *)string;
+    while (*start == ' ' || *start == '\t')
+        start++;
+
+    char *end;
+    long result = strtol(start, &end, 10);
+    if (end == start)
+        return -1;
+    *value = result;
+    return end - (const char *)string;
+}
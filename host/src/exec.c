@@ -0,0 +1,1270 @@
+// SPDX-License-Identifier: MPL-2.0 OR GPL-2.0+
+/*
+ * Host (Linux) exec.library shim.
+ *
+ * Every task is a POSIX thread. AddTask() starts one, any other thread that
+ * calls into exec is adopted as a task on first use. Signals are a mask per
+ * task with a condition variable behind Wait(), message ports and semaphores
+ * are built on signals the way exec builds them, and timer.device has a
+ * thread of its own that replies TR_ADDREQUEST requests when they expire.
+ *
+ * Forbid() and Disable() take the same process-wide lock. Interrupt servers
+ * run in whichever thread raised the interrupt, under that lock, so they are
+ * serialised against each other and against Forbid()/Disable() sections but,
+ * unlike on the 68k, not against task code that takes no lock at all.
+ */
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+
+#include <proto/exec.h>
+#include <proto/gic400.h>
+#include <proto/timer.h>
+#include <exec/errors.h>
+
+#include <debug.h>
+#include <host_exec.h>
+
+/* Blocks up to this size come from the arena, larger ones are mapped directly */
+#define ARENA_SIZE (256UL << 20)
+#define ARENA_MAX_BLOCK (64UL << 10)
+#define ARENA_GRANULE 64
+#define ARENA_BUCKETS (ARENA_MAX_BLOCK / ARENA_GRANULE)
+
+#define MAX_IRQS 256
+
+struct FreeBlock
+{
+    struct FreeBlock *next;
+};
+
+struct HostPool
+{
+    struct MinList puddles;
+};
+
+struct PoolBlock
+{
+    struct MinNode node;
+    ULONG size;
+    ULONG pad;
+};
+
+struct HostTask
+{
+    struct MinNode node;
+    struct Task *task;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    APTR initPC;
+    APTR finalPC;
+};
+
+struct SemaphoreWaiter
+{
+    struct MinNode node;
+    struct Task *task;
+    BOOL granted;
+};
+
+struct IrqSource
+{
+    HostIrqAsserted asserted;
+    void *context;
+    struct Interrupt *server;
+    BOOL pending;
+};
+
+static pthread_mutex_t memLock = PTHREAD_MUTEX_INITIALIZER;
+static UBYTE *arenaBase;
+static ULONG arenaUsed;
+static struct FreeBlock *arenaFree[ARENA_BUCKETS + 1];
+
+static struct ExecBase execBase;
+static struct Task *mainTask;
+
+static struct Library utilityLibrary;
+static struct Library gic400Library;
+static struct Library dosLibrary;
+static struct Device timerDevice;
+
+static pthread_mutex_t taskListLock = PTHREAD_MUTEX_INITIALIZER;
+static struct MinList taskList;
+static __thread struct Task *thisTask;
+
+/* Forbid()/Disable(): one lock, nested per thread */
+static pthread_mutex_t execLock = PTHREAD_MUTEX_INITIALIZER;
+static __thread LONG execLockNest;
+static __thread BOOL inInterrupt;
+
+static pthread_mutex_t semaphoreLock = PTHREAD_MUTEX_INITIALIZER;
+
+static struct IrqSource irqSources[MAX_IRQS];
+static volatile int irqPending;
+
+static pthread_mutex_t timerLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t timerWake = PTHREAD_COND_INITIALIZER;
+static struct List timerQueue;
+static BOOL timerStarted;
+
+static struct HostExecStats execStats;
+
+static APTR MapLow(ULONG size)
+{
+    APTR memory = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_32BIT, -1, 0);
+    if (memory == MAP_FAILED)
+        return NULL;
+    return memory;
+}
+
+APTR HostAllocLow(ULONG size)
+{
+    if (size == 0)
+        return NULL;
+
+    size = (size + ARENA_GRANULE - 1) & ~(ARENA_GRANULE - 1);
+    if (size > ARENA_MAX_BLOCK)
+        return MapLow(size);
+
+    ULONG bucket = size / ARENA_GRANULE;
+    APTR memory = NULL;
+
+    pthread_mutex_lock(&memLock);
+    if (arenaFree[bucket])
+    {
+        memory = arenaFree[bucket];
+        arenaFree[bucket] = arenaFree[bucket]->next;
+    }
+    else
+    {
+        if (arenaBase == NULL)
+            arenaBase = mmap(NULL, ARENA_SIZE, PROT_READ | PROT_WRITE,
+                             MAP_PRIVATE | MAP_ANONYMOUS | MAP_32BIT | MAP_NORESERVE, -1, 0);
+        if (arenaBase != MAP_FAILED && arenaUsed + size <= ARENA_SIZE)
+        {
+            memory = arenaBase + arenaUsed;
+            arenaUsed += size;
+        }
+    }
+    pthread_mutex_unlock(&memLock);
+
+    return memory;
+}
+
+void HostFreeLow(APTR memory, ULONG size)
+{
+    if (memory == NULL || size == 0)
+        return;
+
+    size = (size + ARENA_GRANULE - 1) & ~(ARENA_GRANULE - 1);
+    if (size > ARENA_MAX_BLOCK)
+    {
+        munmap(memory, size);
+        return;
+    }
+
+    struct FreeBlock *block = memory;
+    pthread_mutex_lock(&memLock);
+    block->next = arenaFree[size / ARENA_GRANULE];
+    arenaFree[size / ARENA_GRANULE] = block;
+    pthread_mutex_unlock(&memLock);
+}
+
+uint64_t HostNanoTime(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void NewList(struct List *list)
+{
+    list->lh_Head = (struct Node *)&list->lh_Tail;
+    list->lh_Tail = NULL;
+    list->lh_TailPred = (struct Node *)&list->lh_Head;
+}
+
+static void NewMinList(struct MinList *list)
+{
+    list->mlh_Head = (struct MinNode *)&list->mlh_Tail;
+    list->mlh_Tail = NULL;
+    list->mlh_TailPred = (struct MinNode *)&list->mlh_Head;
+}
+
+static void AddTailMin(struct MinList *list, struct MinNode *node)
+{
+    node->mln_Succ = (struct MinNode *)&list->mlh_Tail;
+    node->mln_Pred = list->mlh_TailPred;
+    list->mlh_TailPred->mln_Succ = node;
+    list->mlh_TailPred = node;
+}
+
+static void RemoveMin(struct MinNode *node)
+{
+    node->mln_Pred->mln_Succ = node->mln_Succ;
+    node->mln_Succ->mln_Pred = node->mln_Pred;
+}
+
+static struct HostTask *NewHostTask(struct Task *task)
+{
+    struct HostTask *host = calloc(1, sizeof(struct HostTask));
+    host->task = task;
+    pthread_mutex_init(&host->lock, NULL);
+    pthread_cond_init(&host->wake, NULL);
+    task->tc_Host = host;
+
+    /* Signals 0-15 are reserved by the system */
+    task->tc_SigAlloc |= 0x0000ffff;
+
+    pthread_mutex_lock(&taskListLock);
+    AddTailMin(&taskList, &host->node);
+    pthread_mutex_unlock(&taskListLock);
+    return host;
+}
+
+/* A thread that was not started by AddTask() becomes a task on its first exec call */
+static struct Task *AdoptThread(const char *name)
+{
+    struct Task *task = HostAllocLow(sizeof(struct Task));
+    memset(task, 0, sizeof(struct Task));
+    task->tc_Node.ln_Type = NT_TASK;
+    task->tc_Node.ln_Name = (char *)name;
+    task->tc_State = TS_RUN;
+    NewHostTask(task)->thread = pthread_self();
+    thisTask = task;
+    return task;
+}
+
+__attribute__((constructor)) static void HostExecInit(void)
+{
+    execBase.LibNode.lib_Version = 45;
+    execBase.AttnFlags = 0;
+    SysBase = &execBase;
+
+    NewMinList(&taskList);
+    NewList(&timerQueue);
+
+    mainTask = AdoptThread("host main");
+    execBase.ThisTask = mainTask;
+
+    utilityLibrary.lib_Version = 45;
+    gic400Library.lib_Version = 1;
+    dosLibrary.lib_Version = 45;
+    timerDevice.dd_Library.lib_Version = 45;
+}
+
+/* Memory */
+
+APTR AllocMem(ULONG byteSize, ULONG requirements)
+{
+    APTR memory = HostAllocLow(byteSize);
+    if (memory && (requirements & MEMF_CLEAR))
+        memset(memory, 0, byteSize);
+    return memory;
+}
+
+void FreeMem(APTR memoryBlock, ULONG byteSize)
+{
+    HostFreeLow(memoryBlock, byteSize);
+}
+
+APTR AllocVec(ULONG byteSize, ULONG requirements)
+{
+    ULONG *memory = AllocMem(byteSize + ARENA_GRANULE, requirements);
+    if (!memory)
+        return NULL;
+    memory[0] = byteSize + ARENA_GRANULE;
+    return (UBYTE *)memory + ARENA_GRANULE;
+}
+
+void FreeVec(APTR memoryBlock)
+{
+    if (!memoryBlock)
+        return;
+    ULONG *memory = (ULONG *)((UBYTE *)memoryBlock - ARENA_GRANULE);
+    FreeMem(memory, memory[0]);
+}
+
+APTR CreatePool(ULONG requirements, ULONG puddleSize, ULONG threshSize)
+{
+    (void)requirements;
+    (void)puddleSize;
+    (void)threshSize;
+
+    struct HostPool *pool = AllocMem(sizeof(struct HostPool), MEMF_CLEAR);
+    if (pool)
+        NewMinList(&pool->puddles);
+    return pool;
+}
+
+void DeletePool(APTR poolHeader)
+{
+    struct HostPool *pool = poolHeader;
+    if (!pool)
+        return;
+
+    struct MinNode *node = pool->puddles.mlh_Head;
+    while (node->mln_Succ)
+    {
+        struct MinNode *next = node->mln_Succ;
+        FreeMem(node, ((struct PoolBlock *)node)->size);
+        node = next;
+    }
+    FreeMem(pool, sizeof(struct HostPool));
+}
+
+APTR AllocPooled(APTR poolHeader, ULONG memSize)
+{
+    struct HostPool *pool = poolHeader;
+    ULONG size = memSize + sizeof(struct PoolBlock);
+    struct PoolBlock *block = AllocMem(size, MEMF_CLEAR);
+    if (!block)
+        return NULL;
+
+    block->size = size;
+    Forbid();
+    AddTailMin(&pool->puddles, &block->node);
+    Permit();
+    return block + 1;
+}
+
+void FreePooled(APTR poolHeader, APTR memory, ULONG memSize)
+{
+    (void)poolHeader;
+    (void)memSize;
+    if (!memory)
+        return;
+
+    struct PoolBlock *block = (struct PoolBlock *)memory - 1;
+    Forbid();
+    RemoveMin(&block->node);
+    Permit();
+    FreeMem(block, block->size);
+}
+
+void CopyMem(CONST_APTR source, APTR dest, ULONG size)
+{
+    memmove(dest, source, size);
+}
+
+void CopyMemQuick(CONST_APTR source, APTR dest, ULONG size)
+{
+    memcpy(dest, source, size);
+}
+
+/* Caches: the host is coherent, the calls are only counted */
+
+void CachePreDMA(CONST_APTR address, ULONG *length, ULONG flags)
+{
+    (void)address;
+    (void)flags;
+    __atomic_add_fetch(&execStats.cache_pre_dma, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&execStats.cache_pre_dma_bytes, *length, __ATOMIC_RELAXED);
+}
+
+void CachePostDMA(CONST_APTR address, ULONG *length, ULONG flags)
+{
+    (void)address;
+    (void)flags;
+    __atomic_add_fetch(&execStats.cache_post_dma, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&execStats.cache_post_dma_bytes, *length, __ATOMIC_RELAXED);
+}
+
+void CacheClearE(APTR address, ULONG length, ULONG caches)
+{
+    (void)address;
+    (void)length;
+    (void)caches;
+}
+
+/* Lists */
+
+void AddHead(struct List *list, struct Node *node)
+{
+    node->ln_Succ = list->lh_Head;
+    node->ln_Pred = (struct Node *)&list->lh_Head;
+    list->lh_Head->ln_Pred = node;
+    list->lh_Head = node;
+}
+
+void AddTail(struct List *list, struct Node *node)
+{
+    node->ln_Succ = (struct Node *)&list->lh_Tail;
+    node->ln_Pred = list->lh_TailPred;
+    list->lh_TailPred->ln_Succ = node;
+    list->lh_TailPred = node;
+}
+
+void Remove(struct Node *node)
+{
+    node->ln_Pred->ln_Succ = node->ln_Succ;
+    node->ln_Succ->ln_Pred = node->ln_Pred;
+}
+
+struct Node *RemHead(struct List *list)
+{
+    struct Node *node = list->lh_Head;
+    if (node->ln_Succ == NULL)
+        return NULL;
+    Remove(node);
+    return node;
+}
+
+struct Node *RemTail(struct List *list)
+{
+    struct Node *node = list->lh_TailPred;
+    if (node->ln_Pred == NULL)
+        return NULL;
+    Remove(node);
+    return node;
+}
+
+/* Multitasking */
+
+static void CheckPendingInterrupts(void)
+{
+    if (!__atomic_exchange_n(&irqPending, 0, __ATOMIC_ACQ_REL))
+        return;
+
+    for (ULONG irq = 0; irq < MAX_IRQS; irq++)
+    {
+        if (__atomic_exchange_n(&irqSources[irq].pending, FALSE, __ATOMIC_ACQ_REL))
+            HostCheckInterrupt(irq);
+    }
+}
+
+void Forbid(void)
+{
+    if (execLockNest++ == 0)
+        pthread_mutex_lock(&execLock);
+}
+
+void Permit(void)
+{
+    if (--execLockNest == 0)
+    {
+        pthread_mutex_unlock(&execLock);
+        if (!inInterrupt)
+            CheckPendingInterrupts();
+    }
+}
+
+void Disable(void)
+{
+    Forbid();
+}
+
+void Enable(void)
+{
+    Permit();
+}
+
+struct Task *FindTask(CONST_STRPTR name)
+{
+    if (name == NULL)
+        return thisTask ? thisTask : AdoptThread("host thread");
+
+    struct Task *found = NULL;
+    pthread_mutex_lock(&taskListLock);
+    for (struct MinNode *node = taskList.mlh_Head; node->mln_Succ; node = node->mln_Succ)
+    {
+        struct Task *task = ((struct HostTask *)node)->task;
+        if (task->tc_Node.ln_Name && strcmp(task->tc_Node.ln_Name, (const char *)name) == 0)
+        {
+            found = task;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&taskListLock);
+    return found;
+}
+
+/* Free what the task put on tc_MemEntry, the way exec does when a task ends */
+static void FreeTaskMemory(struct Task *task)
+{
+    struct Node *node;
+    while ((node = RemHead(&task->tc_MemEntry)))
+    {
+        struct MemList *ml = (struct MemList *)node;
+        for (int i = 0; i < ml->ml_NumEntries; i++)
+            FreeMem(ml->ml_ME[i].me_Addr, ml->ml_ME[i].me_Length);
+        FreeMem(ml, sizeof(struct MemList) + (ml->ml_NumEntries - 1) * sizeof(struct MemEntry));
+    }
+}
+
+static void TaskExit(struct Task *task)
+{
+    struct HostTask *host = task->tc_Host;
+
+    pthread_mutex_lock(&taskListLock);
+    RemoveMin(&host->node);
+    pthread_mutex_unlock(&taskListLock);
+
+    task->tc_State = TS_REMOVED;
+    thisTask = NULL;
+    /*
+     * The HostTask is not freed: on the 68k a Signal() to a task that just
+     * went away is harmless, here it must not touch freed memory either.
+     */
+    if (task->tc_MemEntry.lh_Head)
+        FreeTaskMemory(task);
+}
+
+/*
+ * The task's stack is not used, the thread runs on its own. exec starts the
+ * task with finalPC as return address on top of tc_SPReg, so the longwords
+ * found there are the C arguments of initPC; the first two are passed on.
+ */
+static void *TaskThread(void *arg)
+{
+    struct Task *task = arg;
+    struct HostTask *host = task->tc_Host;
+    ULONG *stack = task->tc_SPReg;
+    APTR arg0 = stack ? (APTR)(uintptr_t)stack[0] : NULL;
+    APTR arg1 = stack ? (APTR)(uintptr_t)stack[1] : NULL;
+
+    if (task->tc_Node.ln_Name)
+    {
+        char name[16];
+        strncpy(name, task->tc_Node.ln_Name, sizeof(name) - 1);
+        name[sizeof(name) - 1] = 0;
+        pthread_setname_np(pthread_self(), name);
+    }
+
+    thisTask = task;
+    task->tc_State = TS_RUN;
+    ((void (*)(APTR, APTR))host->initPC)(arg0, arg1);
+    if (host->finalPC)
+        ((void (*)(void))host->finalPC)();
+
+    TaskExit(task);
+    return NULL;
+}
+
+APTR AddTask(struct Task *task, APTR initPC, APTR finalPC)
+{
+    struct HostTask *host = NewHostTask(task);
+    host->initPC = initPC;
+    host->finalPC = finalPC;
+    task->tc_State = TS_READY;
+
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    int error = pthread_create(&host->thread, &attr, TaskThread, task);
+    pthread_attr_destroy(&attr);
+
+    if (error)
+    {
+        Kprintf("[host] %s: pthread_create failed: %ld\n", __func__, error);
+        pthread_mutex_lock(&taskListLock);
+        RemoveMin(&host->node);
+        pthread_mutex_unlock(&taskListLock);
+        task->tc_Host = NULL;
+        return NULL;
+    }
+
+    __atomic_add_fetch(&execStats.tasks_started, 1, __ATOMIC_RELAXED);
+    return task;
+}
+
+void RemTask(struct Task *task)
+{
+    if (task == NULL || task == thisTask)
+    {
+        TaskExit(FindTask(NULL));
+        pthread_exit(NULL);
+    }
+    Kprintf("[host] %s: removing another task is not supported\n", __func__);
+}
+
+BYTE SetTaskPri(struct Task *task, LONG priority)
+{
+    /* Recorded only, the host scheduler does not know about exec priorities */
+    BYTE old = task->tc_Node.ln_Pri;
+    task->tc_Node.ln_Pri = priority;
+    return old;
+}
+
+/* Signals */
+
+BYTE AllocSignal(LONG signalNum)
+{
+    struct Task *task = FindTask(NULL);
+    struct HostTask *host = task->tc_Host;
+    BYTE result = -1;
+
+    pthread_mutex_lock(&host->lock);
+    if (signalNum >= 0)
+    {
+        if (signalNum <= 31 && !(task->tc_SigAlloc & (1UL << signalNum)))
+            result = signalNum;
+    }
+    else
+    {
+        for (signalNum = 31; signalNum >= 0; signalNum--)
+        {
+            if (!(task->tc_SigAlloc & (1UL << signalNum)))
+            {
+                result = signalNum;
+                break;
+            }
+        }
+    }
+    if (result >= 0)
+    {
+        task->tc_SigAlloc |= 1UL << result;
+        task->tc_SigRecvd &= ~(1UL << result);
+    }
+    pthread_mutex_unlock(&host->lock);
+    return result;
+}
+
+void FreeSignal(LONG signalNum)
+{
+    if (signalNum < 0 || signalNum > 31)
+        return;
+
+    struct Task *task = FindTask(NULL);
+    struct HostTask *host = task->tc_Host;
+    pthread_mutex_lock(&host->lock);
+    task->tc_SigAlloc &= ~(1UL << signalNum);
+    pthread_mutex_unlock(&host->lock);
+}
+
+void Signal(struct Task *task, ULONG signalSet)
+{
+    if (!task || !task->tc_Host)
+        return;
+
+    struct HostTask *host = task->tc_Host;
+    __atomic_add_fetch(&execStats.signals, 1, __ATOMIC_RELAXED);
+    HostSysTimerUpdate();
+    pthread_mutex_lock(&host->lock);
+    task->tc_SigRecvd |= signalSet;
+    if (task->tc_SigWait & signalSet)
+        pthread_cond_signal(&host->wake);
+    pthread_mutex_unlock(&host->lock);
+}
+
+ULONG Wait(ULONG signalSet)
+{
+    struct Task *task = FindTask(NULL);
+    struct HostTask *host = task->tc_Host;
+
+    /* Wait() breaks a Forbid()/Disable(), which is restored when the task runs again */
+    LONG nest = execLockNest;
+    if (nest)
+    {
+        execLockNest = 0;
+        pthread_mutex_unlock(&execLock);
+    }
+
+    __atomic_add_fetch(&execStats.waits, 1, __ATOMIC_RELAXED);
+    pthread_mutex_lock(&host->lock);
+    if (!(task->tc_SigRecvd & signalSet))
+    {
+        __atomic_add_fetch(&execStats.waits_blocked, 1, __ATOMIC_RELAXED);
+        task->tc_SigWait = signalSet;
+        task->tc_State = TS_WAIT;
+        while (!(task->tc_SigRecvd & signalSet))
+            pthread_cond_wait(&host->wake, &host->lock);
+        task->tc_State = TS_RUN;
+        task->tc_SigWait = 0;
+    }
+    ULONG received = task->tc_SigRecvd & signalSet;
+    task->tc_SigRecvd &= ~received;
+    pthread_mutex_unlock(&host->lock);
+    HostSysTimerUpdate();
+
+    if (nest)
+    {
+        pthread_mutex_lock(&execLock);
+        execLockNest = nest;
+    }
+    return received;
+}
+
+ULONG SetSignal(ULONG newSignals, ULONG signalSet)
+{
+    struct Task *task = FindTask(NULL);
+    struct HostTask *host = task->tc_Host;
+
+    pthread_mutex_lock(&host->lock);
+    ULONG old = task->tc_SigRecvd;
+    task->tc_SigRecvd = (old & ~signalSet) | (newSignals & signalSet);
+    pthread_mutex_unlock(&host->lock);
+    return old;
+}
+
+/*
+ * Semaphores: as in exec, a task that finds the semaphore taken queues
+ * itself on ss_WaitQueue and sleeps on SIGF_SINGLE until ReleaseSemaphore()
+ * hands ownership over. ss_QueueCount counts the owner's nesting and the
+ * waiters, -1 while free, and InitSemaphore() is what sets it to -1: on exec
+ * a semaphore that was never initialized looks taken for good. The host
+ * stops right there instead of hanging like the real thing.
+ */
+
+static void CheckSemaphore(struct SignalSemaphore *sigSem, const char *function)
+{
+    if (sigSem->ss_Link.ln_Type != NT_SIGNALSEM)
+    {
+        fprintf(stderr, "%s: semaphore at %p was never initialized with InitSemaphore()\n", function, (void *)sigSem);
+        abort();
+    }
+}
+
+void InitSemaphore(struct SignalSemaphore *sigSem)
+{
+    memset(sigSem, 0, sizeof(*sigSem));
+    sigSem->ss_Link.ln_Type = NT_SIGNALSEM;
+    sigSem->ss_QueueCount = -1;
+    NewMinList(&sigSem->ss_WaitQueue);
+}
+
+void ObtainSemaphore(struct SignalSemaphore *sigSem)
+{
+    struct Task *me = FindTask(NULL);
+
+    CheckSemaphore(sigSem, __func__);
+    __atomic_add_fetch(&execStats.semaphore_obtains, 1, __ATOMIC_RELAXED);
+    pthread_mutex_lock(&semaphoreLock);
+    if (++sigSem->ss_QueueCount == 0 || sigSem->ss_Owner == me)
+    {
+        sigSem->ss_NestCount++;
+        sigSem->ss_Owner = me;
+        pthread_mutex_unlock(&semaphoreLock);
+        return;
+    }
+
+    struct SemaphoreWaiter waiter = {.task = me, .granted = FALSE};
+    AddTailMin(&sigSem->ss_WaitQueue, &waiter.node);
+    __atomic_add_fetch(&execStats.semaphore_contended, 1, __ATOMIC_RELAXED);
+
+    while (!waiter.granted)
+    {
+        pthread_mutex_unlock(&semaphoreLock);
+        Wait(SIGF_SINGLE);
+        pthread_mutex_lock(&semaphoreLock);
+    }
+    pthread_mutex_unlock(&semaphoreLock);
+}
+
+ULONG AttemptSemaphore(struct SignalSemaphore *sigSem)
+{
+    struct Task *me = FindTask(NULL);
+    ULONG obtained = FALSE;
+
+    CheckSemaphore(sigSem, __func__);
+    __atomic_add_fetch(&execStats.semaphore_attempts, 1, __ATOMIC_RELAXED);
+    pthread_mutex_lock(&semaphoreLock);
+    if (sigSem->ss_QueueCount == -1 || sigSem->ss_Owner == me)
+    {
+        sigSem->ss_QueueCount++;
+        sigSem->ss_NestCount++;
+        sigSem->ss_Owner = me;
+        obtained = TRUE;
+    }
+    pthread_mutex_unlock(&semaphoreLock);
+
+    if (!obtained)
+        __atomic_add_fetch(&execStats.semaphore_attempts_failed, 1, __ATOMIC_RELAXED);
+    return obtained;
+}
+
+void ReleaseSemaphore(struct SignalSemaphore *sigSem)
+{
+    CheckSemaphore(sigSem, __func__);
+    pthread_mutex_lock(&semaphoreLock);
+    sigSem->ss_QueueCount--;
+    if (--sigSem->ss_NestCount == 0)
+    {
+        sigSem->ss_Owner = NULL;
+        /* Waiters left, the first one owns it now */
+        if (sigSem->ss_QueueCount >= 0)
+        {
+            struct SemaphoreWaiter *waiter = (struct SemaphoreWaiter *)sigSem->ss_WaitQueue.mlh_Head;
+            struct Task *task = waiter->task;
+            RemoveMin(&waiter->node);
+            sigSem->ss_NestCount = 1;
+            sigSem->ss_Owner = task;
+            waiter->granted = TRUE;
+            Signal(task, SIGF_SINGLE);
+        }
+    }
+    pthread_mutex_unlock(&semaphoreLock);
+}
+
+/* Messages */
+
+struct MsgPort *CreateMsgPort(void)
+{
+    struct MsgPort *port = AllocMem(sizeof(struct MsgPort), MEMF_PUBLIC | MEMF_CLEAR);
+    if (!port)
+        return NULL;
+
+    BYTE signal = AllocSignal(-1);
+    if (signal < 0)
+    {
+        FreeMem(port, sizeof(struct MsgPort));
+        return NULL;
+    }
+
+    port->mp_Node.ln_Type = NT_MSGPORT;
+    port->mp_Flags = PA_SIGNAL;
+    port->mp_SigBit = signal;
+    port->mp_SigTask = FindTask(NULL);
+    NewList(&port->mp_MsgList);
+    return port;
+}
+
+void DeleteMsgPort(struct MsgPort *port)
+{
+    if (!port)
+        return;
+    FreeSignal(port->mp_SigBit);
+    FreeMem(port, sizeof(struct MsgPort));
+}
+
+static void QueueMsg(struct MsgPort *port, struct Message *message, UBYTE type)
+{
+    Disable();
+    message->mn_Node.ln_Type = type;
+    AddTail(&port->mp_MsgList, &message->mn_Node);
+    Enable();
+
+    if ((port->mp_Flags & PF_ACTION) == PA_SIGNAL && port->mp_SigTask)
+        Signal(port->mp_SigTask, 1UL << port->mp_SigBit);
+}
+
+void PutMsg(struct MsgPort *port, struct Message *message)
+{
+    __atomic_add_fetch(&execStats.messages_put, 1, __ATOMIC_RELAXED);
+    QueueMsg(port, message, NT_MESSAGE);
+}
+
+struct Message *GetMsg(struct MsgPort *port)
+{
+    Disable();
+    struct Message *message = (struct Message *)RemHead(&port->mp_MsgList);
+    Enable();
+    return message;
+}
+
+void ReplyMsg(struct Message *message)
+{
+    struct MsgPort *port = message->mn_ReplyPort;
+
+    __atomic_add_fetch(&execStats.messages_replied, 1, __ATOMIC_RELAXED);
+    if (port == NULL)
+    {
+        message->mn_Node.ln_Type = NT_FREEMSG;
+        return;
+    }
+    QueueMsg(port, message, NT_REPLYMSG);
+}
+
+struct Message *WaitPort(struct MsgPort *port)
+{
+    for (;;)
+    {
+        Disable();
+        struct Node *head = port->mp_MsgList.lh_Head;
+        Enable();
+        if (head->ln_Succ)
+            return (struct Message *)head;
+        Wait(1UL << port->mp_SigBit);
+    }
+}
+
+/*
+ * timer.device: TR_ADDREQUEST requests wait on timerQueue, sorted by
+ * deadline, until the timer thread replies them. While queued, tr_time holds
+ * the absolute deadline on the host monotonic clock, as the real device
+ * also keeps its own copy of the expiry time in the request.
+ */
+
+static uint64_t TimerDeadline(const struct timerequest *tr)
+{
+    return (uint64_t)tr->tr_time.tv_secs * 1000000000ULL + (uint64_t)tr->tr_time.tv_micro * 1000ULL;
+}
+
+static void *TimerThread(void *arg)
+{
+    (void)arg;
+
+    pthread_setname_np(pthread_self(), TIMERNAME);
+    pthread_mutex_lock(&timerLock);
+    for (;;)
+    {
+        struct List expired;
+        NewList(&expired);
+
+        uint64_t now = HostNanoTime();
+        struct Node *node;
+        while ((node = timerQueue.lh_Head)->ln_Succ && TimerDeadline((struct timerequest *)node) <= now)
+        {
+            Remove(node);
+            AddTail(&expired, node);
+        }
+
+        if (expired.lh_Head->ln_Succ)
+        {
+            /* Reply outside timerLock, ReplyMsg() takes the exec lock */
+            pthread_mutex_unlock(&timerLock);
+            while ((node = RemHead(&expired)))
+                ReplyMsg((struct Message *)node);
+            pthread_mutex_lock(&timerLock);
+            continue;
+        }
+
+        if (timerQueue.lh_Head->ln_Succ)
+        {
+            uint64_t deadline = TimerDeadline((struct timerequest *)timerQueue.lh_Head);
+            struct timespec ts;
+            clock_gettime(CLOCK_MONOTONIC, &ts);
+            uint64_t wake = (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec + (deadline - now);
+            ts.tv_sec = wake / 1000000000ULL;
+            ts.tv_nsec = wake % 1000000000ULL;
+            pthread_cond_timedwait(&timerWake, &timerLock, &ts);
+        }
+        else
+        {
+            pthread_cond_wait(&timerWake, &timerLock);
+        }
+    }
+    return NULL;
+}
+
+static void TimerStart(void)
+{
+    pthread_mutex_lock(&timerLock);
+    if (!timerStarted)
+    {
+        pthread_condattr_t attr;
+        pthread_condattr_init(&attr);
+        pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+        pthread_cond_destroy(&timerWake);
+        pthread_cond_init(&timerWake, &attr);
+        pthread_condattr_destroy(&attr);
+
+        pthread_t thread;
+        pthread_create(&thread, NULL, TimerThread, NULL);
+        pthread_detach(thread);
+        timerStarted = TRUE;
+    }
+    pthread_mutex_unlock(&timerLock);
+}
+
+static void TimerAddRequest(struct timerequest *tr)
+{
+    uint64_t deadline = HostNanoTime() + (uint64_t)tr->tr_time.tv_secs * 1000000000ULL +
+                        (uint64_t)tr->tr_time.tv_micro * 1000ULL;
+    tr->tr_time.tv_secs = deadline / 1000000000ULL;
+    tr->tr_time.tv_micro = (deadline % 1000000000ULL) / 1000;
+
+    pthread_mutex_lock(&timerLock);
+    struct Node *pred = timerQueue.lh_TailPred;
+    while (pred->ln_Pred && TimerDeadline((struct timerequest *)pred) > deadline)
+        pred = pred->ln_Pred;
+
+    struct Node *node = &tr->tr_node.io_Message.mn_Node;
+    node->ln_Pred = pred;
+    node->ln_Succ = pred->ln_Succ;
+    pred->ln_Succ->ln_Pred = node;
+    pred->ln_Succ = node;
+    if (timerQueue.lh_Head == node)
+        pthread_cond_signal(&timerWake);
+    pthread_mutex_unlock(&timerLock);
+}
+
+static void TimerBeginIO(struct IORequest *ioRequest)
+{
+    ioRequest->io_Error = 0;
+    ioRequest->io_Message.mn_Node.ln_Type = NT_MESSAGE;
+
+    switch (ioRequest->io_Command)
+    {
+    case TR_ADDREQUEST:
+        ioRequest->io_Flags &= ~IOF_QUICK;
+        TimerAddRequest((struct timerequest *)ioRequest);
+        return;
+    case TR_GETSYSTIME:
+        GetSysTime(&((struct timerequest *)ioRequest)->tr_time);
+        break;
+    default:
+        ioRequest->io_Error = IOERR_NOCMD;
+        break;
+    }
+
+    if (!(ioRequest->io_Flags & IOF_QUICK))
+        ReplyMsg(&ioRequest->io_Message);
+}
+
+/* Libraries and devices */
+
+struct Library *OpenLibrary(CONST_STRPTR libName, ULONG version)
+{
+    struct Library *library = NULL;
+
+    if (strcmp((const char *)libName, "utility.library") == 0)
+        library = &utilityLibrary;
+    else if (strcmp((const char *)libName, "gic400.library") == 0)
+        library = &gic400Library;
+    else if (strcmp((const char *)libName, "dos.library") == 0)
+        library = &dosLibrary;
+
+    if (library == NULL || library->lib_Version < version)
+        return NULL;
+    library->lib_OpenCnt++;
+    return library;
+}
+
+void CloseLibrary(struct Library *library)
+{
+    if (library)
+        library->lib_OpenCnt--;
+}
+
+APTR CreateIORequest(const struct MsgPort *port, ULONG size)
+{
+    if (!port)
+        return NULL;
+
+    struct IORequest *io = AllocMem(size, MEMF_PUBLIC | MEMF_CLEAR);
+    if (io)
+    {
+        io->io_Message.mn_Node.ln_Type = NT_REPLYMSG;
+        io->io_Message.mn_ReplyPort = (struct MsgPort *)port;
+        io->io_Message.mn_Length = size;
+    }
+    return io;
+}
+
+void DeleteIORequest(APTR iorequest)
+{
+    struct IORequest *io = iorequest;
+    if (io)
+        FreeMem(io, io->io_Message.mn_Length);
+}
+
+BYTE OpenDevice(CONST_STRPTR devName, ULONG unit, struct IORequest *ioRequest, ULONG flags)
+{
+    (void)unit;
+    (void)flags;
+
+    if (strcmp((const char *)devName, TIMERNAME) != 0)
+    {
+        ioRequest->io_Error = IOERR_OPENFAIL;
+        return IOERR_OPENFAIL;
+    }
+
+    TimerStart();
+    ioRequest->io_Device = &timerDevice;
+    ioRequest->io_Error = 0;
+    timerDevice.dd_Library.lib_OpenCnt++;
+    return 0;
+}
+
+void CloseDevice(struct IORequest *ioRequest)
+{
+    if (ioRequest && ioRequest->io_Device)
+    {
+        ioRequest->io_Device->dd_Library.lib_OpenCnt--;
+        ioRequest->io_Device = NULL;
+    }
+}
+
+BYTE DoIO(struct IORequest *ioRequest)
+{
+    ioRequest->io_Flags = IOF_QUICK;
+    TimerBeginIO(ioRequest);
+    return WaitIO(ioRequest);
+}
+
+void SendIO(struct IORequest *ioRequest)
+{
+    ioRequest->io_Flags = 0;
+    TimerBeginIO(ioRequest);
+}
+
+struct IORequest *CheckIO(struct IORequest *ioRequest)
+{
+    if (ioRequest->io_Flags & IOF_QUICK)
+        return ioRequest;
+    if (__atomic_load_n(&ioRequest->io_Message.mn_Node.ln_Type, __ATOMIC_ACQUIRE) == NT_MESSAGE)
+        return NULL;
+    return ioRequest;
+}
+
+BYTE WaitIO(struct IORequest *ioRequest)
+{
+    if (ioRequest->io_Flags & IOF_QUICK)
+        return ioRequest->io_Error;
+
+    struct MsgPort *port = ioRequest->io_Message.mn_ReplyPort;
+    while (__atomic_load_n(&ioRequest->io_Message.mn_Node.ln_Type, __ATOMIC_ACQUIRE) != NT_REPLYMSG)
+        Wait(1UL << port->mp_SigBit);
+
+    Disable();
+    Remove(&ioRequest->io_Message.mn_Node);
+    Enable();
+    return ioRequest->io_Error;
+}
+
+LONG AbortIO(struct IORequest *ioRequest)
+{
+    BOOL queued = FALSE;
+
+    pthread_mutex_lock(&timerLock);
+    for (struct Node *node = timerQueue.lh_Head; node->ln_Succ; node = node->ln_Succ)
+    {
+        if (node == &ioRequest->io_Message.mn_Node)
+        {
+            Remove(node);
+            queued = TRUE;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&timerLock);
+
+    if (queued)
+    {
+        ioRequest->io_Error = IOERR_ABORTED;
+        ReplyMsg(&ioRequest->io_Message);
+    }
+    return 0;
+}
+
+/* timer.device functions */
+
+void GetSysTime(struct timeval *dest)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    dest->tv_secs = ts.tv_sec;
+    dest->tv_micro = ts.tv_nsec / 1000;
+}
+
+ULONG ReadEClock(struct EClockVal *dest)
+{
+    uint64_t ticks = HostNanoTime() / 1000;
+    dest->ev_hi = ticks >> 32;
+    dest->ev_lo = ticks;
+    return 1000000;
+}
+
+/* gic400.library */
+
+LONG AddIntServerEx(ULONG irq, ULONG priority, BOOL edge, struct Interrupt *interrupt)
+{
+    (void)priority;
+    (void)edge;
+
+    if (irq >= MAX_IRQS)
+        return -1;
+
+    LONG result = -1;
+    Disable();
+    if (!irqSources[irq].server)
+    {
+        irqSources[irq].server = interrupt;
+        irqSources[irq].pending = TRUE;
+        irqPending = 1;
+        result = 0;
+    }
+    Enable();
+    return result;
+}
+
+void RemIntServerEx(ULONG irq, struct Interrupt *interrupt)
+{
+    if (irq >= MAX_IRQS)
+        return;
+
+    Disable();
+    if (irqSources[irq].server == interrupt)
+    {
+        irqSources[irq].server = NULL;
+        irqSources[irq].pending = FALSE;
+    }
+    Enable();
+}
+
+void HostRegisterInterruptSource(ULONG irq, HostIrqAsserted asserted, void *context)
+{
+    if (irq >= MAX_IRQS)
+        return;
+    Disable();
+    irqSources[irq].asserted = asserted;
+    irqSources[irq].context = context;
+    Enable();
+}
+
+void HostUnregisterInterruptSource(ULONG irq)
+{
+    if (irq >= MAX_IRQS)
+        return;
+    Disable();
+    irqSources[irq].asserted = NULL;
+    irqSources[irq].context = NULL;
+    Enable();
+}
+
+/* Upper bound of back to back server calls, a stuck line is reported instead of hanging */
+#define IRQ_STORM_LIMIT 1000
+
+void HostCheckInterrupt(ULONG irq)
+{
+    if (irq >= MAX_IRQS)
+        return;
+
+    struct IrqSource *source = &irqSources[irq];
+
+    /* Held off by this thread: delivered when it leaves Disable()/Forbid() */
+    if (execLockNest > 0 || inInterrupt)
+    {
+        __atomic_store_n(&source->pending, TRUE, __ATOMIC_RELEASE);
+        __atomic_store_n(&irqPending, 1, __ATOMIC_RELEASE);
+        return;
+    }
+
+    pthread_mutex_lock(&execLock);
+    execLockNest = 1;
+    inInterrupt = TRUE;
+
+    int calls = 0;
+    while (source->server && source->asserted && source->asserted(source->context))
+    {
+        if (++calls > IRQ_STORM_LIMIT)
+        {
+            Kprintf("[host] %s: interrupt storm on irq %ld\n", __func__, irq);
+            break;
+        }
+        struct Interrupt *server = source->server;
+        HostSysTimerUpdate();
+        ((void (*)(struct ExecBase *, APTR, ULONG))server->is_Code)(SysBase, server->is_Data, irq);
+        __atomic_add_fetch(&execStats.interrupts, 1, __ATOMIC_RELAXED);
+    }
+
+    inInterrupt = FALSE;
+    execLockNest = 0;
+    pthread_mutex_unlock(&execLock);
+    CheckPendingInterrupts();
+}
+
+void HostGetExecStats(struct HostExecStats *stats)
+{
+    *stats = execStats;
+}
+
+void HostResetExecStats(void)
+{
+    memset(&execStats, 0, sizeof(execStats));
+}
@@ -0,0 +1,902 @@
+// SPDX-License-Identifier: MPL-2.0 OR GPL-2.0+
+#include <pthread.h>
+#include <string.h>
+
+#include <exec/types.h>
+
+#include <compat.h>
+#include <debug.h>
+#include <device.h>
+#include <host_exec.h>
+#include <genet_sim.h>
+
+#include <genet/bcmgenet-regs.h>
+#include <genet/mii.h>
+#include <genet/phy.h>
+#include <genet/unimac.h>
+
+#define SIM_RINGS (DEFAULT_Q + 1)
+
+/* Ring register blocks, for any ring number */
+#define SIM_RDMA_RING(q) (GENET_RDMA_REG_OFF + (q) * DMA_RING_SIZE)
+#define SIM_TDMA_RING(q) (GENET_TDMA_REG_OFF + (q) * DMA_RING_SIZE)
+#define SIM_RDMA_PROD_INDEX 0x08
+#define SIM_RDMA_CONS_INDEX 0x0c
+#define SIM_TDMA_READ_PTR 0x00
+#define SIM_TDMA_CONS_INDEX 0x08
+#define SIM_TDMA_PROD_INDEX 0x0c
+
+/* Base clock of the DMA timeout registers: 125MHz / 1024 */
+#define SIM_DMA_TIMEOUT_TICK_NS 8192
+
+/* Preamble + SFD, FCS and inter-frame gap on the wire */
+#define SIM_WIRE_OVERHEAD (8 + ETH_FCS_LEN + 12)
+#define SIM_MIN_FRAME 60
+
+struct sim_rx_ring
+{
+    UWORD prod_index;
+    UWORD discards;
+    ULONG done;        /* buffers completed since the last interrupt */
+    BOOL timer_armed;
+    uint64_t deadline; /* coalescing timeout, simulated ns */
+};
+
+struct sim_tx_ring
+{
+    UWORD cons_index;
+    ULONG done; /* buffers completed since the last interrupt */
+};
+
+struct GenetSim
+{
+    pthread_mutex_t lock;
+    ULONG *regs;
+    struct GenetSimConfig config;
+    struct GenetSimStats stats;
+
+    uint64_t now;
+    uint64_t tx_busy_until;
+
+    UBYTE mac[6];
+    BOOL irq_level[2];
+
+    GenetSimTxSink tx_sink;
+    void *tx_context;
+
+    UWORD phy_regs[32];
+
+    struct sim_rx_ring rx[SIM_RINGS];
+    struct sim_tx_ring tx[SIM_RINGS];
+
+    UBYTE tx_frame[RX_BUF_LENGTH * 2];
+};
+
+static struct GenetSim *sim_instance;
+
+uintptr_t host_mmio_start;
+uintptr_t host_mmio_end;
+
+static inline ULONG reg_get(struct GenetSim *sim, ULONG offset)
+{
+    return sim->regs[offset >> 2];
+}
+
+static inline void reg_set(struct GenetSim *sim, ULONG offset, ULONG value)
+{
+    sim->regs[offset >> 2] = value;
+}
+
+/* MIB counter register of a GENET_MIB_* index */
+static ULONG mib_reg(ULONG index)
+{
+    if (index < GENET_MIB_TX_64)
+        return UMAC_MIB_RX + index * 4;
+    if (index < GENET_MIB_RX_RUNTS)
+        return UMAC_MIB_TX + (index - GENET_MIB_TX_64) * 4;
+    return UMAC_MIB_RUNT + (index - GENET_MIB_RX_RUNTS) * 4;
+}
+
+static inline void mib_add(struct GenetSim *sim, ULONG index, ULONG value)
+{
+    reg_set(sim, mib_reg(index), reg_get(sim, mib_reg(index)) + value);
+}
+
+/* Counts a good frame the MAC received or sent, length without the FCS */
+static void mib_count(struct GenetSim *sim, BOOL tx, const UBYTE *frame, ULONG length)
+{
+    static const UWORD limits[] = {64, 127, 255, 511, 1023, 1518, 1522, 2047, 4095};
+    static const UBYTE broadcast[6] = {0xff, 0xff, 0xff, 0xff, 0xff, 0xff};
+
+    /* The MAC pads short frames it sends */
+    if (tx && length < SIM_MIN_FRAME)
+        length = SIM_MIN_FRAME;
+    ULONG size = length + ETH_FCS_LEN;
+
+    if (!tx && size < 64)
+    {
+        mib_add(sim, GENET_MIB_RX_RUNTS, 1);
+        mib_add(sim, GENET_MIB_RX_RUNTS_FCS_OK, 1);
+        mib_add(sim, GENET_MIB_RX_RUNT_BYTES, size);
+        return;
+    }
+
+    ULONG bucket = 0;
+    while (bucket < sizeof(limits) / sizeof(limits[0]) && size > limits[bucket])
+        bucket++;
+
+    ULONG cast;
+    if (memcmp(frame, broadcast, 6) == 0)
+        cast = tx ? GENET_MIB_TX_BROADCAST : GENET_MIB_RX_BROADCAST;
+    else if (frame[0] & 1)
+        cast = tx ? GENET_MIB_TX_MULTICAST : GENET_MIB_RX_MULTICAST;
+    else
+        cast = tx ? GENET_MIB_TX_UNICAST : GENET_MIB_RX_UNICAST;
+
+    mib_add(sim, (tx ? GENET_MIB_TX_64 : GENET_MIB_RX_64) + bucket, 1);
+    mib_add(sim, tx ? GENET_MIB_TX_PACKETS : GENET_MIB_RX_PACKETS, 1);
+    mib_add(sim, tx ? GENET_MIB_TX_GOOD : GENET_MIB_RX_GOOD, 1);
+    mib_add(sim, tx ? GENET_MIB_TX_BYTES : GENET_MIB_RX_BYTES, size);
+    mib_add(sim, cast, 1);
+}
+
+/* UMAC_MIB_CTRL reset bits clear their block of counters */
+static void mib_reset(struct GenetSim *sim, ULONG value)
+{
+    for (ULONG i = 0; i < GENET_MIB_COUNT; i++)
+    {
+        ULONG bit = i < GENET_MIB_TX_64 ? MIB_RESET_RX : i < GENET_MIB_RX_RUNTS ? MIB_RESET_TX : MIB_RESET_RUNT;
+        if (value & bit)
+            reg_set(sim, mib_reg(i), 0);
+    }
+}
+
+static inline ULONG ring_size(ULONG buf_size_reg)
+{
+    return buf_size_reg >> DMA_RING_SIZE_SHIFT;
+}
+
+static inline ULONG ring_first_desc(struct GenetSim *sim, ULONG ring_base)
+{
+    return reg_get(sim, ring_base + DMA_START_ADDR) * 4 / DMA_DESC_SIZE;
+}
+
+static BOOL rdma_ring_enabled(struct GenetSim *sim, int q)
+{
+    ULONG ctrl = reg_get(sim, RDMA_REG_BASE + DMA_CTRL);
+    return (ctrl & DMA_EN) && (ctrl & (1 << (q + DMA_RING_BUF_EN_SHIFT))) &&
+           ring_size(reg_get(sim, SIM_RDMA_RING(q) + DMA_RING_BUF_SIZE)) != 0;
+}
+
+static BOOL tdma_ring_enabled(struct GenetSim *sim, int q)
+{
+    ULONG ctrl = reg_get(sim, TDMA_REG_BASE + DMA_CTRL);
+    return (ctrl & DMA_EN) && (ctrl & (1 << (q + DMA_RING_BUF_EN_SHIFT))) &&
+           ring_size(reg_get(sim, SIM_TDMA_RING(q) + DMA_RING_BUF_SIZE)) != 0;
+}
+
+/* Ring 16 reports through INTRL2_0, the priority rings through INTRL2_1 */
+static void raise_rx_done(struct GenetSim *sim, int q)
+{
+    if (q == DEFAULT_Q)
+        sim->regs[(GENET_INTRL2_0_OFF + INTRL2_CPU_STAT) >> 2] |= UMAC_IRQ_RXDMA_MBDONE;
+    else
+        sim->regs[(GENET_INTRL2_1_OFF + INTRL2_CPU_STAT) >> 2] |= 1UL << (q + UMAC_IRQ1_RX_INTR_SHIFT);
+
+    sim->rx[q].done = 0;
+    sim->rx[q].timer_armed = FALSE;
+}
+
+static void raise_tx_done(struct GenetSim *sim, int q)
+{
+    if (q == DEFAULT_Q)
+        sim->regs[(GENET_INTRL2_0_OFF + INTRL2_CPU_STAT) >> 2] |= UMAC_IRQ_TXDMA_MBDONE;
+    else
+        sim->regs[(GENET_INTRL2_1_OFF + INTRL2_CPU_STAT) >> 2] |= 1UL << q;
+
+    sim->tx[q].done = 0;
+}
+
+static BOOL irq_line(struct GenetSim *sim, ULONG intrl2)
+{
+    return (reg_get(sim, intrl2 + INTRL2_CPU_STAT) & ~reg_get(sim, intrl2 + INTRL2_CPU_MASK_STATUS)) != 0;
+}
+
+/* Update line levels, count rising edges. Returns mask of asserted lines. */
+static ULONG update_irq_lines(struct GenetSim *sim)
+{
+    ULONG asserted = 0;
+    const ULONG blocks[2] = {GENET_INTRL2_0_OFF, GENET_INTRL2_1_OFF};
+
+    for (int i = 0; i < 2; i++)
+    {
+        BOOL level = irq_line(sim, blocks[i]);
+        if (level && !sim->irq_level[i])
+        {
+            if (i == 0)
+                sim->stats.irq0_raised++;
+            else
+                sim->stats.irq1_raised++;
+        }
+        sim->irq_level[i] = level;
+        if (level)
+            asserted |= 1 << i;
+    }
+    return asserted;
+}
+
+static void deliver_irqs(ULONG asserted)
+{
+    if (asserted & 1)
+        HostCheckInterrupt(GENET_SIM_IRQ0);
+    if (asserted & 2)
+        HostCheckInterrupt(GENET_SIM_IRQ1);
+}
+
+static BOOL irq0_asserted(void *context)
+{
+    struct GenetSim *sim = context;
+    pthread_mutex_lock(&sim->lock);
+    BOOL level = irq_line(sim, GENET_INTRL2_0_OFF);
+    pthread_mutex_unlock(&sim->lock);
+    return level;
+}
+
+static BOOL irq1_asserted(void *context)
+{
+    struct GenetSim *sim = context;
+    pthread_mutex_lock(&sim->lock);
+    BOOL level = irq_line(sim, GENET_INTRL2_1_OFF);
+    pthread_mutex_unlock(&sim->lock);
+    return level;
+}
+
+/* BCM54213PE after reset, autonegotiated 1000/full with a gigabit partner */
+static void sim_phy_reset(struct GenetSim *sim)
+{
+    memset(sim->phy_regs, 0, sizeof(sim->phy_regs));
+    sim->phy_regs[MII_BMCR] = BMCR_ANENABLE | BMCR_SPEED1000 | BMCR_FULLDPLX;
+    sim->phy_regs[MII_BMSR] = BMSR_100FULL | BMSR_100HALF | BMSR_10FULL | BMSR_10HALF | BMSR_ESTATEN |
+                              BMSR_ANEGCOMPLETE | BMSR_ANEGCAPABLE | BMSR_LSTATUS | BMSR_ERCAP;
+    sim->phy_regs[MII_PHYSID1] = 0x600d;
+    sim->phy_regs[MII_PHYSID2] = 0x84a2;
+    sim->phy_regs[MII_ADVERTISE] = 0x01e1;
+    sim->phy_regs[MII_LPA] = 0xc5e1;
+    sim->phy_regs[MII_CTRL1000] = 0x0300;
+    sim->phy_regs[MII_STAT1000] = 0x3c00;
+    sim->phy_regs[MII_ESTATUS] = 0x3000;
+}
+
+/* MDIO transactions complete immediately, START_BUSY never reads back set */
+static ULONG mdio_command(struct GenetSim *sim, ULONG value)
+{
+    ULONG addr = (value >> MDIO_PMD_SHIFT) & 0x1f;
+    ULONG reg = (value >> MDIO_REG_SHIFT) & 0x1f;
+    ULONG result = value & ~(MDIO_START_BUSY | MDIO_READ_FAIL | 0xffff);
+
+    if (addr != GENET_SIM_PHY_ADDR)
+        return result | MDIO_READ_FAIL | 0xffff;
+
+    if (value & MDIO_WR)
+    {
+        UWORD data = value & 0xffff;
+        if (reg == MII_BMCR && (data & BMCR_RESET))
+            sim_phy_reset(sim);
+        else if (reg == MII_BMCR)
+            sim->phy_regs[reg] = data & ~BMCR_ANRESTART;
+        else if (reg != MII_BMSR && reg != MII_PHYSID1 && reg != MII_PHYSID2)
+            sim->phy_regs[reg] = data;
+        return result | data;
+    }
+    return result | sim->phy_regs[reg];
+}
+
+/* Destination address filter of the UniMAC */
+static BOOL mac_accepts(struct GenetSim *sim, const UBYTE *dst)
+{
+    if (reg_get(sim, UMAC_CMD) & CMD_PROMISC)
+        return TRUE;
+
+    ULONG mdf_ctrl = reg_get(sim, UMAC_MDF_CTRL) & ((1UL << 17) - 1);
+    if (mdf_ctrl == 0)
+    {
+        ULONG mac0 = reg_get(sim, UMAC_MAC0);
+        ULONG mac1 = reg_get(sim, UMAC_MAC1);
+        UBYTE own[6] = {mac0 >> 24, mac0 >> 16, mac0 >> 8, mac0, mac1 >> 8, mac1};
+        static const UBYTE broadcast[6] = {0xff, 0xff, 0xff, 0xff, 0xff, 0xff};
+        return memcmp(dst, own, 6) == 0 || memcmp(dst, broadcast, 6) == 0;
+    }
+
+    for (int i = 0; i < 17; i++)
+    {
+        if (!(mdf_ctrl & (1UL << (16 - i))))
+            continue;
+        ULONG hi = reg_get(sim, UMAC_MDF_ADDR + i * 8);
+        ULONG lo = reg_get(sim, UMAC_MDF_ADDR + i * 8 + 4);
+        UBYTE addr[6] = {hi >> 8, hi, lo >> 24, lo >> 16, lo >> 8, lo};
+        if (memcmp(dst, addr, 6) == 0)
+            return TRUE;
+    }
+    return FALSE;
+}
+
+/*
+ * Hardware Filter Block: enabled filters are tried in order, the first one
+ * matching picks the ring through DMA_INDEX2RING. A filter word covers two
+ * frame bytes, each of its mask bits 19..16 one nibble of them.
+ */
+static BOOL hfb_match(struct GenetSim *sim, ULONG f, const UBYTE *frame, ULONG length)
+{
+    ULONG len = (reg_get(sim, HFB_FLT_LEN + ((HFB_FILTER_CNT - 1 - f) / 4) * 4) >> (8 * (f % 4))) & 0xff;
+    if (length < len)
+        return FALSE;
+
+    for (ULONG i = 0; i < len / 2; i++)
+    {
+        ULONG word = reg_get(sim, GENET_HFB_OFF + (f * HFB_FILTER_SIZE + i) * 4);
+        ULONG value = (frame[i * 2] << 8) | frame[i * 2 + 1];
+        ULONG mask = 0;
+        for (int nibble = 0; nibble < 4; nibble++)
+        {
+            if (word & (1UL << (16 + nibble)))
+                mask |= 0xfUL << (4 * nibble);
+        }
+        if ((value & mask) != (word & mask))
+            return FALSE;
+    }
+    return TRUE;
+}
+
+static int rx_ring_for_frame(struct GenetSim *sim, const UBYTE *frame, ULONG length)
+{
+    if (!(reg_get(sim, HFB_CTRL) & RBUF_HFB_EN))
+        return DEFAULT_Q;
+
+    for (ULONG f = 0; f < HFB_FILTER_CNT; f++)
+    {
+        if (!(reg_get(sim, HFB_FLT_ENABLE + (f < 32 ? 4 : 0)) & (1UL << (f % 32))))
+            continue;
+        if (hfb_match(sim, f, frame, length))
+            return (reg_get(sim, RDMA_REG_BASE + DMA_INDEX2RING_0 + (f / 8) * 4) >> (4 * (f % 8))) & 0xf;
+    }
+    return DEFAULT_Q;
+}
+
+/* Ones' complement sum of big endian words, folded to 16 bits */
+static UWORD sim_csum(const UBYTE *data, ULONG length)
+{
+    ULONG sum = 0;
+    for (; length > 1; data += 2, length -= 2)
+        sum += (data[0] << 8) | data[1];
+    if (length)
+        sum += data[0] << 8;
+    while (sum >> 16)
+        sum = (sum & 0xffff) + (sum >> 16);
+    return sum;
+}
+
+/* Called with the lock held */
+static BOOL rx_dma_frame(struct GenetSim *sim, const UBYTE *frame, ULONG length)
+{
+    if (!(reg_get(sim, UMAC_CMD) & CMD_RX_EN))
+    {
+        sim->stats.rx_disabled++;
+        return FALSE;
+    }
+
+    /* The MAC counts what it sees on the wire, also frames it drops later on */
+    mib_count(sim, FALSE, frame, length);
+
+    if (!mac_accepts(sim, frame))
+    {
+        sim->stats.rx_filtered++;
+        return FALSE;
+    }
+
+    int q = rx_ring_for_frame(sim, frame, length);
+    if (!rdma_ring_enabled(sim, q))
+    {
+        sim->stats.rx_disabled++;
+        return FALSE;
+    }
+
+    struct sim_rx_ring *ring = &sim->rx[q];
+    ULONG ring_base = SIM_RDMA_RING(q);
+    ULONG buf_size_reg = reg_get(sim, ring_base + DMA_RING_BUF_SIZE);
+    ULONG size = ring_size(buf_size_reg);
+    ULONG buf_len = buf_size_reg & 0xffff;
+    ULONG rbuf_ctrl = reg_get(sim, RBUF_CTRL);
+    ULONG status_block = (rbuf_ctrl & RBUF_64B_EN) ? STATUS_BLOCK_SIZE : 0;
+    ULONG offset = status_block + ((rbuf_ctrl & RBUF_ALIGN_2B) ? RX_BUF_OFFSET : 0);
+
+    /* Number of buffers the frame is going to span */
+    ULONG needed = (length + offset + buf_len - 1) / buf_len;
+    UWORD cons_index = reg_get(sim, ring_base + SIM_RDMA_CONS_INDEX) & DMA_C_INDEX_MASK;
+    ULONG used = (UWORD)(ring->prod_index - cons_index);
+    if (used + needed > size)
+    {
+        ring->discards++;
+        sim->stats.rx_discards++;
+        return FALSE;
+    }
+
+    ULONG flags = 0;
+    if (frame[0] & 1)
+    {
+        static const UBYTE broadcast[6] = {0xff, 0xff, 0xff, 0xff, 0xff, 0xff};
+        flags = memcmp(frame, broadcast, 6) == 0 ? DMA_RX_BRDCAST : DMA_RX_MULT;
+    }
+
+    /* The write pointer walks the ring in words, wrapping after DMA_END_ADDR */
+    ULONG write_ptr = reg_get(sim, ring_base + RDMA_RING_WRITE_PTR);
+    ULONG copied = 0;
+    for (ULONG n = 0; n < needed; n++)
+    {
+        ULONG desc = GENET_RX_OFF + write_ptr * 4;
+        write_ptr += DMA_DESC_SIZE / 4;
+        if (write_ptr > reg_get(sim, ring_base + DMA_END_ADDR))
+            write_ptr = reg_get(sim, ring_base + DMA_START_ADDR);
+        UBYTE *buffer = (UBYTE *)(uintptr_t)reg_get(sim, desc + DMA_DESC_ADDRESS_LO);
+        sim->stats.desc_reads++;
+
+        ULONG chunk = buf_len - (n == 0 ? offset : 0);
+        if (chunk > length - copied)
+            chunk = length - copied;
+        memcpy(buffer + (n == 0 ? offset : 0), frame + copied, chunk);
+        copied += chunk;
+
+        ULONG status = flags;
+        if (n == 0)
+            status |= DMA_SOP;
+        if (n == needed - 1)
+            status |= DMA_EOP;
+        ULONG desc_len = chunk + (n == 0 ? offset : 0);
+        reg_set(sim, desc + DMA_DESC_LENGTH_STATUS, (desc_len << DMA_BUFLENGTH_SHIFT) | status);
+        if (n == 0 && status_block)
+        {
+            /* Receive Status Block: the descriptor word again and the sum after the Ethernet header */
+            memset(buffer, 0, STATUS_BLOCK_SIZE);
+            *(ULONG *)&buffer[STATUS_LENGTH_STATUS] = LE32((desc_len << DMA_BUFLENGTH_SHIFT) | status);
+            if ((reg_get(sim, RBUF_CHK_CTRL) & RBUF_RXCHK_EN) && length > ETH_HLEN)
+                *(ULONG *)&buffer[STATUS_RX_CSUM] = LE32(sim_csum(frame + ETH_HLEN, length - ETH_HLEN));
+        }
+        sim->stats.desc_writes++;
+
+        ring->prod_index++;
+        ring->done++;
+    }
+
+    reg_set(sim, ring_base + RDMA_RING_WRITE_PTR, write_ptr);
+
+    sim->stats.rx_frames++;
+    sim->stats.rx_bytes += length;
+
+    ULONG threshold = reg_get(sim, ring_base + DMA_MBUF_DONE_THRESH) & DMA_INTR_THRESHOLD_MASK;
+    ULONG timeout = reg_get(sim, RDMA_REG_BASE + DMA_RING0_TIMEOUT + q * 4) & DMA_TIMEOUT_MASK;
+    if (threshold != 0 && ring->done >= threshold)
+    {
+        raise_rx_done(sim, q);
+    }
+    else if (timeout != 0 && !ring->timer_armed)
+    {
+        ring->timer_armed = TRUE;
+        ring->deadline = sim->now + (uint64_t)timeout * SIM_DMA_TIMEOUT_TICK_NS;
+    }
+    return TRUE;
+}
+
+/* Strict priority arbiter: lowest DMA_PRIORITY value wins, then the lower ring number */
+static int tx_pick_ring(struct GenetSim *sim)
+{
+    int best = -1;
+    ULONG best_prio = 0;
+
+    for (int q = 0; q < SIM_RINGS; q++)
+    {
+        if (!tdma_ring_enabled(sim, q))
+            continue;
+        UWORD prod_index = reg_get(sim, SIM_TDMA_RING(q) + SIM_TDMA_PROD_INDEX) & DMA_P_INDEX_MASK;
+        if (prod_index == sim->tx[q].cons_index)
+            continue;
+
+        ULONG prio_reg = reg_get(sim, TDMA_REG_BASE + DMA_PRIORITY_0 + (q / 6) * 4);
+        ULONG prio = (prio_reg >> ((q % 6) * 5)) & 0x1f;
+        if (best < 0 || prio < best_prio)
+        {
+            best = q;
+            best_prio = prio;
+        }
+    }
+    return best;
+}
+
+/*
+ * Fetch the descriptor chain at the head of ring q. Returns the number of
+ * descriptors forming a complete SOP..EOP frame, 0 if the chain is not
+ * complete yet. *read_ptr is where the read pointer goes once the frame is
+ * sent: it walks the ring in words, wrapping after DMA_END_ADDR.
+ */
+static ULONG tx_fetch_frame(struct GenetSim *sim, int q, ULONG *frame_length, BOOL *error, ULONG *read_ptr)
+{
+    ULONG ring_base = SIM_TDMA_RING(q);
+    UWORD prod_index = reg_get(sim, ring_base + SIM_TDMA_PROD_INDEX) & DMA_P_INDEX_MASK;
+    UWORD index = sim->tx[q].cons_index;
+    ULONG ptr = reg_get(sim, ring_base + SIM_TDMA_READ_PTR);
+    ULONG length = 0;
+    ULONG descs = 0;
+
+    *error = FALSE;
+    while (index != prod_index)
+    {
+        ULONG desc = GENET_TX_OFF + ptr * 4;
+        ptr += DMA_DESC_SIZE / 4;
+        if (ptr > reg_get(sim, ring_base + DMA_END_ADDR))
+            ptr = reg_get(sim, ring_base + DMA_START_ADDR);
+        ULONG len_stat = reg_get(sim, desc + DMA_DESC_LENGTH_STATUS);
+        UBYTE *buffer = (UBYTE *)(uintptr_t)reg_get(sim, desc + DMA_DESC_ADDRESS_LO);
+        ULONG chunk = (len_stat >> DMA_BUFLENGTH_SHIFT) & DMA_BUFLENGTH_MASK;
+        sim->stats.desc_reads += 2;
+
+        if (descs == 0 && !(len_stat & DMA_SOP))
+            *error = TRUE;
+        if (length + chunk <= sizeof(sim->tx_frame))
+            memcpy(&sim->tx_frame[length], buffer, chunk);
+        else
+            *error = TRUE;
+        length += chunk;
+        descs++;
+        index++;
+
+        if (len_stat & DMA_EOP)
+        {
+            *frame_length = length;
+            *read_ptr = ptr;
+            return descs;
+        }
+    }
+    return 0;
+}
+
+/*
+ * TBUF_64B_EN: strip the Transmit Status Block from the front of the frame
+ * and insert the checksum it asks for. FALSE if the frame is too short.
+ */
+static BOOL tx_status_block(struct GenetSim *sim, ULONG *length)
+{
+    if (*length < STATUS_BLOCK_SIZE + ETH_HLEN)
+        return FALSE;
+
+    ULONG info = LE32(*(ULONG *)&sim->tx_frame[STATUS_TX_CSUM_INFO]);
+    *length -= STATUS_BLOCK_SIZE;
+    memmove(sim->tx_frame, &sim->tx_frame[STATUS_BLOCK_SIZE], *length);
+
+    if (info & STATUS_TX_CSUM_LV)
+    {
+        ULONG start = (info >> STATUS_TX_CSUM_START_SHIFT) & 0x7fff;
+        ULONG field = info & 0x7fff;
+        if (start >= *length || field + 2 > *length)
+            return FALSE;
+        UWORD csum = ~sim_csum(&sim->tx_frame[start], *length - start);
+        if (csum == 0 && (info & STATUS_TX_CSUM_PROTO_UDP))
+            csum = 0xffff;
+        sim->tx_frame[field] = csum >> 8;
+        sim->tx_frame[field + 1] = csum;
+        sim->stats.tx_csum++;
+    }
+    return TRUE;
+}
+
+/* Called with the lock held */
+static void tx_engine_run(struct GenetSim *sim, uint64_t until)
+{
+    if (!(reg_get(sim, UMAC_CMD) & CMD_TX_EN))
+        return;
+
+    for (;;)
+    {
+        int q = tx_pick_ring(sim);
+        if (q < 0)
+            break;
+
+        ULONG length = 0;
+        BOOL error;
+        ULONG read_ptr;
+        ULONG descs = tx_fetch_frame(sim, q, &length, &error, &read_ptr);
+        if (descs == 0)
+            break;
+
+        uint64_t start = sim->tx_busy_until > sim->now ? sim->tx_busy_until : sim->now;
+        uint64_t wire_ns = 0;
+        if (sim->config.link_mbps)
+        {
+            ULONG wire_bytes = (length < SIM_MIN_FRAME ? SIM_MIN_FRAME : length) + SIM_WIRE_OVERHEAD;
+            wire_ns = (uint64_t)wire_bytes * 8 * 1000 / sim->config.link_mbps;
+        }
+        if (start + wire_ns > until)
+            break;
+        sim->tx_busy_until = start + wire_ns;
+
+        if (!error && (reg_get(sim, TBUF_CTRL) & TBUF_64B_EN))
+            error = !tx_status_block(sim, &length);
+
+        if (error)
+        {
+            sim->stats.tx_errors++;
+        }
+        else
+        {
+            sim->stats.tx_frames++;
+            sim->stats.tx_bytes += length;
+            mib_count(sim, TRUE, sim->tx_frame, length);
+            if (sim->tx_sink)
+                sim->tx_sink(sim->tx_context, sim->tx_frame, length);
+        }
+
+        struct sim_tx_ring *ring = &sim->tx[q];
+        ring->cons_index += descs;
+        ring->done += descs;
+        sim->stats.tx_descs += descs;
+
+        ULONG ring_base = SIM_TDMA_RING(q);
+        reg_set(sim, ring_base + SIM_TDMA_READ_PTR, read_ptr);
+        ULONG threshold = reg_get(sim, ring_base + DMA_MBUF_DONE_THRESH) & DMA_INTR_THRESHOLD_MASK;
+        UWORD prod_index = reg_get(sim, ring_base + SIM_TDMA_PROD_INDEX) & DMA_P_INDEX_MASK;
+        if ((threshold != 0 && ring->done >= threshold) || prod_index == ring->cons_index)
+            raise_tx_done(sim, q);
+    }
+}
+
+static void rx_timers_run(struct GenetSim *sim, uint64_t until)
+{
+    for (int q = 0; q < SIM_RINGS; q++)
+    {
+        struct sim_rx_ring *ring = &sim->rx[q];
+        if (ring->timer_armed && ring->deadline <= until)
+            raise_rx_done(sim, q);
+    }
+}
+
+ULONG host_mmio_read(uintptr_t addr)
+{
+    struct GenetSim *sim = sim_instance;
+    ULONG offset = addr - host_mmio_start;
+    ULONG value;
+
+    pthread_mutex_lock(&sim->lock);
+    sim->stats.mmio_reads++;
+    sim->stats.bus_ns += sim->config.mmio_read_ns;
+
+    if (offset >= GENET_RDMA_REG_OFF && offset < GENET_RDMA_REG_OFF + DMA_RINGS_SIZE &&
+        (offset - GENET_RDMA_REG_OFF) % DMA_RING_SIZE == SIM_RDMA_PROD_INDEX)
+    {
+        struct sim_rx_ring *ring = &sim->rx[(offset - GENET_RDMA_REG_OFF) / DMA_RING_SIZE];
+        value = ((ULONG)ring->discards << DMA_P_INDEX_DISCARD_CNT_SHIFT) | ring->prod_index;
+    }
+    else if (offset >= GENET_TDMA_REG_OFF && offset < GENET_TDMA_REG_OFF + DMA_RINGS_SIZE &&
+             (offset - GENET_TDMA_REG_OFF) % DMA_RING_SIZE == SIM_TDMA_CONS_INDEX)
+    {
+        value = sim->tx[(offset - GENET_TDMA_REG_OFF) / DMA_RING_SIZE].cons_index;
+    }
+    else
+    {
+        value = reg_get(sim, offset);
+    }
+    pthread_mutex_unlock(&sim->lock);
+    return value;
+}
+
+void host_mmio_write(uintptr_t addr, ULONG value)
+{
+    struct GenetSim *sim = sim_instance;
+    ULONG offset = addr - host_mmio_start;
+    ULONG asserted = 0;
+
+    pthread_mutex_lock(&sim->lock);
+    sim->stats.mmio_writes++;
+    sim->stats.bus_ns += sim->config.mmio_write_ns;
+
+    ULONG intrl2 = 0;
+    if (offset >= GENET_INTRL2_0_OFF && offset < GENET_INTRL2_0_OFF + 0x40)
+        intrl2 = GENET_INTRL2_0_OFF;
+    else if (offset >= GENET_INTRL2_1_OFF && offset < GENET_INTRL2_1_OFF + 0x40)
+        intrl2 = GENET_INTRL2_1_OFF;
+
+    if (intrl2)
+    {
+        ULONG *stat = &sim->regs[(intrl2 + INTRL2_CPU_STAT) >> 2];
+        ULONG *mask = &sim->regs[(intrl2 + INTRL2_CPU_MASK_STATUS) >> 2];
+        switch (offset - intrl2)
+        {
+        case INTRL2_CPU_SET:
+            *stat |= value;
+            break;
+        case INTRL2_CPU_CLEAR:
+            *stat &= ~value;
+            break;
+        case INTRL2_CPU_MASK_SET:
+            *mask |= value;
+            break;
+        case INTRL2_CPU_MASK_CLEAR:
+            *mask &= ~value;
+            break;
+        default:
+            break;
+        }
+        asserted = update_irq_lines(sim);
+    }
+    else if (offset >= GENET_RDMA_REG_OFF && offset < GENET_RDMA_REG_OFF + DMA_RINGS_SIZE &&
+             (offset - GENET_RDMA_REG_OFF) % DMA_RING_SIZE == SIM_RDMA_PROD_INDEX)
+    {
+        /* The producer index is read-only, a write clears the discard counter */
+        sim->rx[(offset - GENET_RDMA_REG_OFF) / DMA_RING_SIZE].discards = 0;
+    }
+    else if (offset >= GENET_TDMA_REG_OFF && offset < GENET_TDMA_REG_OFF + DMA_RINGS_SIZE &&
+             (offset - GENET_TDMA_REG_OFF) % DMA_RING_SIZE == SIM_TDMA_CONS_INDEX)
+    {
+        /* Consumer index is owned by the TX engine */
+    }
+    else if (offset == UMAC_MIB_CTRL)
+    {
+        reg_set(sim, offset, value);
+        mib_reset(sim, value);
+    }
+    else if (offset == MDIO_CMD && (value & MDIO_START_BUSY))
+    {
+        reg_set(sim, offset, mdio_command(sim, value));
+    }
+    else
+    {
+        reg_set(sim, offset, value);
+    }
+    pthread_mutex_unlock(&sim->lock);
+
+    deliver_irqs(asserted);
+}
+
+struct GenetSim *genet_sim_create(const struct GenetSimConfig *config)
+{
+    if (sim_instance)
+    {
+        Kprintf("[genet-sim] %s: only one simulated GENET per process\n", __func__);
+        return NULL;
+    }
+
+    struct GenetSim *sim = HostAllocLow(sizeof(struct GenetSim));
+    if (!sim)
+        return NULL;
+    memset(sim, 0, sizeof(*sim));
+
+    sim->regs = HostAllocLow(GENET_SIM_REGS_SIZE);
+    if (!sim->regs)
+    {
+        HostFreeLow(sim, sizeof(struct GenetSim));
+        return NULL;
+    }
+    memset(sim->regs, 0, GENET_SIM_REGS_SIZE);
+
+    pthread_mutex_init(&sim->lock, NULL);
+    if (config)
+        sim->config = *config;
+    else
+        sim->config.link_mbps = 1000;
+
+    /* GENET v5.0, as found on the BCM2711 */
+    reg_set(sim, SYS_REV_CTRL, 0x06000000);
+    /* Everything masked out of reset */
+    reg_set(sim, GENET_INTRL2_0_OFF + INTRL2_CPU_MASK_STATUS, 0xFFFFFFFF);
+    reg_set(sim, GENET_INTRL2_1_OFF + INTRL2_CPU_MASK_STATUS, 0xFFFFFFFF);
+
+    sim_phy_reset(sim);
+
+    static const UBYTE mac[6] = {0xdc, 0xa6, 0x32, 0x00, 0x00, 0x01};
+    memcpy(sim->mac, mac, sizeof(sim->mac));
+
+    sim_instance = sim;
+    host_mmio_start = (uintptr_t)sim->regs;
+    host_mmio_end = host_mmio_start + GENET_SIM_REGS_SIZE;
+
+    HostRegisterInterruptSource(GENET_SIM_IRQ0, irq0_asserted, sim);
+    HostRegisterInterruptSource(GENET_SIM_IRQ1, irq1_asserted, sim);
+
+    return sim;
+}
+
+void genet_sim_destroy(struct GenetSim *sim)
+{
+    if (!sim)
+        return;
+
+    HostUnregisterInterruptSource(GENET_SIM_IRQ0);
+    HostUnregisterInterruptSource(GENET_SIM_IRQ1);
+
+    host_mmio_start = 0;
+    host_mmio_end = 0;
+    sim_instance = NULL;
+
+    pthread_mutex_destroy(&sim->lock);
+    HostFreeLow(sim->regs, GENET_SIM_REGS_SIZE);
+    HostFreeLow(sim, sizeof(struct GenetSim));
+}
+
+struct GenetSim *genet_sim_instance(void)
+{
+    return sim_instance;
+}
+
+APTR genet_sim_regs(struct GenetSim *sim)
+{
+    return sim->regs;
+}
+
+const UBYTE *genet_sim_mac_address(struct GenetSim *sim)
+{
+    return sim->mac;
+}
+
+void genet_sim_set_tx_sink(struct GenetSim *sim, GenetSimTxSink sink, void *context)
+{
+    pthread_mutex_lock(&sim->lock);
+    sim->tx_sink = sink;
+    sim->tx_context = context;
+    pthread_mutex_unlock(&sim->lock);
+}
+
+BOOL genet_sim_receive(struct GenetSim *sim, const UBYTE *frame, ULONG length)
+{
+    pthread_mutex_lock(&sim->lock);
+    BOOL accepted = rx_dma_frame(sim, frame, length);
+    ULONG asserted = update_irq_lines(sim);
+    pthread_mutex_unlock(&sim->lock);
+
+    deliver_irqs(asserted);
+    return accepted;
+}
+
+void genet_sim_advance(struct GenetSim *sim, uint64_t ns)
+{
+    pthread_mutex_lock(&sim->lock);
+    uint64_t until = sim->now + ns;
+    tx_engine_run(sim, until);
+    rx_timers_run(sim, until);
+    sim->now = until;
+    ULONG asserted = update_irq_lines(sim);
+    pthread_mutex_unlock(&sim->lock);
+
+    deliver_irqs(asserted);
+}
+
+uint64_t genet_sim_now(struct GenetSim *sim)
+{
+    pthread_mutex_lock(&sim->lock);
+    uint64_t now = sim->now;
+    pthread_mutex_unlock(&sim->lock);
+    return now;
+}
+
+ULONG genet_sim_tx_pending(struct GenetSim *sim)
+{
+    ULONG pending = 0;
+
+    pthread_mutex_lock(&sim->lock);
+    for (int q = 0; q < SIM_RINGS; q++)
+    {
+        UWORD prod_index = reg_get(sim, SIM_TDMA_RING(q) + SIM_TDMA_PROD_INDEX) & DMA_P_INDEX_MASK;
+        pending += (UWORD)(prod_index - sim->tx[q].cons_index);
+    }
+    pthread_mutex_unlock(&sim->lock);
+    return pending;
+}
+
+void genet_sim_get_stats(struct GenetSim *sim, struct GenetSimStats *stats)
+{
+    pthread_mutex_lock(&sim->lock);
+    *stats = sim->stats;
+    pthread_mutex_unlock(&sim->lock);
+}
+
+void genet_sim_reset_stats(struct GenetSim *sim)
+{
+    pthread_mutex_lock(&sim->lock);
+    memset(&sim->stats, 0, sizeof(sim->stats));
+    pthread_mutex_unlock(&sim->lock);
+}
@@ -0,0 +1,148 @@
+// SPDX-License-Identifier: MPL-2.0 OR GPL-2.0+
+/*
+ * Host implementations of the helpers the driver takes from the common
+ * submodule: Kprintf(), delay_us() and the free running 1MHz system timer
+ * the driver reads at 0xf2003004. The timer is plain memory, exec brings it
+ * up to date whenever a task wakes up, is signalled or an interrupt is taken.
+ */
+#define _GNU_SOURCE
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+
+#include <exec/types.h>
+
+#include <compat.h>
+#include <debug.h>
+#include <host_exec.h>
+
+#define SYSTIMER_PAGE 0xf2003000UL
+#define SYSTIMER_CLO 0x04
+
+static volatile ULONG *sysTimer;
+static int debugEnabled = -1;
+
+/* The bcm2835 system timer block, updated from HostSysTimerUpdate() */
+__attribute__((constructor)) static void SysTimerInit(void)
+{
+    APTR page = mmap((APTR)SYSTIMER_PAGE, 4096, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+    if (page == (APTR)SYSTIMER_PAGE)
+    {
+        sysTimer = page;
+        sysTimer[SYSTIMER_CLO / 4] = HostNanoTime() / 1000;
+    }
+}
+
+/* Called from several threads, the counter only moves forward like the real one */
+void HostSysTimerUpdate(void)
+{
+    if (!sysTimer)
+        return;
+
+    ULONG now = HostNanoTime() / 1000;
+    ULONG old = __atomic_load_n(&sysTimer[SYSTIMER_CLO / 4], __ATOMIC_RELAXED);
+    while ((LONG)(now - old) > 0 &&
+           !__atomic_compare_exchange_n(&sysTimer[SYSTIMER_CLO / 4], &old, now, TRUE, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        ;
+}
+
+void delay_us(ULONG us)
+{
+    struct timespec ts = {us / 1000000, (us % 1000000) * 1000};
+    nanosleep(&ts, NULL);
+    HostSysTimerUpdate();
+}
+
+/*
+ * The driver is written for a 32 bit target, where %ld/%lx take a 32 bit
+ * argument. Rewrite each conversion so that it consumes 32 bits, except %ll
+ * which stays 64 bit.
+ */
+static void FormatAmiga(char *out, size_t size, const char *format, va_list args)
+{
+    size_t used = 0;
+
+    while (*format && used + 1 < size)
+    {
+        if (*format != '%')
+        {
+            out[used++] = *format++;
+            continue;
+        }
+
+        char spec[32];
+        size_t n = 0;
+        spec[n++] = *format++;
+        while (*format && strchr("-+ #0123456789.", *format) && n < sizeof(spec) - 4)
+            spec[n++] = *format++;
+
+        int longs = 0;
+        while (*format == 'l' || *format == 'h')
+        {
+            if (*format == 'l')
+                longs++;
+            format++;
+        }
+
+        char conversion = *format ? *format++ : '\0';
+        int written = 0;
+        switch (conversion)
+        {
+        case 'd':
+        case 'i':
+        case 'u':
+        case 'x':
+        case 'X':
+        case 'c':
+            if (longs >= 2)
+            {
+                spec[n++] = 'l';
+                spec[n++] = 'l';
+                spec[n++] = conversion;
+                spec[n] = '\0';
+                written = snprintf(out + used, size - used, spec, va_arg(args, long long));
+            }
+            else
+            {
+                spec[n++] = conversion;
+                spec[n] = '\0';
+                written = snprintf(out + used, size - used, spec, va_arg(args, int));
+            }
+            break;
+        case 's':
+        case 'p':
+            spec[n++] = conversion;
+            spec[n] = '\0';
+            written = snprintf(out + used, size - used, spec, va_arg(args, void *));
+            break;
+        case '%':
+            out[used++] = '%';
+            break;
+        default:
+            break;
+        }
+
+        if (written > 0)
+            used += (size_t)written < size - used ? (size_t)written : size - used - 1;
+    }
+    out[used] = '\0';
+}
+
+void Kprintf(const char *format, ...)
+{
+    if (debugEnabled < 0)
+        debugEnabled = getenv("GENET_HOST_DEBUG") != NULL;
+    if (!debugEnabled)
+        return;
+
+    char buffer[1024];
+    va_list args;
+    va_start(args, format);
+    FormatAmiga(buffer, sizeof(buffer), format, args);
+    va_end(args);
+    fputs(buffer, stderr);
+}
@@ -0,0 +1,55 @@
+// SPDX-License-Identifier: MPL-2.0 OR GPL-2.0+
+/* Host (Linux) utility.library shim */
+#include <strings.h>
+
+#include <proto/utility.h>
+
+static const struct TagItem *NextTag(const struct TagItem *tag)
+{
+    while (tag)
+    {
+        switch (tag->ti_Tag)
+        {
+        case TAG_DONE:
+            return NULL;
+        case TAG_IGNORE:
+            tag++;
+            break;
+        case TAG_MORE:
+            tag = (const struct TagItem *)(uintptr_t)tag->ti_Data;
+            break;
+        case TAG_SKIP:
+            tag += tag->ti_Data + 1;
+            break;
+        default:
+            return tag;
+        }
+    }
+    return NULL;
+}
+
+struct TagItem *FindTagItem(Tag tagVal, const struct TagItem *tagList)
+{
+    for (const struct TagItem *tag = NextTag(tagList); tag; tag = NextTag(tag + 1))
+    {
+        if (tag->ti_Tag == tagVal)
+            return (struct TagItem *)tag;
+    }
+    return NULL;
+}
+
+ULONG GetTagData(Tag tagValue, ULONG defaultVal, const struct TagItem *tagList)
+{
+    const struct TagItem *tag = FindTagItem(tagValue, tagList);
+    return tag ? tag->ti_Data : defaultVal;
+}
+
+ULONG CallHookPkt(struct Hook *hook, APTR object, APTR paramPacket)
+{
+    return ((ULONG(*)(struct Hook *, APTR, APTR))hook->h_Entry)(hook, object, paramPacket);
+}
+
+LONG Stricmp(CONST_STRPTR string1, CONST_STRPTR string2)
+{
+    return strcasecmp((const char *)string1, (const char *)string2);
+}
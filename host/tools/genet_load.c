@@ -0,0 +1,408 @@
+// SPDX-License-Identifier: MPL-2.0 OR GPL-2.0+
+/*
+ * genet-load: the driver as a concurrent system. The device is opened
+ * through openLib(), which starts the real unit task; every client is a
+ * task of its own with CMD_READs outstanding and CMD_WRITEs in flight, and
+ * a wire thread feeds frames to the simulated GENET in real time.
+ *
+ * With LATENCY_STATS=1 in the prefs the stage histograms of
+ * GENETCMD_GETLATENCY are printed at the end. With TRACE_EVENTS set and
+ * GENET_HOST_TRACE=<file> in the environment the GENETCMD_GETTRACE buffer
+ * is saved to that file for genet-trace.
+ *
+ * Usage: genet-load [clients] [seconds] [rx_pps] [payload]
+ */
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <proto/exec.h>
+#include <dos/dos.h>
+
+#include <host_exec.h>
+
+#include "harness.h"
+
+#define MAX_CLIENTS 16
+#define READS_PER_CLIENT 16
+#define WRITES_PER_CLIENT 8
+#define MAX_FRAME 1536
+
+struct Client
+{
+    pthread_t thread;
+    struct Task *task;
+    ULONG payload;
+    uint64_t rx;
+    uint64_t tx;
+    uint64_t txErrors;
+    ULONG txStalled;
+    BOOL opened;
+    BOOL done;
+};
+
+static const UBYTE peerAddress[6] = {0x02, 0x00, 0x00, 0x00, 0x00, 0x02};
+
+static struct GenetSim *sim;
+static struct GenetDevice *base;
+static volatile BOOL clientsStop;
+static volatile BOOL wireStop;
+static volatile BOOL drainTimeout;
+static volatile ULONG clientsReady;
+static uint64_t wireInjected;
+static uint64_t wireDropped;
+
+static void *ClientThread(void *arg)
+{
+    struct Client *client = arg;
+    struct Harness harness = {.sim = sim};
+
+    client->task = FindTask(NULL);
+    harness.replyPort = CreateMsgPort();
+    struct IOSana2Req *openIo = harness_open(&harness, base, NULL);
+    if (!openIo)
+    {
+        DeleteMsgPort(harness.replyPort);
+        __atomic_add_fetch(&clientsReady, 1, __ATOMIC_RELEASE);
+        return NULL;
+    }
+    client->opened = TRUE;
+    struct Opener *opener = openIo->ios2_BufferManagement;
+
+    UBYTE *buffers = AllocMem((READS_PER_CLIENT + WRITES_PER_CLIENT) * MAX_FRAME, MEMF_PUBLIC | MEMF_CLEAR);
+    ULONG reads = 0;
+    ULONG writes = 0;
+
+    for (int i = 0; i < READS_PER_CLIENT; i++, reads++)
+        beginIO(harness_io(&harness, opener, CMD_READ, 0x0800, &buffers[i * MAX_FRAME], MAX_FRAME), base);
+
+    struct IOSana2Req *writeIo[WRITES_PER_CLIENT];
+    for (int i = 0; i < WRITES_PER_CLIENT; i++)
+    {
+        writeIo[i] = harness_io(&harness, opener, CMD_WRITE, 0x0800,
+                                &buffers[(READS_PER_CLIENT + i) * MAX_FRAME], client->payload);
+        CopyMem(peerAddress, writeIo[i]->ios2_DstAddr, 6);
+    }
+
+    __atomic_add_fetch(&clientsReady, 1, __ATOMIC_RELEASE);
+
+    while (!clientsStop)
+    {
+        while (writes < WRITES_PER_CLIENT)
+        {
+            struct IOSana2Req *io = writeIo[writes++];
+            io->ios2_Req.io_Flags = 0;
+            beginIO(io, base);
+        }
+
+        uint64_t txErrors = client->txErrors;
+        Wait((1UL << harness.replyPort->mp_SigBit) | SIGBREAKF_CTRL_C);
+
+        struct IOSana2Req *io;
+        while ((io = (struct IOSana2Req *)GetMsg(harness.replyPort)))
+        {
+            if (io->ios2_Req.io_Command == CMD_READ)
+            {
+                if (io->ios2_Req.io_Error == 0)
+                    client->rx++;
+                if (clientsStop)
+                {
+                    reads--;
+                    harness_free_io(io);
+                }
+                else
+                {
+                    io->ios2_DataLength = MAX_FRAME;
+                    beginIO(io, base);
+                }
+            }
+            else
+            {
+                if (io->ios2_Req.io_Error == 0)
+                    client->tx++;
+                else
+                    client->txErrors++;
+                writeIo[--writes] = io;
+            }
+        }
+
+        /* TX ring full, give the wire a chance before retrying */
+        if (client->txErrors != txErrors)
+            sched_yield();
+    }
+
+    /* Return the outstanding reads, wait for the writes on the ring */
+    struct IOSana2Req *flush = harness_io(&harness, opener, CMD_FLUSH, 0, NULL, 0);
+    harness_do_io(base, flush);
+    harness_free_io(flush);
+
+    while (reads || writes)
+    {
+        struct IOSana2Req *io = (struct IOSana2Req *)GetMsg(harness.replyPort);
+        if (!io)
+        {
+            Wait((1UL << harness.replyPort->mp_SigBit) | SIGBREAKF_CTRL_C);
+            if (drainTimeout)
+                break;
+            continue;
+        }
+        if (io->ios2_Req.io_Command == CMD_READ)
+        {
+            reads--;
+            harness_free_io(io);
+        }
+        else
+        {
+            if (io->ios2_Req.io_Error == 0)
+                client->tx++;
+            writeIo[--writes] = io;
+        }
+    }
+
+    /* Writes the driver never replied stay on the TX ring, they cannot be freed */
+    client->txStalled = writes;
+    for (int i = writes; i < WRITES_PER_CLIENT; i++)
+        harness_free_io(writeIo[i]);
+    FreeMem(buffers, (READS_PER_CLIENT + WRITES_PER_CLIENT) * MAX_FRAME);
+
+    harness_close(&harness, base, openIo);
+    DeleteMsgPort(harness.replyPort);
+    client->done = TRUE;
+    return NULL;
+}
+
+/* Puts frames on the wire at rx_pps and keeps simulated time in step with the host clock */
+static void *WireThread(void *arg)
+{
+    ULONG pps = *(ULONG *)arg;
+    UBYTE frame[MAX_FRAME];
+    ULONG length = harness_frame(frame, genet_sim_mac_address(sim), peerAddress, 0x0800, 256);
+
+    uint64_t start = HostNanoTime();
+    uint64_t last = start;
+    while (!wireStop)
+    {
+        uint64_t now = HostNanoTime();
+        uint64_t due = pps * (now - start) / 1000000000ULL;
+        for (int burst = 0; wireInjected < due && burst < 64; burst++, wireInjected++)
+        {
+            if (!genet_sim_receive(sim, frame, length))
+                wireDropped++;
+        }
+
+        genet_sim_advance(sim, now - last);
+        last = now;
+
+        struct timespec ts = {0, 20000};
+        nanosleep(&ts, NULL);
+    }
+    return NULL;
+}
+
+static const char *latencyStage[GENET_LATENCY_STAGES] = {"rx irq", "rx ring", "rx deliver", "rx total",
+                                                           "tx queue", "tx complete", "tx total"};
+
+/* Upper bound in us of the bucket the given share of a stage's times falls into */
+static ULONG LatencyPercentile(const ULONG *histogram, uint64_t count, ULONG percent)
+{
+    uint64_t seen = 0;
+    for (ULONG i = 0; i < GENET_LATENCY_BUCKETS; i++)
+    {
+        seen += histogram[i];
+        if (seen * 100 >= count * percent)
+            return 1UL << i;
+    }
+    return 1UL << (GENET_LATENCY_BUCKETS - 1);
+}
+
+static void PrintLatency(struct Harness *control, struct GenetDevice *base, struct Opener *opener)
+{
+    struct GenetLatency latency = {.gl_Length = sizeof(latency)};
+    struct IOSana2Req *io = harness_io(control, opener, GENETCMD_GETLATENCY, 0, NULL, 0);
+    io->ios2_StatData = &latency;
+    BYTE error = harness_do_io(base, io);
+    harness_free_io(io);
+    if (error)
+        return;
+
+    printf("latency: %-12s %10s %8s %8s %8s\n", "stage", "count", "p50 us", "p99 us", "max us");
+    for (ULONG s = 0; s < GENET_LATENCY_STAGES; s++)
+    {
+        uint64_t count = 0;
+        for (ULONG i = 0; i < GENET_LATENCY_BUCKETS; i++)
+            count += latency.gl_Histogram[s][i];
+        if (count == 0)
+            continue;
+        printf("latency: %-12s %10llu %8lu %8lu %8lu\n", latencyStage[s], (unsigned long long)count,
+               (unsigned long)LatencyPercentile(latency.gl_Histogram[s], count, 50),
+               (unsigned long)LatencyPercentile(latency.gl_Histogram[s], count, 99),
+               (unsigned long)latency.gl_Max[s]);
+    }
+}
+
+/* The trace as GENETCMD_GETTRACE returns it, header and entries */
+static void SaveTrace(struct Harness *control, struct GenetDevice *base, struct Opener *opener)
+{
+    const char *path = getenv("GENET_HOST_TRACE");
+    if (path == NULL)
+        return;
+
+    struct GenetTrace header = {.gt_Length = sizeof(header)};
+    struct IOSana2Req *io = harness_io(control, opener, GENETCMD_GETTRACE, 0, NULL, 0);
+    io->ios2_StatData = &header;
+    if (harness_do_io(base, io) == 0)
+    {
+        struct GenetTrace *trace = calloc(1, header.gt_Actual);
+        trace->gt_Length = header.gt_Actual;
+        io->ios2_StatData = trace;
+        if (harness_do_io(base, io) == 0)
+        {
+            FILE *file = fopen(path, "wb");
+            if (file == NULL || fwrite(trace, sizeof(*trace) + trace->gt_Count * sizeof(struct GenetTraceEntry), 1, file) != 1)
+                fprintf(stderr, "genet-load: cannot write the trace to %s\n", path);
+            else
+                printf("trace: %lu entries of %lu events saved to %s\n", (unsigned long)trace->gt_Count,
+                       (unsigned long)trace->gt_Next, path);
+            if (file)
+                fclose(file);
+        }
+        free(trace);
+    }
+    harness_free_io(io);
+}
+
+int main(int argc, char **argv)
+{
+    ULONG clients, seconds, pps, payload;
+    if (argc > 5 || !harness_arg(argc, argv, 1, 4, 1, &clients) || !harness_arg(argc, argv, 2, 2, 1, &seconds) ||
+        !harness_arg(argc, argv, 3, 50000, 0, &pps) || !harness_arg(argc, argv, 4, 512, 0, &payload))
+    {
+        fprintf(stderr, "usage: genet-load [clients] [seconds] [rx_pps] [payload]\n");
+        return 1;
+    }
+    if (clients > MAX_CLIENTS)
+        clients = MAX_CLIENTS;
+    if (payload > ETH_DATA_LEN)
+        payload = ETH_DATA_LEN;
+
+    struct GenetSimConfig config = {.link_mbps = 1000, .mmio_read_ns = 200, .mmio_write_ns = 50};
+    sim = genet_sim_create(&config);
+    base = harness_device_init();
+    if (!sim || !base)
+    {
+        fprintf(stderr, "genet-load: setup failed\n");
+        return 1;
+    }
+
+    /* The control opener brings the unit up and is the last one to close it */
+    struct Harness control = {.sim = sim, .replyPort = CreateMsgPort()};
+    struct IOSana2Req *controlIo = harness_open(&control, base, NULL);
+    if (!controlIo)
+    {
+        fprintf(stderr, "genet-load: OpenDevice failed\n");
+        return 1;
+    }
+    struct IOSana2Req *config_io = harness_io(&control, controlIo->ios2_BufferManagement, S2_CONFIGINTERFACE, 0, NULL, 0);
+    CopyMem(control.unit->localMacAddress, config_io->ios2_SrcAddr, 6);
+    BYTE error = harness_do_io(base, config_io);
+    harness_free_io(config_io);
+    if (error)
+    {
+        fprintf(stderr, "genet-load: S2_CONFIGINTERFACE failed: %d\n", error);
+        return 1;
+    }
+
+    struct Client client[MAX_CLIENTS];
+    memset(client, 0, sizeof(client));
+    for (ULONG i = 0; i < clients; i++)
+    {
+        client[i].payload = payload;
+        pthread_create(&client[i].thread, NULL, ClientThread, &client[i]);
+    }
+    while (__atomic_load_n(&clientsReady, __ATOMIC_ACQUIRE) < clients)
+        sched_yield();
+
+    genet_sim_reset_stats(sim);
+    HostResetExecStats();
+
+    pthread_t wire;
+    pthread_create(&wire, NULL, WireThread, &pps);
+
+    uint64_t start = HostNanoTime();
+    struct timespec ts = {seconds, 0};
+    nanosleep(&ts, NULL);
+
+    clientsStop = TRUE;
+    double elapsed = (HostNanoTime() - start) / 1e9;
+    for (ULONG i = 0; i < clients; i++)
+    {
+        if (client[i].opened)
+            Signal(client[i].task, SIGBREAKF_CTRL_C);
+    }
+
+    /* Give the clients a second to get their last writes back */
+    uint64_t drainStart = HostNanoTime();
+    for (ULONG i = 0; i < clients; i++)
+    {
+        while (!__atomic_load_n(&client[i].done, __ATOMIC_ACQUIRE) && client[i].opened &&
+               HostNanoTime() - drainStart < 1000000000ULL)
+            sched_yield();
+    }
+    drainTimeout = TRUE;
+    for (ULONG i = 0; i < clients; i++)
+    {
+        if (client[i].opened)
+            Signal(client[i].task, SIGBREAKF_CTRL_C);
+    }
+    for (ULONG i = 0; i < clients; i++)
+        pthread_join(client[i].thread, NULL);
+    wireStop = TRUE;
+    pthread_join(wire, NULL);
+
+    struct GenetSimStats simStats;
+    struct HostExecStats execStats;
+    genet_sim_get_stats(sim, &simStats);
+    HostGetExecStats(&execStats);
+    struct GenetUnit *unit = control.unit;
+
+    uint64_t rx = 0, tx = 0, txErrors = 0;
+    ULONG txStalled = 0;
+    for (ULONG i = 0; i < clients; i++)
+    {
+        printf("client %2lu: rx %8llu  tx %8llu  tx errors %llu  never replied %lu\n", (unsigned long)i,
+               (unsigned long long)client[i].rx, (unsigned long long)client[i].tx,
+               (unsigned long long)client[i].txErrors, (unsigned long)client[i].txStalled);
+        rx += client[i].rx;
+        tx += client[i].tx;
+        txErrors += client[i].txErrors;
+        txStalled += client[i].txStalled;
+    }
+    printf("%lu clients, %.2fs: rx %.0f pkt/s per client, tx %.0f pkt/s total, %llu tx errors\n",
+           (unsigned long)clients, elapsed, rx / elapsed / clients, tx / elapsed, (unsigned long long)txErrors);
+    if (txStalled)
+        printf("WARNING: %lu writes were never replied (TX completion lost)\n", (unsigned long)txStalled);
+    printf("wire: injected %llu, no descriptor %llu, rx discards %llu, tx frames %llu\n",
+           (unsigned long long)wireInjected, (unsigned long long)wireDropped,
+           (unsigned long long)simStats.rx_discards, (unsigned long long)simStats.tx_frames);
+    printf("exec: signals %llu, waits %llu (%llu blocked), messages put %llu replied %llu, interrupts %llu\n",
+           (unsigned long long)execStats.signals, (unsigned long long)execStats.waits,
+           (unsigned long long)execStats.waits_blocked, (unsigned long long)execStats.messages_put,
+           (unsigned long long)execStats.messages_replied, (unsigned long long)execStats.interrupts);
+    printf("semaphores: %llu obtains, %llu contended, %llu attempts, %llu attempts failed\n",
+           (unsigned long long)execStats.semaphore_obtains, (unsigned long long)execStats.semaphore_contended,
+           (unsigned long long)execStats.semaphore_attempts, (unsigned long long)execStats.semaphore_attempts_failed);
+    printf("driver: rx_packets=%lu tx_packets=%lu tx_dropped=%lu\n",
+           (unsigned long)unit->internalStats.rx_packets, (unsigned long)unit->internalStats.tx_packets,
+           (unsigned long)unit->internalStats.tx_dropped);
+    PrintLatency(&control, base, controlIo->ios2_BufferManagement);
+    SaveTrace(&control, base, controlIo->ios2_BufferManagement);
+
+    harness_close(&control, base, controlIo);
+    DeleteMsgPort(control.replyPort);
+    harness_device_free(base);
+    genet_sim_destroy(sim);
+    return txStalled ? 2 : 0;
+}
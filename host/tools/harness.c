@@ -0,0 +1,335 @@
+// SPDX-License-Identifier: MPL-2.0 OR GPL-2.0+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <proto/exec.h>
+#include <proto/utility.h>
+
+#include <compat.h>
+#include <minlist.h>
+#include <device.h>
+#include <runtime_config.h>
+#include <genet/bcmgenet.h>
+#include <genet/bcmgenet-irq.h>
+#include <genet/bcmgenet-regs.h>
+
+#include "harness.h"
+
+/* device.c */
+struct Opener *createOpener(struct TagItem *tags);
+
+static BOOL CopyBuffer(APTR to, APTR from, ULONG len)
+{
+    memcpy(to, from, len);
+    return TRUE;
+}
+
+BOOL harness_init(struct Harness *harness, const struct GenetSimConfig *config)
+{
+    memset(harness, 0, sizeof(*harness));
+
+    harness->sim = genet_sim_create(config);
+    if (!harness->sim)
+        return FALSE;
+
+    LoadGenetRuntimeConfig();
+
+    struct GenetUnit *unit = AllocMem(sizeof(struct GenetUnit), MEMF_PUBLIC | MEMF_CLEAR);
+    harness->unit = unit;
+    harness->replyPort = CreateMsgPort();
+
+    unit->unit.unit_OpenCnt = 1;
+    unit->memoryPool = CreatePool(MEMF_FAST | MEMF_PUBLIC, 16384, 8192);
+    _NewMinList(&unit->multicastRanges);
+    _NewMinList(&unit->openers);
+    _NewMinList((struct MinList *)&unit->unit.unit_MsgPort.mp_MsgList);
+    unit->unit.unit_MsgPort.mp_SigTask = FindTask(NULL);
+    unit->unit.unit_MsgPort.mp_SigBit = AllocSignal(-1);
+    unit->unit.unit_MsgPort.mp_Flags = PA_SIGNAL;
+    unit->task = FindTask(NULL);
+    unit->irq0_signal = AllocSignal(-1);
+    InitSemaphore(&unit->tx_ring.tx_ring_sem);
+
+    if (DevTreeParse(unit) != S2ERR_NO_ERROR)
+        return FALSE;
+
+    struct IOSana2Req *io = harness_io(harness, NULL, S2_CONFIGINTERFACE, 0, NULL, 0);
+    memcpy(io->ios2_SrcAddr, unit->localMacAddress, 6);
+    ProcessCommand(io);
+    harness_collect_replies(harness, NULL);
+    BYTE error = io->ios2_Req.io_Error;
+    harness_free_io(io);
+
+    return error == 0 && unit->state == STATE_ONLINE;
+}
+
+void harness_cleanup(struct Harness *harness)
+{
+    struct GenetUnit *unit = harness->unit;
+
+    if (unit)
+    {
+        if (unit->state == STATE_ONLINE)
+            UnitOffline(unit);
+        harness_remove_openers(harness);
+        DeletePool(unit->memoryPool);
+        FreeMem(unit, sizeof(struct GenetUnit));
+    }
+    if (harness->replyPort)
+        DeleteMsgPort(harness->replyPort);
+    genet_sim_destroy(harness->sim);
+    memset(harness, 0, sizeof(*harness));
+}
+
+struct Opener *harness_add_opener(struct Harness *harness, struct Hook *filter)
+{
+    struct TagItem tags[] = {
+        {S2_CopyToBuff, (ULONG)CopyBuffer},
+        {S2_CopyFromBuff, (ULONG)CopyBuffer},
+        {S2_PacketFilter, (ULONG)filter},
+        {TAG_DONE, 0}};
+
+    struct Opener *opener = createOpener(tags);
+    if (opener)
+        AddTailMinList(&harness->unit->openers, (struct MinNode *)opener);
+    return opener;
+}
+
+struct Opener *harness_add_dma_opener(struct Harness *harness, APTR (*dmaCopyToBuff)(APTR), APTR (*dmaCopyFromBuff)(APTR))
+{
+    struct TagItem tags[] = {
+        {S2_CopyToBuff, (ULONG)CopyBuffer},
+        {S2_CopyFromBuff, (ULONG)CopyBuffer},
+        {S2_DMACopyToBuff32, (ULONG)dmaCopyToBuff},
+        {S2_DMACopyFromBuff32, (ULONG)dmaCopyFromBuff},
+        {TAG_DONE, 0}};
+
+    /* createOpener() only takes the DMA hooks when use_dma is set */
+    BOOL useDma = genetConfig.use_dma;
+    genetConfig.use_dma = TRUE;
+    struct Opener *opener = createOpener(tags);
+    genetConfig.use_dma = useDma;
+
+    if (opener)
+        AddTailMinList(&harness->unit->openers, (struct MinNode *)opener);
+    return opener;
+}
+
+struct Opener *harness_add_gather_opener(struct Harness *harness,
+                                         ULONG (*dmaGatherFromBuff)(APTR, struct GenetFragment *, ULONG))
+{
+    struct TagItem tags[] = {
+        {S2_CopyToBuff, (ULONG)CopyBuffer},
+        {S2_CopyFromBuff, (ULONG)CopyBuffer},
+        {GENET_DMAGatherFromBuff, (ULONG)dmaGatherFromBuff},
+        {TAG_DONE, 0}};
+
+    BOOL useDma = genetConfig.use_dma;
+    genetConfig.use_dma = TRUE;
+    struct Opener *opener = createOpener(tags);
+    genetConfig.use_dma = useDma;
+
+    if (opener)
+        AddTailMinList(&harness->unit->openers, (struct MinNode *)opener);
+    return opener;
+}
+
+void harness_remove_openers(struct Harness *harness)
+{
+    struct GenetUnit *unit = harness->unit;
+
+    while (unit->openers.mlh_Head->mln_Succ)
+    {
+        struct Opener *opener = (struct Opener *)RemHeadMinList(&unit->openers);
+        FreeMem(opener, sizeof(struct Opener));
+    }
+}
+
+struct IOSana2Req *harness_io(struct Harness *harness, struct Opener *opener, UWORD command,
+                              ULONG packetType, APTR data, ULONG length)
+{
+    struct IOSana2Req *io = AllocMem(sizeof(struct IOSana2Req), MEMF_PUBLIC | MEMF_CLEAR);
+
+    io->ios2_Req.io_Message.mn_Node.ln_Type = NT_REPLYMSG;
+    io->ios2_Req.io_Message.mn_ReplyPort = harness->replyPort;
+    io->ios2_Req.io_Message.mn_Length = sizeof(struct IOSana2Req);
+    io->ios2_Req.io_Unit = (struct Unit *)harness->unit;
+    io->ios2_Req.io_Command = command;
+    io->ios2_BufferManagement = opener;
+    io->ios2_PacketType = packetType;
+    io->ios2_Data = data;
+    io->ios2_DataLength = length;
+    return io;
+}
+
+void harness_free_io(struct IOSana2Req *io)
+{
+    FreeMem(io, sizeof(struct IOSana2Req));
+}
+
+ULONG harness_collect_replies(struct Harness *harness, ULONG *errors)
+{
+    ULONG count = 0;
+    struct IOSana2Req *io;
+
+    while ((io = (struct IOSana2Req *)GetMsg(harness->replyPort)))
+    {
+        count++;
+        if (errors && io->ios2_Req.io_Error)
+            (*errors)++;
+    }
+    return count;
+}
+
+BOOL harness_arg(int argc, char **argv, int index, ULONG fallback, ULONG min, ULONG *value)
+{
+    if (index >= argc)
+    {
+        *value = fallback;
+        return TRUE;
+    }
+
+    /* strtoul() takes "", "--help" as 0 and "-1" as ULONG_MAX */
+    const char *arg = argv[index];
+    if (*arg < '0' || *arg > '9')
+        return FALSE;
+
+    char *end;
+    errno = 0;
+    unsigned long parsed = strtoul(arg, &end, 0);
+    if (*end != '\0' || errno != 0 || parsed > 0xffffffffUL || parsed < min)
+        return FALSE;
+
+    *value = parsed;
+    return TRUE;
+}
+
+ULONG harness_frame(UBYTE *frame, const UBYTE *dst, const UBYTE *src, UWORD type, ULONG payload)
+{
+    memcpy(&frame[0], dst, 6);
+    memcpy(&frame[6], src, 6);
+    *(UWORD *)&frame[12] = type;
+    for (ULONG i = 0; i < payload; i++)
+        frame[ETH_HLEN + i] = i;
+    return ETH_HLEN + payload;
+}
+
+void harness_bottom_half(struct Harness *harness)
+{
+    struct GenetUnit *unit = harness->unit;
+
+    if (!(SetSignal(0, 1UL << unit->irq0_signal) & (1UL << unit->irq0_signal)))
+        return;
+
+    ULONG status = unit->irq0_status;
+    ULONG status1 = unit->irq1_status;
+    unit->irq0_status = 0;
+    unit->irq1_status = 0;
+
+    if ((status & UMAC_IRQ_TXDMA_DONE || status1 & UMAC_IRQ1_TX_PRIO) && unit->state == STATE_ONLINE)
+    {
+        bcmgenet_tx_reclaim(unit, TX_DESCS);
+        bcmgenet_tx_backlog_drain(unit);
+        if (status & UMAC_IRQ_TXDMA_DONE)
+            bcmgenet_irq0_enable(unit, UMAC_IRQ_TXDMA_DONE);
+        if (status1 & UMAC_IRQ1_TX_PRIO)
+            bcmgenet_irq1_enable(unit, UMAC_IRQ1_TX_PRIO);
+    }
+
+    if ((status1 & UMAC_IRQ1_RX_PRIO) && unit->state == STATE_ONLINE)
+    {
+        UWORD budget = genetConfig.budget;
+        if (bcmgenet_gmac_eth_rx(unit, &unit->rx_prio_ring, budget) == budget)
+        {
+            unit->irq1_status |= UMAC_IRQ1_RX_PRIO;
+            Signal(unit->task, 1UL << unit->irq0_signal);
+        }
+        else
+        {
+            bcmgenet_irq1_enable(unit, UMAC_IRQ1_RX_PRIO);
+        }
+    }
+
+    if ((status & UMAC_IRQ_RXDMA_DONE) && unit->state == STATE_ONLINE)
+    {
+        UWORD budget = genetConfig.budget;
+        int res = bcmgenet_gmac_eth_rx(unit, &unit->rx_ring, budget);
+        if (res > 0)
+            budget -= res;
+        if (budget == 0)
+        {
+            if (genetConfig.rx_adaptive_coalesce)
+                bcmgenet_rx_moderate_backlog(unit);
+            unit->irq0_status |= UMAC_IRQ_RXDMA_DONE;
+            Signal(unit->task, 1UL << unit->irq0_signal);
+        }
+        else
+        {
+            bcmgenet_irq0_enable(unit, UMAC_IRQ_RXDMA_DONE);
+        }
+    }
+
+    if (genetConfig.tx_lazy_reclaim && unit->state == STATE_ONLINE)
+        bcmgenet_tx_reclaim_lazy(unit);
+}
+
+struct GenetDevice *harness_device_init(void)
+{
+    struct GenetDevice *base = AllocMem(sizeof(struct GenetDevice), MEMF_PUBLIC | MEMF_CLEAR);
+    if (base && initFunction(base, 0, SysBase) == NULL)
+    {
+        FreeMem(base, sizeof(struct GenetDevice));
+        return NULL;
+    }
+    return base;
+}
+
+void harness_device_free(struct GenetDevice *base)
+{
+    if (base)
+        FreeMem(base, sizeof(struct GenetDevice));
+}
+
+struct IOSana2Req *harness_open(struct Harness *harness, struct GenetDevice *base, struct Hook *filter)
+{
+    struct TagItem tags[] = {
+        {S2_CopyToBuff, (ULONG)CopyBuffer},
+        {S2_CopyFromBuff, (ULONG)CopyBuffer},
+        {S2_PacketFilter, (ULONG)filter},
+        {TAG_DONE, 0}};
+
+    struct IOSana2Req *io = harness_io(harness, NULL, 0, 0, NULL, 0);
+    io->ios2_Req.io_Unit = NULL;
+    io->ios2_BufferManagement = tags;
+
+    /* exec calls the open vector under Forbid() */
+    Forbid();
+    openLib(io, 0, 0, base);
+    Permit();
+
+    if (io->ios2_Req.io_Error)
+    {
+        harness_free_io(io);
+        return NULL;
+    }
+    harness->unit = (struct GenetUnit *)io->ios2_Req.io_Unit;
+    return io;
+}
+
+void harness_close(struct Harness *harness, struct GenetDevice *base, struct IOSana2Req *openIo)
+{
+    Forbid();
+    closeLib(openIo, base);
+    Permit();
+    harness_free_io(openIo);
+    harness->unit = NULL;
+}
+
+BYTE harness_do_io(struct GenetDevice *base, struct IOSana2Req *io)
+{
+    io->ios2_Req.io_Flags = IOF_QUICK;
+    beginIO(io, base);
+    return WaitIO((struct IORequest *)io);
+}
@@ -0,0 +1,80 @@
+// SPDX-License-Identifier: MPL-2.0 OR GPL-2.0+
+/*
+ * Common setup of the host tools: a unit bound to the simulated GENET,
+ * openers with host copy hooks and SANA-II requests.
+ *
+ * Frames are built with the ethertype stored as a native UWORD, the way the
+ * driver reads and writes it, so the IPv4/ARP fast paths behave as on the
+ * big endian target.
+ */
+#ifndef HOST_HARNESS_H
+#define HOST_HARNESS_H
+
+#include <exec/types.h>
+#include <devices/sana2.h>
+
+#include <device.h>
+#include <genet_sim.h>
+
+/* device.c, device_beginio.c, device_abortio.c */
+APTR initFunction(struct GenetDevice *base, ULONG segList, struct ExecBase *_SysBase);
+void openLib(struct IOSana2Req *io, LONG unitNumber, ULONG flags, struct GenetDevice *base);
+ULONG closeLib(struct IOSana2Req *io, struct GenetDevice *base);
+void beginIO(struct IOSana2Req *io, struct GenetDevice *base);
+LONG abortIO(struct IOSana2Req *io, struct GenetDevice *base);
+
+struct Harness
+{
+    struct GenetSim *sim;
+    struct GenetUnit *unit;
+    struct MsgPort *replyPort;
+};
+
+/* Simulator, unit configured and online with the sim's MAC address */
+BOOL harness_init(struct Harness *harness, const struct GenetSimConfig *config);
+void harness_cleanup(struct Harness *harness);
+
+/* Opener with memcpy based copy hooks; filter may be NULL */
+struct Opener *harness_add_opener(struct Harness *harness, struct Hook *filter);
+/* Opener that also hands out S2_DMACopyToBuff32/S2_DMACopyFromBuff32, either may be NULL */
+struct Opener *harness_add_dma_opener(struct Harness *harness, APTR (*dmaCopyToBuff)(APTR), APTR (*dmaCopyFromBuff)(APTR));
+/* Opener that hands out GENET_DMAGatherFromBuff */
+struct Opener *harness_add_gather_opener(struct Harness *harness,
+                                         ULONG (*dmaGatherFromBuff)(APTR, struct GenetFragment *, ULONG));
+/* Drop all openers added with harness_add_opener(), pending requests included */
+void harness_remove_openers(struct Harness *harness);
+
+struct IOSana2Req *harness_io(struct Harness *harness, struct Opener *opener, UWORD command,
+                              ULONG packetType, APTR data, ULONG length);
+void harness_free_io(struct IOSana2Req *io);
+
+/* Replies collected on the harness reply port since the last call */
+ULONG harness_collect_replies(struct Harness *harness, ULONG *errors);
+
+/*
+ * Numeric argument argv[index] of a tool, decimal or 0x hex, fallback when
+ * it is not given. FALSE when it does not parse or is below min.
+ */
+BOOL harness_arg(int argc, char **argv, int index, ULONG fallback, ULONG min, ULONG *value);
+
+/* Build an Ethernet frame, returns its length */
+ULONG harness_frame(UBYTE *frame, const UBYTE *dst, const UBYTE *src, UWORD type, ULONG payload);
+
+/* The unit task's IRQ0 bottom half, for single task use */
+void harness_bottom_half(struct Harness *harness);
+
+/*
+ * Device level use, with the unit task running: a device base set up by
+ * initFunction(), and openers that go through openLib()/closeLib() the way
+ * OpenDevice()/CloseDevice() would call them. harness->sim must be set,
+ * harness->replyPort belongs to the calling task.
+ */
+struct GenetDevice *harness_device_init(void);
+void harness_device_free(struct GenetDevice *base);
+struct IOSana2Req *harness_open(struct Harness *harness, struct GenetDevice *base, struct Hook *filter);
+void harness_close(struct Harness *harness, struct GenetDevice *base, struct IOSana2Req *openIo);
+
+/* beginIO() and wait for the reply, like DoIO() on the device */
+BYTE harness_do_io(struct GenetDevice *base, struct IOSana2Req *io);
+
+#endif /* HOST_HARNESS_H */
@@ -0,0 +1,344 @@
+// SPDX-License-Identifier: MPL-2.0 OR GPL-2.0+
+/*
+ * genet-rx-bench: cost of ReceiveFrame() and CopyPacket() per received frame.
+ *
+ * The RX ring is left out: frames are handed to ReceiveFrame() directly,
+ * with a read request queued for every frame and opener beforehand, so only
+ * the dispatch (opener walk, ring or queue lookup, semaphores, filter hook, copy and
+ * reply) is timed. Requests are queued the way Do_CMD_READ() and
+ * Do_S2_READORPHAN() queue them, outside of the timed loop.
+ *
+ * Usage: genet-rx-bench [frames] [payload]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <proto/exec.h>
+
+#include <host_exec.h>
+#include <minlist.h>
+#include <runtime_config.h>
+
+#include "harness.h"
+
+#define MAX_FRAME 1536
+#define MAX_OPENERS 16
+#define BATCH 256
+/* Requests for other types queued ahead in readQueue by the "walk" mix */
+#define WALK_DEPTH 8
+/* Each row is the best of this many runs, the host scheduler adds noise */
+#define REPEATS 5
+
+/* Frame kinds, each ends up on a different path through ReceiveFrame() */
+enum
+{
+    KIND_IPV4,     /* ipv4Ring fast path */
+    KIND_ARP,      /* arpRing fast path */
+    KIND_OTHER,    /* readQueue fallback */
+    KIND_ORPHAN,   /* nobody reads the type, orphanQueue */
+    KIND_COUNT
+};
+
+static const UWORD kindType[KIND_COUNT] = {0x0800, 0x0806, 0x86dd, 0x88cc};
+#define DECOY_TYPE 0x8863
+
+enum
+{
+    MIX_IPV4,
+    MIX_ARP,
+    MIX_OTHER,
+    MIX_OTHER_WALK,
+    MIX_ORPHAN,
+    MIX_STACK,
+    MIX_COUNT
+};
+
+static const char *mixName[MIX_COUNT] = {"ipv4", "arp", "fallback", "fallback-walk", "orphan", "stack"};
+
+enum
+{
+    VARIANT_COOKED,
+    VARIANT_RAW,
+    VARIANT_MIAMI,
+    VARIANT_FILTER_ACCEPT,
+    VARIANT_FILTER_REJECT,
+    VARIANT_COUNT
+};
+
+static const char *variantName[VARIANT_COUNT] = {"cooked", "raw", "miami", "filter-accept", "filter-reject"};
+
+static const UBYTE peerAddress[6] = {0x02, 0x00, 0x00, 0x00, 0x00, 0x02};
+static const ULONG openerCounts[] = {1, 2, 4, 8, 16};
+
+struct Bench
+{
+    struct Harness harness;
+    struct Opener *openers[MAX_OPENERS];
+    struct IOSana2Req *ios[MAX_OPENERS][BATCH + WALK_DEPTH];
+    UBYTE *sink[MAX_OPENERS];
+    UBYTE *frames[KIND_COUNT];
+    ULONG frameLength;
+    UBYTE kinds[BATCH];
+};
+
+struct Result
+{
+    double nsPerPacket;
+    double deliveries;
+    double semaphores;
+};
+
+static ULONG FilterAccept(struct Hook *hook, struct IOSana2Req *io, APTR packet)
+{
+    return TRUE;
+}
+
+static ULONG FilterReject(struct Hook *hook, struct IOSana2Req *io, APTR packet)
+{
+    return FALSE;
+}
+
+static struct Hook acceptHook = {.h_Entry = (ULONG(*)())FilterAccept};
+static struct Hook rejectHook = {.h_Entry = (ULONG(*)())FilterReject};
+
+/* Typical stack traffic: 70% IPv4, 20% ARP, 5% other, 5% orphans */
+static UBYTE StackKind(ULONG i)
+{
+    ULONG slot = i % 20;
+    if (slot < 14)
+        return KIND_IPV4;
+    if (slot < 18)
+        return KIND_ARP;
+    return slot == 18 ? KIND_OTHER : KIND_ORPHAN;
+}
+
+static void SetupMix(struct Bench *bench, int mix)
+{
+    for (ULONG i = 0; i < BATCH; i++)
+    {
+        switch (mix)
+        {
+        case MIX_IPV4:
+            bench->kinds[i] = KIND_IPV4;
+            break;
+        case MIX_ARP:
+            bench->kinds[i] = KIND_ARP;
+            break;
+        case MIX_OTHER:
+        case MIX_OTHER_WALK:
+            bench->kinds[i] = KIND_OTHER;
+            break;
+        case MIX_ORPHAN:
+            bench->kinds[i] = KIND_ORPHAN;
+            break;
+        default:
+            bench->kinds[i] = StackKind(i);
+            break;
+        }
+    }
+}
+
+/* Into the type's read ring if it has one, into queue otherwise */
+static void QueueRead(struct IOSana2Req *io, struct Opener *opener, struct MinList *queue, UWORD command, UWORD type,
+                      BOOL raw)
+{
+    io->ios2_BufferManagement = opener;
+    io->ios2_Req.io_Message.mn_Node.ln_Type = NT_MESSAGE;
+    io->ios2_Req.io_Command = command;
+    io->ios2_Req.io_Flags = raw ? SANA2IOF_RAW : 0;
+    io->ios2_Req.io_Error = 0;
+    io->ios2_PacketType = type;
+    io->ios2_DataLength = MAX_FRAME;
+
+    struct ReadRing *ring = command == CMD_READ ? GetPacketTypeRing(opener, type) : NULL;
+    if (ring)
+        ReadRingPut(ring, io);
+    else
+        AddTailMinList(queue, (struct MinNode *)io);
+}
+
+/* Requeue one read per frame and opener; whatever is left from the last batch is dropped */
+static void QueueBatch(struct Bench *bench, ULONG openers, int mix, BOOL raw)
+{
+    for (ULONG o = 0; o < openers; o++)
+    {
+        struct Opener *opener = bench->openers[o];
+        struct IOSana2Req **ios = bench->ios[o];
+
+        _NewMinList(&opener->readQueue);
+        _NewMinList(&opener->orphanQueue);
+        ReadRingInit(&opener->ipv4Ring);
+        ReadRingInit(&opener->arpRing);
+
+        if (mix == MIX_OTHER_WALK)
+        {
+            for (ULONG i = 0; i < WALK_DEPTH; i++)
+                QueueRead(ios[BATCH + i], opener, &opener->readQueue, CMD_READ, DECOY_TYPE, raw);
+        }
+
+        for (ULONG i = 0; i < BATCH; i++)
+        {
+            UBYTE kind = bench->kinds[i];
+            if (kind == KIND_ORPHAN)
+                QueueRead(ios[i], opener, &opener->orphanQueue, S2_READORPHAN, 0, raw);
+            else
+                QueueRead(ios[i], opener, &opener->readQueue, CMD_READ, kindType[kind], raw);
+        }
+    }
+}
+
+static struct Result Run(struct Bench *bench, ULONG openers, int mix, int variant, ULONG frames)
+{
+    struct Harness *harness = &bench->harness;
+    struct Hook *filter = NULL;
+    BOOL raw = variant == VARIANT_RAW;
+
+    if (variant == VARIANT_FILTER_ACCEPT)
+        filter = &acceptHook;
+    else if (variant == VARIANT_FILTER_REJECT)
+        filter = &rejectHook;
+    genetConfig.use_miami_workaround = variant == VARIANT_MIAMI;
+
+    harness_remove_openers(harness);
+    for (ULONG o = 0; o < openers; o++)
+        bench->openers[o] = harness_add_opener(harness, filter);
+    SetupMix(bench, mix);
+
+    /* Warm up caches and branch predictors */
+    QueueBatch(bench, openers, mix, raw);
+    for (ULONG i = 0; i < BATCH; i++)
+        ReceiveFrame(harness->unit, bench->frames[bench->kinds[i]], bench->frameLength, 0);
+    harness_collect_replies(harness, NULL);
+
+    HostResetExecStats();
+    uint64_t elapsed = 0;
+    ULONG received = 0;
+    ULONG delivered = 0;
+
+    while (received < frames)
+    {
+        QueueBatch(bench, openers, mix, raw);
+
+        uint64_t start = HostNanoTime();
+        for (ULONG i = 0; i < BATCH; i++)
+            ReceiveFrame(harness->unit, bench->frames[bench->kinds[i]], bench->frameLength, 0);
+        elapsed += HostNanoTime() - start;
+
+        received += BATCH;
+        delivered += harness_collect_replies(harness, NULL);
+    }
+
+    struct HostExecStats execStats;
+    HostGetExecStats(&execStats);
+
+    struct Result result = {
+        .nsPerPacket = (double)elapsed / received,
+        .deliveries = (double)delivered / received,
+        .semaphores = (double)execStats.semaphore_obtains / received,
+    };
+    return result;
+}
+
+static struct Result BestOf(struct Bench *bench, ULONG openers, int mix, int variant, ULONG frames)
+{
+    struct Result best = Run(bench, openers, mix, variant, frames);
+    for (int i = 1; i < REPEATS; i++)
+    {
+        struct Result result = Run(bench, openers, mix, variant, frames);
+        if (result.nsPerPacket < best.nsPerPacket)
+            best = result;
+    }
+    return best;
+}
+
+static void PrintHeader(const char *what)
+{
+    printf("%-8s %-14s %12s %10s %10s %8s\n", "openers", what, "pps", "ns/pkt", "replies", "sem");
+}
+
+static void PrintResult(ULONG openers, const char *name, const struct Result *result)
+{
+    printf("%-8lu %-14s %12.0f %10.1f %10.2f %8.2f\n", (unsigned long)openers, name,
+           1e9 / result->nsPerPacket, result->nsPerPacket, result->deliveries, result->semaphores);
+}
+
+int main(int argc, char **argv)
+{
+    ULONG frames, payload;
+    if (argc > 3 || !harness_arg(argc, argv, 1, 50000, 1, &frames) || !harness_arg(argc, argv, 2, 512, 0, &payload))
+    {
+        fprintf(stderr, "usage: genet-rx-bench [frames] [payload]\n");
+        return 1;
+    }
+    if (payload > ETH_DATA_LEN)
+        payload = ETH_DATA_LEN;
+    if (payload < 46)
+        payload = 46;
+
+    static struct Bench bench;
+    struct GenetSimConfig config = {.link_mbps = 1000};
+    if (!harness_init(&bench.harness, &config))
+    {
+        fprintf(stderr, "genet-rx-bench: unit failed to come online\n");
+        return 1;
+    }
+
+    const UBYTE *localAddress = genet_sim_mac_address(bench.harness.sim);
+    for (int kind = 0; kind < KIND_COUNT; kind++)
+    {
+        bench.frames[kind] = AllocMem(MAX_FRAME, MEMF_PUBLIC | MEMF_CLEAR);
+        bench.frameLength = harness_frame(bench.frames[kind], localAddress, peerAddress, kindType[kind], payload);
+    }
+    for (ULONG o = 0; o < MAX_OPENERS; o++)
+    {
+        bench.sink[o] = AllocMem(MAX_FRAME, MEMF_PUBLIC | MEMF_CLEAR);
+        for (ULONG i = 0; i < BATCH + WALK_DEPTH; i++)
+            bench.ios[o][i] = harness_io(&bench.harness, NULL, CMD_READ, 0, bench.sink[o], MAX_FRAME);
+    }
+
+    printf("genet-rx-bench: %lu frames of %lu bytes, best of %d runs; replies and semaphore obtains per frame\n\n",
+           (unsigned long)frames, (unsigned long)bench.frameLength, REPEATS);
+
+    /* Packet type mix against opener count, cooked reads */
+    PrintHeader("mix");
+    for (ULONG c = 0; c < sizeof(openerCounts) / sizeof(openerCounts[0]); c++)
+    {
+        for (int mix = 0; mix < MIX_COUNT; mix++)
+        {
+            ULONG openers = openerCounts[c];
+            struct Result result = BestOf(&bench, openers, mix, VARIANT_COOKED, frames);
+            PrintResult(openers, mixName[mix], &result);
+        }
+    }
+
+    /* Read flags, Miami workaround and filter hooks on the IPv4 fast path */
+    printf("\n");
+    PrintHeader("ipv4 variant");
+    for (ULONG c = 0; c < sizeof(openerCounts) / sizeof(openerCounts[0]); c++)
+    {
+        for (int variant = 0; variant < VARIANT_COUNT; variant++)
+        {
+            ULONG openers = openerCounts[c];
+            struct Result result = BestOf(&bench, openers, MIX_IPV4, variant, frames);
+            PrintResult(openers, variantName[variant], &result);
+        }
+    }
+
+    struct GenetUnit *unit = bench.harness.unit;
+    printf("\ndriver: rx_packets=%lu rx_dropped=%lu rx_arp_ip_dropped=%lu\n",
+           (unsigned long)unit->internalStats.rx_packets, (unsigned long)unit->internalStats.rx_dropped,
+           (unsigned long)unit->internalStats.rx_arp_ip_dropped);
+
+    for (ULONG o = 0; o < MAX_OPENERS; o++)
+    {
+        for (ULONG i = 0; i < BATCH + WALK_DEPTH; i++)
+            harness_free_io(bench.ios[o][i]);
+        FreeMem(bench.sink[o], MAX_FRAME);
+    }
+    for (int kind = 0; kind < KIND_COUNT; kind++)
+        FreeMem(bench.frames[kind], MAX_FRAME);
+    harness_cleanup(&bench.harness);
+
+    return 0;
+}
@@ -0,0 +1,152 @@
+// SPDX-License-Identifier: MPL-2.0 OR GPL-2.0+
+/*
+ * genet-trace: print a GENETCMD_GETTRACE buffer saved to a file, from the
+ * Amiga (big endian) or from genet-load with GENET_HOST_TRACE set. Times are
+ * those of the 1MHz system timer, relative to the first entry shown.
+ *
+ * Entries that were written while the driver copied them, or overwritten
+ * before, do not carry their sequence; they are counted and left out.
+ *
+ * Usage: genet-trace [file]   (standard input without one)
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <exec/types.h>
+#include <devices/genet.h>
+
+enum
+{
+    ARG_NONE,
+    ARG_DEC,
+    ARG_HEX
+};
+
+struct TraceEvent
+{
+    const char *name;
+    const char *arg0;
+    UBYTE format0;
+    const char *arg1;
+    UBYTE format1;
+};
+
+static const struct TraceEvent traceEvents[GENET_TRACE_EVENTS] = {
+    [GENET_TRACE_IRQ0] = {"irq0", "status", ARG_HEX, NULL, ARG_NONE},
+    [GENET_TRACE_IRQ1] = {"irq1", "status", ARG_HEX, NULL, ARG_NONE},
+    [GENET_TRACE_BOTTOM_HALF] = {"bottom-half", "irq0", ARG_HEX, "irq1", ARG_HEX},
+    [GENET_TRACE_RX_RING] = {"rx-ring", "ring", ARG_DEC, "frames", ARG_DEC},
+    [GENET_TRACE_RX_FRAME] = {"rx-frame", "length", ARG_DEC, "type", ARG_HEX},
+    [GENET_TRACE_RX_ERROR] = {"rx-error", "status", ARG_HEX, "length", ARG_DEC},
+    [GENET_TRACE_RX_ORPHAN] = {"rx-orphan", "type", ARG_HEX, "taken", ARG_DEC},
+    [GENET_TRACE_TX_WRITE] = {"tx-write", "length", ARG_DEC, "ring", ARG_DEC},
+    [GENET_TRACE_TX_BACKLOG] = {"tx-backlog", "writes", ARG_DEC, "full", ARG_DEC},
+    [GENET_TRACE_TX_RECLAIM] = {"tx-reclaim", "ring", ARG_DEC, "writes", ARG_DEC},
+    [GENET_TRACE_TX_SHAPE] = {"tx-shape", "ring", ARG_DEC, "usecs", ARG_DEC},
+    [GENET_TRACE_COALESCE] = {"coalesce", "usecs", ARG_DEC, "frames", ARG_DEC},
+    [GENET_TRACE_POLL] = {"poll", "on", ARG_DEC, "pps", ARG_DEC},
+    [GENET_TRACE_COMMAND] = {"command", "cmd", ARG_HEX, "io", ARG_HEX},
+    [GENET_TRACE_EVENT] = {"event", "events", ARG_HEX, NULL, ARG_NONE},
+    [GENET_TRACE_HFB] = {"hfb", "type", ARG_HEX, "discard", ARG_DEC},
+};
+
+static ULONG Swap(ULONG value)
+{
+    return __builtin_bswap32(value);
+}
+
+static void PrintArg(const char *name, UBYTE format, ULONG value)
+{
+    if (format == ARG_DEC)
+        printf(" %s=%lu", name, (unsigned long)value);
+    else if (format == ARG_HEX)
+        printf(" %s=0x%lx", name, (unsigned long)value);
+}
+
+int main(int argc, char **argv)
+{
+    FILE *file = argc > 1 ? fopen(argv[1], "rb") : stdin;
+    if (file == NULL)
+    {
+        fprintf(stderr, "genet-trace: cannot open %s\n", argv[1]);
+        return 1;
+    }
+
+    struct GenetTrace header;
+    if (fread(&header, sizeof(header), 1, file) != 1)
+    {
+        fprintf(stderr, "genet-trace: no trace header\n");
+        return 1;
+    }
+
+    /* The header and every entry are ULONGs, swapped all alike */
+    BOOL swap = header.gt_Magic != GENET_TRACE_MAGIC;
+    if (swap)
+    {
+        ULONG *words = (ULONG *)&header;
+        for (ULONG i = 0; i < sizeof(header) / sizeof(ULONG); i++)
+            words[i] = Swap(words[i]);
+    }
+    if (header.gt_Magic != GENET_TRACE_MAGIC)
+    {
+        fprintf(stderr, "genet-trace: not a GENETCMD_GETTRACE buffer\n");
+        return 1;
+    }
+
+    printf("genet-trace: %s endian, mask 0x%08lx, %lu of %lu events\n", swap ? "big" : "little",
+           (unsigned long)header.gt_Mask, (unsigned long)header.gt_Count, (unsigned long)header.gt_Next);
+
+    ULONG first = header.gt_Next - header.gt_Count;
+    ULONG shown = 0, dropped = 0;
+    ULONG start = 0, last = 0;
+    for (ULONG i = 0; i < header.gt_Count; i++)
+    {
+        struct GenetTraceEntry entry;
+        if (fread(&entry, sizeof(entry), 1, file) != 1)
+        {
+            fprintf(stderr, "genet-trace: trace ends after %lu of %lu entries\n", (unsigned long)i,
+                    (unsigned long)header.gt_Count);
+            break;
+        }
+        if (swap)
+        {
+            ULONG *words = (ULONG *)&entry;
+            for (ULONG w = 0; w < sizeof(entry) / sizeof(ULONG); w++)
+                words[w] = Swap(words[w]);
+        }
+
+        if (entry.gte_Sequence != first + i)
+        {
+            dropped++;
+            continue;
+        }
+        if (shown++ == 0)
+            start = last = entry.gte_Time;
+
+        printf("%10lu %10lu %+8ld ", (unsigned long)entry.gte_Sequence, (unsigned long)(entry.gte_Time - start),
+               (long)(LONG)(entry.gte_Time - last));
+        last = entry.gte_Time;
+
+        if (entry.gte_Event < GENET_TRACE_EVENTS && traceEvents[entry.gte_Event].name)
+        {
+            const struct TraceEvent *event = &traceEvents[entry.gte_Event];
+            printf("%-12s", event->name);
+            PrintArg(event->arg0, event->format0, entry.gte_Arg[0]);
+            PrintArg(event->arg1, event->format1, entry.gte_Arg[1]);
+        }
+        else
+        {
+            printf("event-%-6lu 0x%lx 0x%lx", (unsigned long)entry.gte_Event, (unsigned long)entry.gte_Arg[0],
+                   (unsigned long)entry.gte_Arg[1]);
+        }
+        printf("\n");
+    }
+
+    if (dropped)
+        printf("genet-trace: %lu entries were overwritten while the trace was read\n", (unsigned long)dropped);
+
+    if (file != stdin)
+        fclose(file);
+    return 0;
+}
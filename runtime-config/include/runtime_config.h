@@ -12,6 +12,14 @@
 
 #define DEFAULT_USE_DMA 0
 #define DEFAULT_USE_MIAMI_WORKAROUND 0
+#define DEFAULT_RX_ZERO_COPY 0
+#define DEFAULT_HFB_FILTER 0
+#define DEFAULT_RX_PRIO_RING 0
+#define DEFAULT_TX_PRIO_RING 0
+#define DEFAULT_TX_PRIO_DSCP 40 /* CS5 and above: EF, voice admit, network control */
+#define DEFAULT_RX_ADAPTIVE_COALESCE 1
+#define DEFAULT_RX_CHECKSUM_OFFLOAD 0
+#define DEFAULT_TX_CHECKSUM_OFFLOAD 0
 
 #define DEFAULT_PERIODIC_TASK_MS 200
 #define DEFAULT_BUDGET 32
@@ -19,6 +27,22 @@
 #define DEFAULT_RX_COALESCE_USECS 500
 #define DEFAULT_RX_COALESCE_FRAMES 10
 #define DEFAULT_TX_COALESCE_FRAMES 10
+#define DEFAULT_TX_DOORBELL_FRAMES 16
+#define DEFAULT_TX_BACKLOG 64
+#define DEFAULT_TX_RATE_KBPS 0
+#define DEFAULT_TX_PRIO_RATE_KBPS 0
+#define DEFAULT_TX_RATE_BURST 16384
+#define DEFAULT_TX_LAZY_RECLAIM 0
+#define DEFAULT_TX_RECLAIM_USECS 1000
+
+#define DEFAULT_RX_POLL_RATE 0
+#define DEFAULT_RX_POLL_USECS 250
+#define DEFAULT_RX_POLL_IDLE 8
+
+#define DEFAULT_TRACKED_TYPES 16
+#define DEFAULT_LATENCY_STATS 0
+#define DEFAULT_TRACE_EVENTS 0
+#define DEFAULT_TRACE_RECORDS 1024
 
 struct GenetRuntimeConfig
 {
@@ -26,11 +50,33 @@ struct GenetRuntimeConfig
     ULONG unit_stack_bytes;
     UBYTE use_dma;
     UBYTE use_miami_workaround;
+    UBYTE rx_zero_copy;
+    UBYTE hfb_filter;
+    UBYTE rx_prio_ring;
+    UBYTE tx_prio_ring;
+    UBYTE tx_prio_dscp;
+    UBYTE rx_adaptive_coalesce;
+    UBYTE rx_checksum_offload;
+    UBYTE tx_checksum_offload;
+    UBYTE tx_lazy_reclaim;
+    UBYTE latency_stats;
     UWORD budget;
     ULONG periodic_task_ms;
     ULONG rx_coalesce_usecs;
     ULONG rx_coalesce_frames;
     ULONG tx_coalesce_frames;
+    ULONG tx_doorbell_frames;
+    ULONG tx_backlog;
+    ULONG tx_rate_kbps;
+    ULONG tx_prio_rate_kbps;
+    ULONG tx_rate_burst;
+    ULONG tx_reclaim_usecs;
+    ULONG rx_poll_rate;
+    ULONG rx_poll_usecs;
+    ULONG rx_poll_idle;
+    ULONG tracked_types;
+    ULONG trace_events;
+    ULONG trace_records;
 };
 
 extern struct GenetRuntimeConfig genetConfig;
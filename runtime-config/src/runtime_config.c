@@ -24,11 +24,33 @@ static void ApplyDefaults()
     genetConfig.unit_stack_bytes = DEFAULT_UNIT_STACK_BYTES;
     genetConfig.use_dma = DEFAULT_USE_DMA;
     genetConfig.use_miami_workaround = DEFAULT_USE_MIAMI_WORKAROUND;
+    genetConfig.rx_zero_copy = DEFAULT_RX_ZERO_COPY;
+    genetConfig.hfb_filter = DEFAULT_HFB_FILTER;
+    genetConfig.rx_prio_ring = DEFAULT_RX_PRIO_RING;
+    genetConfig.tx_prio_ring = DEFAULT_TX_PRIO_RING;
+    genetConfig.tx_prio_dscp = DEFAULT_TX_PRIO_DSCP;
+    genetConfig.rx_adaptive_coalesce = DEFAULT_RX_ADAPTIVE_COALESCE;
+    genetConfig.rx_checksum_offload = DEFAULT_RX_CHECKSUM_OFFLOAD;
+    genetConfig.tx_checksum_offload = DEFAULT_TX_CHECKSUM_OFFLOAD;
+    genetConfig.tx_lazy_reclaim = DEFAULT_TX_LAZY_RECLAIM;
     genetConfig.budget = DEFAULT_BUDGET;
     genetConfig.periodic_task_ms = DEFAULT_PERIODIC_TASK_MS;
     genetConfig.rx_coalesce_usecs = DEFAULT_RX_COALESCE_USECS;
     genetConfig.rx_coalesce_frames = DEFAULT_RX_COALESCE_FRAMES;
     genetConfig.tx_coalesce_frames = DEFAULT_TX_COALESCE_FRAMES;
+    genetConfig.tx_doorbell_frames = DEFAULT_TX_DOORBELL_FRAMES;
+    genetConfig.tx_backlog = DEFAULT_TX_BACKLOG;
+    genetConfig.tx_rate_kbps = DEFAULT_TX_RATE_KBPS;
+    genetConfig.tx_prio_rate_kbps = DEFAULT_TX_PRIO_RATE_KBPS;
+    genetConfig.tx_rate_burst = DEFAULT_TX_RATE_BURST;
+    genetConfig.tx_reclaim_usecs = DEFAULT_TX_RECLAIM_USECS;
+    genetConfig.rx_poll_rate = DEFAULT_RX_POLL_RATE;
+    genetConfig.rx_poll_usecs = DEFAULT_RX_POLL_USECS;
+    genetConfig.rx_poll_idle = DEFAULT_RX_POLL_IDLE;
+    genetConfig.tracked_types = DEFAULT_TRACKED_TYPES;
+    genetConfig.latency_stats = DEFAULT_LATENCY_STATS;
+    genetConfig.trace_events = DEFAULT_TRACE_EVENTS;
+    genetConfig.trace_records = DEFAULT_TRACE_RECORDS;
 }
 
 void LoadGenetRuntimeConfig()
@@ -110,6 +132,46 @@ void LoadGenetRuntimeConfig()
                     if (StrToLong((STRPTR)val, &v) && v >= 0)
                         genetConfig.use_miami_workaround = (UBYTE)v;
                 }
+                else if (!Stricmp((STRPTR)key, (STRPTR) "RX_ZERO_COPY"))
+                {
+                    if (StrToLong((STRPTR)val, &v) && v >= 0)
+                        genetConfig.rx_zero_copy = (UBYTE)v;
+                }
+                else if (!Stricmp((STRPTR)key, (STRPTR) "HFB_FILTER"))
+                {
+                    if (StrToLong((STRPTR)val, &v) && v >= 0)
+                        genetConfig.hfb_filter = (UBYTE)v;
+                }
+                else if (!Stricmp((STRPTR)key, (STRPTR) "RX_PRIO_RING"))
+                {
+                    if (StrToLong((STRPTR)val, &v) && v >= 0)
+                        genetConfig.rx_prio_ring = (UBYTE)v;
+                }
+                else if (!Stricmp((STRPTR)key, (STRPTR) "TX_PRIO_RING"))
+                {
+                    if (StrToLong((STRPTR)val, &v) && v >= 0)
+                        genetConfig.tx_prio_ring = (UBYTE)v;
+                }
+                else if (!Stricmp((STRPTR)key, (STRPTR) "TX_PRIO_DSCP"))
+                {
+                    if (StrToLong((STRPTR)val, &v) && v >= 0 && v <= 64)
+                        genetConfig.tx_prio_dscp = (UBYTE)v;
+                }
+                else if (!Stricmp((STRPTR)key, (STRPTR) "RX_ADAPTIVE_COALESCE"))
+                {
+                    if (StrToLong((STRPTR)val, &v) && v >= 0)
+                        genetConfig.rx_adaptive_coalesce = (UBYTE)v;
+                }
+                else if (!Stricmp((STRPTR)key, (STRPTR) "RX_CHECKSUM_OFFLOAD"))
+                {
+                    if (StrToLong((STRPTR)val, &v) && v >= 0)
+                        genetConfig.rx_checksum_offload = (UBYTE)v;
+                }
+                else if (!Stricmp((STRPTR)key, (STRPTR) "TX_CHECKSUM_OFFLOAD"))
+                {
+                    if (StrToLong((STRPTR)val, &v) && v >= 0)
+                        genetConfig.tx_checksum_offload = (UBYTE)v;
+                }
                 else if (!Stricmp((STRPTR)key, (STRPTR) "BUDGET"))
                 {
                     if (StrToLong((STRPTR)val, &v) && v > 0)
@@ -135,6 +197,76 @@ void LoadGenetRuntimeConfig()
                     if (StrToLong((STRPTR)val, &v) && v >= 0)
                         genetConfig.tx_coalesce_frames = (ULONG)v;
                 }
+                else if (!Stricmp((STRPTR)key, (STRPTR) "TX_DOORBELL_FRAMES"))
+                {
+                    if (StrToLong((STRPTR)val, &v) && v > 0)
+                        genetConfig.tx_doorbell_frames = (ULONG)v;
+                }
+                else if (!Stricmp((STRPTR)key, (STRPTR) "TX_BACKLOG"))
+                {
+                    if (StrToLong((STRPTR)val, &v) && v >= 0)
+                        genetConfig.tx_backlog = (ULONG)v;
+                }
+                else if (!Stricmp((STRPTR)key, (STRPTR) "TX_RATE_KBPS"))
+                {
+                    if (StrToLong((STRPTR)val, &v) && v >= 0)
+                        genetConfig.tx_rate_kbps = (ULONG)v;
+                }
+                else if (!Stricmp((STRPTR)key, (STRPTR) "TX_PRIO_RATE_KBPS"))
+                {
+                    if (StrToLong((STRPTR)val, &v) && v >= 0)
+                        genetConfig.tx_prio_rate_kbps = (ULONG)v;
+                }
+                else if (!Stricmp((STRPTR)key, (STRPTR) "TX_RATE_BURST"))
+                {
+                    if (StrToLong((STRPTR)val, &v) && v > 0)
+                        genetConfig.tx_rate_burst = (ULONG)v;
+                }
+                else if (!Stricmp((STRPTR)key, (STRPTR) "TX_LAZY_RECLAIM"))
+                {
+                    if (StrToLong((STRPTR)val, &v) && v >= 0)
+                        genetConfig.tx_lazy_reclaim = (UBYTE)v;
+                }
+                else if (!Stricmp((STRPTR)key, (STRPTR) "TX_RECLAIM_USECS"))
+                {
+                    if (StrToLong((STRPTR)val, &v) && v > 0)
+                        genetConfig.tx_reclaim_usecs = (ULONG)v;
+                }
+                else if (!Stricmp((STRPTR)key, (STRPTR) "RX_POLL_RATE"))
+                {
+                    if (StrToLong((STRPTR)val, &v) && v >= 0)
+                        genetConfig.rx_poll_rate = (ULONG)v;
+                }
+                else if (!Stricmp((STRPTR)key, (STRPTR) "RX_POLL_USECS"))
+                {
+                    if (StrToLong((STRPTR)val, &v) && v >= 0)
+                        genetConfig.rx_poll_usecs = (ULONG)v;
+                }
+                else if (!Stricmp((STRPTR)key, (STRPTR) "RX_POLL_IDLE"))
+                {
+                    if (StrToLong((STRPTR)val, &v) && v > 0)
+                        genetConfig.rx_poll_idle = (ULONG)v;
+                }
+                else if (!Stricmp((STRPTR)key, (STRPTR) "TRACKED_TYPES"))
+                {
+                    if (StrToLong((STRPTR)val, &v) && v >= 0)
+                        genetConfig.tracked_types = (ULONG)v;
+                }
+                else if (!Stricmp((STRPTR)key, (STRPTR) "LATENCY_STATS"))
+                {
+                    if (StrToLong((STRPTR)val, &v) && v >= 0)
+                        genetConfig.latency_stats = (UBYTE)v;
+                }
+                else if (!Stricmp((STRPTR)key, (STRPTR) "TRACE_EVENTS"))
+                {
+                    if (StrToLong((STRPTR)val, &v) && v >= 0)
+                        genetConfig.trace_events = (ULONG)v;
+                }
+                else if (!Stricmp((STRPTR)key, (STRPTR) "TRACE_RECORDS"))
+                {
+                    if (StrToLong((STRPTR)val, &v) && v >= 0 && v <= 65536)
+                        genetConfig.trace_records = (ULONG)v;
+                }
             }
         }
     }
@@ -151,15 +283,37 @@ void LoadGenetRuntimeConfig()
 void DumpGenetRuntimeConfig()
 {
 #ifdef DEBUG
-    Kprintf("[genet] config: pri=%ld stack_bytes=%lu use_dma=%ld miami=%ld periodic_task_ms=%lu budget=%lu rx_coalesce_usecs=%lu rx_coalesce_frames=%lu tx_coalesce_frames=%lu\n",
+    Kprintf("[genet] config: pri=%ld stack_bytes=%lu use_dma=%ld miami=%ld rx_zero_copy=%ld hfb_filter=%ld rx_prio_ring=%ld tx_prio_ring=%ld tx_prio_dscp=%ld rx_adaptive_coalesce=%ld rx_checksum_offload=%ld tx_checksum_offload=%ld tx_lazy_reclaim=%ld periodic_task_ms=%lu budget=%lu rx_coalesce_usecs=%lu rx_coalesce_frames=%lu tx_coalesce_frames=%lu tx_doorbell_frames=%lu tx_backlog=%lu tx_rate_kbps=%lu tx_prio_rate_kbps=%lu tx_rate_burst=%lu tx_reclaim_usecs=%lu rx_poll_rate=%lu rx_poll_usecs=%lu rx_poll_idle=%lu tracked_types=%lu latency_stats=%ld trace_events=0x%lx trace_records=%lu\n",
             genetConfig.unit_task_priority,
             genetConfig.unit_stack_bytes,
             (ULONG)genetConfig.use_dma,
             (ULONG)genetConfig.use_miami_workaround,
+            (ULONG)genetConfig.rx_zero_copy,
+            (ULONG)genetConfig.hfb_filter,
+            (ULONG)genetConfig.rx_prio_ring,
+            (ULONG)genetConfig.tx_prio_ring,
+            (ULONG)genetConfig.tx_prio_dscp,
+            (ULONG)genetConfig.rx_adaptive_coalesce,
+            (ULONG)genetConfig.rx_checksum_offload,
+            (ULONG)genetConfig.tx_checksum_offload,
+            (ULONG)genetConfig.tx_lazy_reclaim,
             genetConfig.periodic_task_ms,
             genetConfig.budget,
             genetConfig.rx_coalesce_usecs,
             genetConfig.rx_coalesce_frames,
-            genetConfig.tx_coalesce_frames);
+            genetConfig.tx_coalesce_frames,
+            genetConfig.tx_doorbell_frames,
+            genetConfig.tx_backlog,
+            genetConfig.tx_rate_kbps,
+            genetConfig.tx_prio_rate_kbps,
+            genetConfig.tx_rate_burst,
+            genetConfig.tx_reclaim_usecs,
+            genetConfig.rx_poll_rate,
+            genetConfig.rx_poll_usecs,
+            genetConfig.rx_poll_idle,
+            genetConfig.tracked_types,
+            (ULONG)genetConfig.latency_stats,
+            genetConfig.trace_events,
+            genetConfig.trace_records);
 #endif
 }